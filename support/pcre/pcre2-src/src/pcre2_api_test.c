@@ -0,0 +1,377 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+     Original API code Copyright (c) 1997-2012 University of Cambridge
+          New API code Copyright (c) 2016-2020 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+/* This program tests library functions that cannot be exercised from the
+pcre2test data files, because what they do is not visible in the results of
+matching or depends on how the library was built: the memory provider and the
+library-wide statistics. It uses only the 8-bit library and is built whether
+or not JIT support is available; the JIT parts of the tests are skipped when it
+is not. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include "pcre2.h"
+
+static int memory_provider_tests(void);
+static int stats_snapshot_tests(void);
+
+static int jit;
+
+int main(void)
+{
+	pcre2_config(PCRE2_CONFIG_JIT, &jit);
+	return memory_provider_tests()
+		| stats_snapshot_tests();
+}
+
+/* --------------------------------------------------------------------------------------- */
+
+/* The provider gets its own structure and its small blocks from a parent
+general context, which counts what it hands out and can be made to fail. The
+pattern needs a frame for each character of the subject when it is
+interpreted, so the frame vector grows well past the block sizes. Arena chunks
+are never smaller than the block size, so they come from the parent only when
+mapping is not available. */
+
+#define PROVIDER_SUBJECT_LENGTH 100000
+#define PROVIDER_BLOCK_SIZE (64 * 1024)
+
+struct provider_parent {
+	int mallocs;
+	int frees;
+	size_t largest;
+	int fail;
+};
+
+static void *provider_parent_malloc(size_t size, void *data)
+{
+	struct provider_parent *parent = (struct provider_parent *)data;
+
+	if (parent->fail)
+		return NULL;
+	parent->mallocs++;
+	if (size > parent->largest)
+		parent->largest = size;
+	return malloc(size);
+}
+
+static void provider_parent_free(void *block, void *data)
+{
+	struct provider_parent *parent = (struct provider_parent *)data;
+
+	if (block != NULL)
+		parent->frees++;
+	free(block);
+}
+
+/* Compile the pattern through the provider's context, and match it with match
+data from the same context, by the interpreter, and, when JIT is available, by
+the JIT code with a subject short enough for the default JIT stack. Returns 0
+if all is well. */
+
+static int provider_match(pcre2_memory_provider *mp, const char *subject)
+{
+	pcre2_general_context *gcontext = pcre2_memory_provider_context(mp);
+	pcre2_compile_context *ccontext = pcre2_compile_context_create(gcontext);
+	pcre2_match_data *mdata = pcre2_match_data_create(2, gcontext);
+	pcre2_code *re = NULL;
+	int error, result1 = -1, result2 = 2;
+	PCRE2_SIZE err_offs;
+
+	if (ccontext && mdata)
+		re = pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+			0, &error, &err_offs, ccontext);
+	if (re) {
+		result1 = pcre2_match(re, (PCRE2_SPTR)subject, PROVIDER_SUBJECT_LENGTH, 0, 0, mdata, NULL);
+		if (jit)
+			result2 = (pcre2_jit_compile(re, PCRE2_JIT_COMPLETE) == 0) ?
+				pcre2_match(re, (PCRE2_SPTR)"babac", 5, 0, 0, mdata, NULL) : -1;
+	}
+	pcre2_code_free(re);
+	pcre2_match_data_free(mdata);
+	pcre2_compile_context_free(ccontext);
+	return (result1 == 2 && result2 == 2) ? 0 : -1;
+}
+
+static int memory_provider_tests(void)
+{
+	static const uint32_t options[] = {
+		0,
+		PCRE2_MEMORY_ARENA,
+		PCRE2_MEMORY_HUGEPAGES | PCRE2_MEMORY_FIRST_TOUCH,
+		PCRE2_MEMORY_ARENA | PCRE2_MEMORY_HUGEPAGES | PCRE2_MEMORY_FIRST_TOUCH
+	};
+	struct provider_parent parent;
+	pcre2_general_context *pcontext;
+	pcre2_memory_provider *mp;
+	pcre2_compile_context *ccontext;
+	pcre2_match_data *mdata;
+	pcre2_code *re;
+	char *subject;
+	int error, result, i;
+	int total = 0, successful = 0;
+	PCRE2_SIZE err_offs;
+
+	printf("Running memory provider tests\n");
+
+	memset(&parent, 0, sizeof(parent));
+	subject = (char *)malloc(PROVIDER_SUBJECT_LENGTH);
+	pcontext = pcre2_general_context_create(provider_parent_malloc, provider_parent_free, &parent);
+	if (!subject || !pcontext) {
+		printf("Cannot set up the memory provider tests\n");
+		pcre2_general_context_free(pcontext);
+		free(subject);
+		return 1;
+	}
+	for (i = 0; i < PROVIDER_SUBJECT_LENGTH - 1; i++)
+		subject[i] = (i & 0x1) ? 'a' : 'b';
+	subject[PROVIDER_SUBJECT_LENGTH - 1] = 'c';
+	parent.mallocs = 0;
+
+	/* Unknown options are rejected, and NULL is accepted everywhere. */
+	total++;
+	mp = pcre2_memory_provider_create(0x80000000u, 0, pcontext);
+	if (mp == NULL && pcre2_memory_provider_context(NULL) == NULL && parent.mallocs == 0) {
+		pcre2_memory_provider_reset(NULL);
+		pcre2_memory_provider_free(NULL);
+		successful++;
+	} else {
+		printf("A provider with an unknown option was created\n");
+		pcre2_memory_provider_free(mp);
+	}
+
+	/* Every mode matches correctly, also after an arena is reset, and gives
+	everything back. Blocks of the block size or more are mapped rather than
+	taken from the parent. */
+	for (i = 0; i < (int)(sizeof(options) / sizeof(options[0])); i++) {
+		total++;
+		parent.mallocs = parent.frees = 0;
+		parent.largest = 0;
+		mp = pcre2_memory_provider_create(options[i],
+			(options[i] & PCRE2_MEMORY_HUGEPAGES) ? 0 : PROVIDER_BLOCK_SIZE, pcontext);
+		result = (mp == NULL) ? -1 : provider_match(mp, subject);
+		if (result == 0 && (options[i] & PCRE2_MEMORY_ARENA) != 0) {
+			/* After a reset, the arena is used again from the start. */
+			pcre2_memory_provider_reset(mp);
+			result = provider_match(mp, subject);
+		}
+		pcre2_memory_provider_free(mp);
+		if (result == 0 && parent.mallocs > 0 && parent.mallocs == parent.frees
+#ifdef HAVE_SYS_MMAN_H
+				&& parent.largest < ((options[i] & PCRE2_MEMORY_HUGEPAGES) ? 2 * 1024 * 1024 : PROVIDER_BLOCK_SIZE)
+				&& ((options[i] & PCRE2_MEMORY_ARENA) == 0 || parent.mallocs == 1)
+#endif
+				)
+			successful++;
+		else
+			printf("Provider with options 0x%x returns %d, %d mallocs, %d frees, largest %d\n",
+				options[i], result, parent.mallocs, parent.frees, (int)parent.largest);
+	}
+
+	/* Memory failures are reported. With so large a block size, everything
+	comes from the parent. */
+	total++;
+	parent.mallocs = parent.frees = 0;
+	mp = pcre2_memory_provider_create(0, 1024 * 1024 * 1024, pcontext);
+	ccontext = pcre2_compile_context_create(pcre2_memory_provider_context(mp));
+	mdata = pcre2_match_data_create(2, pcre2_memory_provider_context(mp));
+	re = pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+		0, &error, &err_offs, ccontext);
+	parent.fail = 1;
+	result = (re == NULL || mdata == NULL) ? 0 : pcre2_match(re, (PCRE2_SPTR)subject,
+		PROVIDER_SUBJECT_LENGTH, 0, 0, mdata, NULL);
+	pcre2_code_free(re);
+	re = pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+		0, &error, &err_offs, ccontext);
+	parent.fail = 0;
+	if (re != NULL)
+		error = 0;
+	pcre2_code_free(re);
+	pcre2_match_data_free(mdata);
+	pcre2_compile_context_free(ccontext);
+	pcre2_memory_provider_free(mp);
+	if (result == PCRE2_ERROR_NOMEMORY && error == PCRE2_ERROR_HEAP_FAILED &&
+			parent.mallocs == parent.frees)
+		successful++;
+	else
+		printf("Failing provider: match returns %d, compile error %d, %d mallocs, %d frees\n",
+			result, error, parent.mallocs, parent.frees);
+
+	pcre2_general_context_free(pcontext);
+	free(subject);
+
+	if (total == successful) {
+		printf("All memory provider tests are successfully passed.\n");
+		return 0;
+	} else {
+		printf("Memory provider successful test ratio: %d%% (%d failed)\n", successful * 100 / total, total - successful);
+		return 1;
+	}
+}
+
+/* --------------------------------------------------------------------------------------- */
+
+/* Each kind of work that is counted is done once between two snapshots, and
+the differences are checked. This program has only one thread, so they are
+exact. Without telemetry support, the snapshot must be all zeros. Without JIT
+support, the match that would have been run by the JIT code is interpreted. */
+
+#define STATS_SUBJECT_LENGTH 10000
+#define STATS_COMPILES 1000
+#define STATS_WORKSPACE_SIZE 1000
+
+static int stats_snapshot_tests(void)
+{
+	pcre2_global_stats before, after;
+	int result;
+	int total = 0, successful = 0;
+#ifdef SUPPORT_TELEMETRY
+	pcre2_code *re = NULL;
+	pcre2_match_data *mdata;
+	pcre2_match_context *mcontext;
+	char *subject;
+	int error, i;
+	int workspace[STATS_WORKSPACE_SIZE];
+	PCRE2_SIZE err_offs;
+#endif
+
+	printf("\nRunning library statistics tests\n");
+
+	total++;
+	if (pcre2_stats_snapshot(NULL) == PCRE2_ERROR_NULL)
+		successful++;
+	else
+		printf("A snapshot with a NULL block does not fail\n");
+
+#ifndef SUPPORT_TELEMETRY
+	total++;
+	memset(&after, 0xff, sizeof(after));
+	memset(&before, 0, sizeof(before));
+	result = pcre2_stats_snapshot(&after);
+	if (result == PCRE2_ERROR_BADOPTION && memcmp(&before, &after, sizeof(after)) == 0)
+		successful++;
+	else
+		printf("A snapshot without telemetry returns %d\n", result);
+#else
+	subject = (char *)malloc(STATS_SUBJECT_LENGTH);
+	mdata = pcre2_match_data_create(2, NULL);
+	mcontext = pcre2_match_context_create(NULL);
+
+	total++;
+	result = pcre2_stats_snapshot(&before);
+	if (result == 0 && subject && mdata && mcontext) {
+		for (i = 0; i < STATS_SUBJECT_LENGTH - 1; i++)
+			subject[i] = (i & 0x1) ? 'a' : 'b';
+		subject[STATS_SUBJECT_LENGTH - 1] = 'c';
+
+		for (i = 0; i < STATS_COMPILES - 1; i++)
+			pcre2_code_free(pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+				0, &error, &err_offs, NULL));
+		re = pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+			0, &error, &err_offs, NULL);
+		(void)pcre2_compile((PCRE2_SPTR)"(", PCRE2_ZERO_TERMINATED,
+			0, &error, &err_offs, NULL);
+	}
+
+	if (re == NULL || (jit && pcre2_jit_compile(re, PCRE2_JIT_COMPLETE) != 0))
+		printf("Cannot set up the library statistics tests (%d)\n", result);
+	else {
+		/* One match by the JIT code; two interpreted matches, one of which
+		needs a larger frame vector and one of which hits the match limit;
+		one DFA match. */
+		(void)pcre2_match(re, (PCRE2_SPTR)"babac", 5, 0, 0, mdata, NULL);
+		(void)pcre2_match(re, (PCRE2_SPTR)subject, STATS_SUBJECT_LENGTH, 0,
+			PCRE2_NO_JIT, mdata, NULL);
+		pcre2_set_match_limit(mcontext, 10);
+		(void)pcre2_match(re, (PCRE2_SPTR)subject, STATS_SUBJECT_LENGTH, 0,
+			PCRE2_NO_JIT, mdata, mcontext);
+		(void)pcre2_dfa_match(re, (PCRE2_SPTR)"babac", 5, 0, 0, mdata,
+			NULL, workspace, STATS_WORKSPACE_SIZE);
+
+		result = pcre2_stats_snapshot(&after);
+		if (result == 0 &&
+				after.compiles - before.compiles == STATS_COMPILES &&
+				after.compile_errors - before.compile_errors == 1 &&
+				after.compile_usec > before.compile_usec &&
+				after.jit_compiles - before.jit_compiles == (jit ? 1 : 0) &&
+				(after.jit_memory > 0) == (jit != 0) &&
+				after.jit_matches - before.jit_matches == (jit ? 1 : 0) &&
+				after.interpreter_matches - before.interpreter_matches == (jit ? 2 : 3) &&
+				after.dfa_matches - before.dfa_matches == 1 &&
+				after.match_limit_hits - before.match_limit_hits == 1 &&
+				after.frame_reallocations > before.frame_reallocations)
+			successful++;
+		else
+			printf("Snapshot returns %d: %d compiles, %d errors, %d usec, %d JIT compiles, "
+				"%d JIT matches, %d interpreter matches, %d DFA matches, %d match limits, "
+				"%d frame reallocations\n", result,
+				(int)(after.compiles - before.compiles),
+				(int)(after.compile_errors - before.compile_errors),
+				(int)(after.compile_usec - before.compile_usec),
+				(int)(after.jit_compiles - before.jit_compiles),
+				(int)(after.jit_matches - before.jit_matches),
+				(int)(after.interpreter_matches - before.interpreter_matches),
+				(int)(after.dfa_matches - before.dfa_matches),
+				(int)(after.match_limit_hits - before.match_limit_hits),
+				(int)(after.frame_reallocations - before.frame_reallocations));
+	}
+
+	pcre2_code_free(re);
+	pcre2_match_context_free(mcontext);
+	pcre2_match_data_free(mdata);
+	free(subject);
+#endif /* SUPPORT_TELEMETRY */
+
+	if (total == successful) {
+		printf("All library statistics tests are successfully passed.\n");
+		return 0;
+	} else {
+		printf("Library statistics successful test ratio: %d%% (%d failed)\n", successful * 100 / total, total - successful);
+		return 1;
+	}
+}
+
+/* End of pcre2_api_test.c */
@@ -192,6 +192,14 @@ memory is used for longer patterns. */
 
 #define PARSED_PATTERN_DEFAULT_SIZE 1024
 
+/* Temporary vectors that do not fit on the stack (the parsed pattern, the
+group info vector, and an expanded named group list) are carved out of heap
+chunks that are all freed together at the end of compiling. The first chunk is
+normally made big enough for everything, so that there is only one allocation
+besides the compiled pattern itself. Chunks are never smaller than this. */
+
+#define COMPILE_ARENA_MIN_SIZE 4096
+
 /* Maximum length value to check against when making sure that the variable
 that holds the compiled pattern length does not overflow. We make it a bit less
 than INT_MAX to allow for adding in group terminating code units, so that we
@@ -1217,7 +1225,8 @@ return newcode;
 
 /* Compiled JIT code cannot be copied, so the new compiled block has no
 associated JIT data. This version of code_copy also makes a separate copy of
-the character tables. */
+the character tables, except when they are the built-in default tables, which
+are static and can be shared. */
 
 PCRE2_EXP_DEFN pcre2_code * PCRE2_CALL_CONVENTION
 pcre2_code_copy_with_tables(const pcre2_code *code)
@@ -1232,6 +1241,12 @@ if (newcode == NULL) return NULL;
 memcpy(newcode, code, code->blocksize);
 newcode->executable_jit = NULL;
 
+if (code->tables == PRIV(default_tables))
+  {
+  newcode->flags &= ~PCRE2_DEREF_TABLES;
+  return newcode;
+  }
+
 newtables = code->memctl.malloc(TABLES_LENGTH + sizeof(PCRE2_SIZE),
   code->memctl.memory_data);
 if (newtables == NULL)
@@ -2374,6 +2389,70 @@ return FALSE;
 
 
 
+/*************************************************
+*     Get memory for compile-time temporaries    *
+*************************************************/
+
+/* Chunks are obtained from the compile context's memory functions and chained
+from the compile block. Each starts with this header. The union makes sure
+that what follows is aligned for anything that is put there. */
+
+typedef union compile_arena_align {
+  void      *align_pointer;
+  double     align_double;
+  PCRE2_SIZE align_size;
+} compile_arena_align;
+
+typedef struct compile_arena {
+  struct compile_arena *next;      /* Previous chunk */
+  PCRE2_SIZE size;                 /* Total length of this chunk */
+  PCRE2_SIZE used;                 /* Offset of first free byte */
+} compile_arena;
+
+#define ARENA_ALIGN(n) \
+  (((n) + sizeof(compile_arena_align) - 1) / sizeof(compile_arena_align) * \
+    sizeof(compile_arena_align))
+
+/* Memory is never given back individually. A new chunk is got only when the
+current one has too little left, and its size is at least the amount
+requested in "reserve", so that a caller that knows that more requests will
+follow can make room for them.
+
+Arguments:
+  size         the number of bytes wanted
+  reserve      minimum size of a new chunk (may be 0)
+  cb           compile block
+
+Returns:       pointer to the memory or NULL if there is none
+*/
+
+static void *
+arena_get(PCRE2_SIZE size, PCRE2_SIZE reserve, compile_block *cb)
+{
+compile_arena *chunk = cb->arena;
+char *yield;
+
+size = ARENA_ALIGN(size);
+if (chunk == NULL || chunk->size - chunk->used < size)
+  {
+  PCRE2_SIZE chunksize = ARENA_ALIGN(sizeof(compile_arena)) + size;
+  if (chunksize < reserve) chunksize = reserve;
+  if (chunksize < COMPILE_ARENA_MIN_SIZE) chunksize = COMPILE_ARENA_MIN_SIZE;
+  chunk = cb->cx->memctl.malloc(chunksize, cb->cx->memctl.memory_data);
+  if (chunk == NULL) return NULL;
+  chunk->next = cb->arena;
+  chunk->size = chunksize;
+  chunk->used = ARENA_ALIGN(sizeof(compile_arena));
+  cb->arena = chunk;
+  }
+
+yield = (char *)chunk + chunk->used;
+chunk->used += size;
+return yield;
+}
+
+
+
 /*************************************************
 *          Manage callouts at start of cycle     *
 *************************************************/
@@ -4576,8 +4655,7 @@ while (ptr < ptrend)
         {
         uint32_t newsize = cb->named_group_list_size * 2;
         named_group *newspace =
-          cb->cx->memctl.malloc(newsize * sizeof(named_group),
-          cb->cx->memctl.memory_data);
+          arena_get(newsize * sizeof(named_group), 0, cb);
         if (newspace == NULL)
           {
           errorcode = ERR21;
@@ -4586,9 +4664,6 @@ while (ptr < ptrend)
 
         memcpy(newspace, cb->named_groups,
           cb->named_group_list_size * sizeof(named_group));
-        if (cb->named_group_list_size > NAMED_GROUP_LIST_SIZE)
-          cb->cx->memctl.free((void *)cb->named_groups,
-          cb->cx->memctl.memory_data);
         cb->named_groups = newspace;
         cb->named_group_list_size = newsize;
         }
@@ -5478,6 +5553,7 @@ for (;; pptr++)
       if (firstcuflags == REQ_UNSET)
         zerofirstcuflags = firstcuflags = REQ_NONE;
       *code++ = OP_CIRCM;
+      cb->external_flags |= PCRE2_HASCIRCM;
       }
     else *code++ = OP_CIRC;
     break;
@@ -6311,6 +6387,7 @@ for (;; pptr++)
       insert appropriate data values. */
 
       code[1+LINK_SIZE]++;
+      if (meta != META_COND_RNAME) cb->external_flags |= PCRE2_HASDUPREF;
       skipunits = 1+2*IMM2_SIZE;
       PUT2(code, 2+LINK_SIZE, index);
       PUT2(code, 2+LINK_SIZE+IMM2_SIZE, count);
@@ -6713,6 +6790,7 @@ for (;; pptr++)
             &count, errorcodeptr, cb)) return 0;
 
       if (firstcuflags == REQ_UNSET) firstcuflags = REQ_NONE;
+      cb->external_flags |= PCRE2_HASDUPREF;
       *code++ = ((options & PCRE2_CASELESS) != 0)? OP_DNREFI : OP_DNREF;
       PUT2INC(code, 0, index);
       PUT2INC(code, 0, count);
@@ -6724,6 +6802,7 @@ for (;; pptr++)
     /* Handle a numerical callout. */
 
     case META_CALLOUT_NUMBER:
+    cb->external_flags |= PCRE2_HASCALLOUT;
     code[0] = OP_CALLOUT;
     PUT(code, 1, pptr[1]);               /* Offset to next pattern item */
     PUT(code, 1 + LINK_SIZE, pptr[2]);   /* Length of next pattern item */
@@ -6741,6 +6820,7 @@ for (;; pptr++)
     this an overestimate, but it is not worth bothering about. */
 
     case META_CALLOUT_STRING:
+    cb->external_flags |= PCRE2_HASCALLOUT;
     if (lengthptr != NULL)
       {
       *lengthptr += pptr[3] + (1 + 4*LINK_SIZE);
@@ -9673,6 +9753,10 @@ int regexrc;                          /* Return from compile */
 
 uint32_t i;                           /* Local loop counter */
 
+#ifdef SUPPORT_TELEMETRY
+uint64_t start_time = PRIV(telemetry_clock)();    /* For telemetry */
+#endif
+
 /* Comments at the head of this file explain about these variables. */
 
 uint32_t stack_groupinfo[GROUPINFO_DEFAULT_SIZE];
@@ -9762,6 +9846,7 @@ cb.erroroffset = 0;
 cb.external_flags = 0;
 cb.external_options = options;
 cb.groupinfo = stack_groupinfo;
+cb.arena = NULL;
 cb.had_recurse = FALSE;
 cb.lastcapture = 0;
 cb.max_lookbehind = 0;
@@ -10003,7 +10088,10 @@ if (!utf)
 is set we have to assume a numerical callout (4 elements) for each character
 plus one at the end. This is overkill, but memory is plentiful these days. For
 many smaller patterns the vector on the stack (which was set up above) can be
-used. */
+used. Otherwise the chunk that holds it is made big enough to hold the other
+temporary vectors as well. Their sizes are bounded by the number of opening
+parentheses, which limits the number of capturing groups, and the number of
+those followed by a question mark, which limits the number of named groups. */
 
 parsed_size_needed = patlen - skipatstart + big32count;
 
@@ -10016,8 +10104,29 @@ if ((options & PCRE2_AUTO_CALLOUT) != 0)
 
 if (parsed_size_needed >= PARSED_PATTERN_DEFAULT_SIZE)
   {
-  uint32_t *heap_parsed_pattern = ccontext->memctl.malloc(
-    (parsed_size_needed + 1) * sizeof(uint32_t), ccontext->memctl.memory_data);
+  PCRE2_SIZE parens = 0;
+  PCRE2_SIZE names = 0;
+  PCRE2_SIZE parsed_bytes = (parsed_size_needed + 1) * sizeof(uint32_t);
+  PCRE2_SIZE reserve;
+  uint32_t *heap_parsed_pattern;
+  PCRE2_SPTR p;
+
+  for (p = ptr; p < cb.end_pattern; p++)
+    {
+    if (*p != CHAR_LEFT_PARENTHESIS) continue;
+    parens++;
+    if (p + 1 < cb.end_pattern && p[1] == CHAR_QUESTION_MARK) names++;
+    }
+  if (parens < GROUPINFO_DEFAULT_SIZE) parens = 0;
+  if (names <= NAMED_GROUP_LIST_SIZE) names = 0;
+
+  /* The named group list is doubled each time it fills up, and the old lists
+  are not freed, so allow four times the maximum number of names. */
+
+  reserve = ARENA_ALIGN(sizeof(compile_arena)) + ARENA_ALIGN(parsed_bytes) +
+    ARENA_ALIGN((parens + 1) * sizeof(uint32_t)) +
+    4 * names * ARENA_ALIGN(sizeof(named_group));
+  heap_parsed_pattern = arena_get(parsed_bytes, reserve, &cb);
   if (heap_parsed_pattern == NULL)
     {
     *errorptr = ERR21;
@@ -10038,13 +10147,13 @@ avoid the possibility of recursive references causing very long compile times
 when checking these features. Unnumbered groups do not have this exposure since
 they cannot be referenced. We use an indexed vector for this purpose. If there
 are sufficiently few groups, the default vector on the stack, as set up above,
-can be used. Otherwise we have to get/free a special vector. The vector must be
+can be used. Otherwise we have to get a special vector, which normally fits in
+the space that was reserved with the parsed pattern. The vector must be
 initialized to zero. */
 
 if (cb.bracount >= GROUPINFO_DEFAULT_SIZE)
   {
-  cb.groupinfo = ccontext->memctl.malloc(
-    (cb.bracount + 1)*sizeof(uint32_t), ccontext->memctl.memory_data);
+  cb.groupinfo = arena_get((cb.bracount + 1)*sizeof(uint32_t), 0, &cb);
   if (cb.groupinfo == NULL)
     {
     errorcode = ERR21;
@@ -10116,13 +10225,14 @@ if (length > MAX_PATTERN_SIZE)
 /* Compute the size of, and then get and initialize, the data block for storing
 the compiled pattern and names table. Integer overflow should no longer be
 possible because nowadays we limit the maximum value of cb.names_found and
-cb.name_entry_size. */
+cb.name_entry_size. Room is also reserved at the end for a start bitmap, though
+it is counted in re->blocksize only if study() actually creates one. */
 
 re_blocksize = sizeof(pcre2_real_code) +
   CU2BYTES(length +
   (PCRE2_SIZE)cb.names_found * (PCRE2_SIZE)cb.name_entry_size);
-re = (pcre2_real_code *)
-  ccontext->memctl.malloc(re_blocksize, ccontext->memctl.memory_data);
+re = (pcre2_real_code *)ccontext->memctl.malloc(
+  re_blocksize + START_BITMAP_SIZE, ccontext->memctl.memory_data);
 if (re == NULL)
   {
   errorcode = ERR21;
@@ -10139,7 +10249,6 @@ memset((char *)re + sizeof(pcre2_real_code) - 8, 0, 8);
 re->memctl = ccontext->memctl;
 re->tables = tables;
 re->executable_jit = NULL;
-memset(re->start_bitmap, 0, 32 * sizeof(uint8_t));
 re->blocksize = re_blocksize;
 re->magic_number = MAGIC_NUMBER;
 re->compile_options = options;
@@ -10212,6 +10321,11 @@ if (cb.had_accept)
   re->flags |= PCRE2_HASACCEPT;  /* Disables minimum length */
   }
 
+/* Patterns without recursions or subroutine calls may be able to leave some
+groups out of the match frames (see pcre2_match()). */
+
+if (cb.had_recurse) re->flags |= PCRE2_HASRECURSE;
+
 /* Fill in the final opcode and check for disastrous overflow. If no overflow,
 but the estimated length exceeds the really used length, adjust the value of
 re->blocksize, and if valgrind support is configured, mark the extra allocated
@@ -10223,7 +10337,8 @@ if (usedlength > length) errorcode = ERR23; else
   {
   re->blocksize -= CU2BYTES(length - usedlength);
 #ifdef SUPPORT_VALGRIND
-  VALGRIND_MAKE_MEM_NOACCESS(code, CU2BYTES(length - usedlength));
+  VALGRIND_MAKE_MEM_NOACCESS(code,
+    CU2BYTES(length - usedlength) + START_BITMAP_SIZE);
 #endif
   }
 
@@ -10331,6 +10446,7 @@ unit. */
 if ((re->overall_options & PCRE2_NO_START_OPTIMIZE) == 0)
   {
   int minminlength = 0;  /* For minimal minlength from first/required CU */
+  uint8_t start_bitmap[START_BITMAP_SIZE];
 
   /* If we do not have a first code unit, see if there is one that is asserted
   (these are not saved during the compile because they can cause conflicts with
@@ -10440,17 +10556,26 @@ if ((re->overall_options & PCRE2_NO_START_OPTIMIZE) == 0)
   /* Study the compiled pattern to set up information such as a bitmap of
   starting code units and a minimum matching length. */
 
-  if (PRIV(study)(re) != 0)
+  if (PRIV(study)(re, start_bitmap) != 0)
     {
     errorcode = ERR31;
     goto HAD_CB_ERROR;
     }
 
   /* If study() set a bitmap of starting code units, it implies a minimum
-  length of at least one. */
+  length of at least one. The bitmap is kept at the end of the compiled code,
+  in the space that was reserved for it when the block was obtained. */
 
-  if ((re->flags & PCRE2_FIRSTMAPSET) != 0 && minminlength == 0)
-    minminlength = 1;
+  if ((re->flags & PCRE2_FIRSTMAPSET) != 0)
+    {
+    uint8_t *bitmap_start = (uint8_t *)re + re->blocksize;
+#ifdef SUPPORT_VALGRIND
+    VALGRIND_MAKE_MEM_UNDEFINED(bitmap_start, START_BITMAP_SIZE);
+#endif
+    memcpy(bitmap_start, start_bitmap, START_BITMAP_SIZE);
+    re->blocksize += START_BITMAP_SIZE;
+    if (minminlength == 0) minminlength = 1;
+    }
 
   /* If the minimum length set (or not set) by study() is less than the minimum
   implied by required code units, override it. */
@@ -10460,20 +10585,25 @@ if ((re->overall_options & PCRE2_NO_START_OPTIMIZE) == 0)
 
 /* Control ends up here in all cases. When running under valgrind, make a
 pattern's terminating zero defined again. If memory was obtained for the parsed
-version of the pattern, free it before returning. Also free the list of named
-groups if a larger one had to be obtained, and likewise the group information
-vector. */
+version of the pattern, the list of named groups, or the group information
+vector, it is all in the arena chunks, which are freed before returning. */
 
 EXIT:
 #ifdef SUPPORT_VALGRIND
 if (zero_terminated) VALGRIND_MAKE_MEM_DEFINED(pattern + patlen, CU2BYTES(1));
 #endif
-if (cb.parsed_pattern != stack_parsed_pattern)
-  ccontext->memctl.free(cb.parsed_pattern, ccontext->memctl.memory_data);
-if (cb.named_group_list_size > NAMED_GROUP_LIST_SIZE)
-  ccontext->memctl.free((void *)cb.named_groups, ccontext->memctl.memory_data);
-if (cb.groupinfo != stack_groupinfo)
-  ccontext->memctl.free((void *)cb.groupinfo, ccontext->memctl.memory_data);
+while (cb.arena != NULL)
+  {
+  compile_arena *next = cb.arena->next;
+  ccontext->memctl.free(cb.arena, ccontext->memctl.memory_data);
+  cb.arena = next;
+  }
+#ifdef SUPPORT_TELEMETRY
+PRIV(telemetry_add)((re != NULL)? TELEMETRY_COMPILES : TELEMETRY_COMPILE_ERRORS,
+  1);
+PRIV(telemetry_add)(TELEMETRY_COMPILE_NSEC,
+  PRIV(telemetry_clock)() - start_time);
+#endif
 return re;    /* Will be NULL after an error */
 
 /* Errors discovered in parse_regex() set the offset value in the compile
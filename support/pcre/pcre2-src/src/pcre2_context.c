@@ -165,6 +165,7 @@ const pcre2_match_context PRIV(default_match_context) = {
 #ifdef SUPPORT_JIT
   NULL,          /* JIT callback */
   NULL,          /* JIT callback data */
+  NULL,          /* JIT stack pool */
 #endif
   NULL,          /* Callout function */
   NULL,          /* Callout data */
@@ -173,7 +174,12 @@ const pcre2_match_context PRIV(default_match_context) = {
   PCRE2_UNSET,   /* Offset limit */
   HEAP_LIMIT,
   MATCH_LIMIT,
-  MATCH_LIMIT_DEPTH };
+  MATCH_LIMIT_DEPTH,
+  0,             /* Memo limit (no memoization) */
+  0,             /* Do not collect statistics */
+  NULL,          /* DFA workspace */
+  NULL,          /* Real-time match buffer */
+  0 };           /* Its size */
 
 /* The create function copies the default into the new memory, but must
 override the default memory handling functions if a gcontext was provided. */
@@ -415,6 +421,14 @@ mcontext->substitute_callout_data = substitute_callout_data;
 return 0;
 }
 
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_set_dfa_workspace(pcre2_match_context *mcontext,
+  pcre2_dfa_workspace *workspace)
+{
+mcontext->dfa_workspace = workspace;
+return 0;
+}
+
 PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_set_heap_limit(pcre2_match_context *mcontext, uint32_t limit)
 {
@@ -422,6 +436,26 @@ mcontext->heap_limit = limit;
 return 0;
 }
 
+/* The buffer for real-time matching is aligned so that it can hold frames,
+workspace blocks, or a JIT stack. A NULL buffer turns real-time matching off. */
+
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_set_match_buffer(pcre2_match_context *mcontext, void *buffer,
+  PCRE2_SIZE size)
+{
+PCRE2_SIZE skip = 0;
+if (buffer != NULL)
+  {
+  skip = (MATCH_BUFFER_ALIGN - (size_t)buffer % MATCH_BUFFER_ALIGN) %
+    MATCH_BUFFER_ALIGN;
+  if (skip > size) skip = size;
+  }
+mcontext->match_buffer = (buffer == NULL)? NULL : (char *)buffer + skip;
+mcontext->match_buffer_size = (buffer == NULL)? 0 :
+  ((size - skip) / MATCH_BUFFER_ALIGN) * MATCH_BUFFER_ALIGN;
+return 0;
+}
+
 PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_set_match_limit(pcre2_match_context *mcontext, uint32_t limit)
 {
@@ -429,6 +463,20 @@ mcontext->match_limit = limit;
 return 0;
 }
 
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_set_match_stats(pcre2_match_context *mcontext, uint32_t value)
+{
+mcontext->collect_stats = (value != 0);
+return 0;
+}
+
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_set_memo_limit(pcre2_match_context *mcontext, uint32_t limit)
+{
+mcontext->memo_limit = limit;
+return 0;
+}
+
 PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_set_depth_limit(pcre2_match_context *mcontext, uint32_t limit)
 {
@@ -619,9 +619,10 @@ if (*pattern == CHAR_EXCLAMATION_MARK
       len++;
       }
     out->out_str[len] = (uint8_t) separator;
+    len++;
     }
 
-  convert_glob_write_str(out, len + 1);
+  convert_glob_write_str(out, len);
   }
 else
   convert_glob_write(out, CHAR_LEFT_SQUARE_BRACKET);
@@ -731,7 +732,7 @@ while (pattern < pattern_end)
     }
 
   if (c == CHAR_LEFT_SQUARE_BRACKET || c == CHAR_RIGHT_SQUARE_BRACKET ||
-      c == CHAR_BACKSLASH || c == CHAR_MINUS)
+      c == CHAR_BACKSLASH || c == CHAR_MINUS || c == CHAR_CIRCUMFLEX_ACCENT)
     convert_glob_write(out, CHAR_BACKSLASH);
 
   if (c == separator) separator_seen = TRUE;
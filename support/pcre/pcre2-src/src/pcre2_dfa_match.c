@@ -400,6 +400,14 @@ recursively and there is insufficient working space left in the current
 workspace block. If there's an existing next block, use it; otherwise get a new
 block unless the heap limit is reached.
 
+Blocks that were left over from an earlier match by a DFA workspace object have
+not yet been counted against the heap limit for this match. The blocks are
+always used in chain order, so those that have been counted are the ones up to
+mb->rws_top. A left over block is used only if it is exactly the size that
+would be obtained now; otherwise it is freed, together with any that follow it.
+This keeps the heap limit working in the same way whether or not blocks are
+retained; in a series of matches with the same limit, the sizes always agree.
+
 Arguments:
   rwsptr     pointer to block pointer (updated)
   ovecsize   space needed for an ovector
@@ -413,18 +421,17 @@ static int
 more_workspace(RWS_anchor **rwsptr, unsigned int ovecsize, dfa_match_block *mb)
 {
 RWS_anchor *rws = *rwsptr;
-RWS_anchor *new;
+RWS_anchor *new = rws->next;
 
-if (rws->next != NULL)
-  {
-  new = rws->next;
-  }
+/* A real-time buffer is the only block there can be. */
+
+if (mb->fixed_workspace) return PCRE2_ERROR_HEAPLIMIT;
 
 /* Sizes in the RWS_anchor blocks are in units of sizeof(int), but
 mb->heap_limit and mb->heap_used are in kibibytes. Play carefully, to avoid
 overflow. */
 
-else
+if (new == NULL || rws == mb->rws_top)
   {
   uint32_t newsize = (rws->size >= UINT32_MAX/2)? UINT32_MAX/2 : rws->size * 2;
   uint32_t newsizeK = newsize/(1024/sizeof(int));
@@ -433,14 +440,31 @@ else
     newsizeK = (uint32_t)(mb->heap_limit - mb->heap_used);
   newsize = newsizeK*(1024/sizeof(int));
 
+  if (new != NULL && new->size != newsize)
+    {
+    while (new != NULL)
+      {
+      RWS_anchor *next = new->next;
+      mb->memctl.free(new, mb->memctl.memory_data);
+      new = next;
+      }
+    rws->next = NULL;
+    }
+
   if (newsize < RWS_RSIZE + ovecsize + RWS_ANCHOR_SIZE)
     return PCRE2_ERROR_HEAPLIMIT;
-  new = mb->memctl.malloc(newsize*sizeof(int), mb->memctl.memory_data);
-  if (new == NULL) return PCRE2_ERROR_NOMEMORY;
+
+  if (new == NULL)
+    {
+    new = mb->memctl.malloc(newsize*sizeof(int), mb->memctl.memory_data);
+    if (new == NULL) return PCRE2_ERROR_NOMEMORY;
+    new->next = NULL;
+    new->size = newsize;
+    rws->next = new;
+    }
+
   mb->heap_used += newsizeK;
-  new->next = NULL;
-  new->size = newsize;
-  rws->next = new;
+  mb->rws_top = new;
   }
 
 new->free = new->size - RWS_ANCHOR_SIZE;
@@ -3245,6 +3269,7 @@ int rc;
 int was_zero_terminated = 0;
 
 const pcre2_real_code *re = (const pcre2_real_code *)code;
+pcre2_real_dfa_workspace *dws = NULL;
 
 PCRE2_SPTR start_match;
 PCRE2_SPTR end_subject;
@@ -3297,6 +3322,26 @@ if (length == PCRE2_ZERO_TERMINATED)
 /* Plausibility checks */
 
 if ((options & ~PUBLIC_DFA_MATCH_OPTIONS) != 0) return PCRE2_ERROR_BADOPTION;
+
+/* A DFA workspace object in the match context supplies the workspace vector
+if none is given, and keeps heap blocks for recursion from one call to the
+next. */
+
+if (mcontext != NULL && mcontext->dfa_workspace != NULL)
+  {
+  dws = mcontext->dfa_workspace;
+  if (workspace == NULL)
+    {
+    workspace = (int *)((char *)dws + sizeof(pcre2_real_dfa_workspace));
+    wscount = dws->wscount;
+    }
+  }
+
+/* In real-time matching, blocks retained by a workspace object are left
+alone, because the caller's buffer is the only recursion workspace. */
+
+if (mcontext != NULL && mcontext->match_buffer != NULL) dws = NULL;
+
 if (re == NULL || subject == NULL || workspace == NULL || match_data == NULL)
   return PCRE2_ERROR_NULL;
 if (wscount < 20) return PCRE2_ERROR_DFA_WSSIZE;
@@ -3400,6 +3445,9 @@ else
       return PCRE2_ERROR_BADOFFSETLIMIT;
     bumpalong_limit = subject + mcontext->offset_limit;
     }
+  if (mcontext->match_buffer != NULL &&
+      (options & PCRE2_COPY_MATCHED_SUBJECT) != 0)
+    return PCRE2_ERROR_HEAPLIMIT;   /* A copy cannot be allocated */
   mb->callout = mcontext->callout;
   mb->callout_data = mcontext->callout_data;
   mb->memctl = mcontext->memctl;
@@ -3417,6 +3465,10 @@ if (mb->match_limit_depth > re->limit_depth)
 if (mb->heap_limit > re->limit_heap)
   mb->heap_limit = re->limit_heap;
 
+/* Retained workspace blocks must be freed by the allocator that got them. */
+
+if (dws != NULL) mb->memctl = dws->memctl;
+
 mb->start_code = (PCRE2_UCHAR *)((uint8_t *)re + sizeof(pcre2_real_code)) +
   re->name_count * re->name_entry_size;
 mb->tables = re->tables;
@@ -3429,6 +3481,8 @@ mb->moptions = options;
 mb->poptions = re->overall_options;
 mb->match_call_count = 0;
 mb->heap_used = 0;
+mb->rws_top = rws;
+mb->fixed_workspace = FALSE;
 
 /* Process the \R and newline settings. */
 
@@ -3540,7 +3594,7 @@ if ((re->flags & PCRE2_FIRSTSET) != 0)
   }
 else
   if (!startline && (re->flags & PCRE2_FIRSTMAPSET) != 0)
-    start_bits = re->start_bitmap;
+    start_bits = START_BITMAP(re);
 
 /* There may be a "last known required code unit" set. */
 
@@ -3578,8 +3632,35 @@ if ((match_data->flags & PCRE2_MD_COPIED_SUBJECT) != 0)
 match_data->code = re;
 match_data->subject = NULL;  /* Default for no match */
 match_data->mark = NULL;
+match_data->flags &= ~PCRE2_MD_STATS;  /* Not collected by DFA matching */
 match_data->matchedby = PCRE2_MATCHEDBY_DFA_INTERPRETER;
 
+/* Pick up any recursion workspace blocks that were retained from a previous
+call. From here on, all exits must go via EXIT so that they are saved again. */
+
+if (dws != NULL) rws->next = (RWS_anchor *)dws->rws_blocks;
+
+/* In real-time matching, the recursion workspace is the caller's buffer, cut
+to the heap limit, and no other block can be obtained. If the buffer cannot
+even hold an anchor, no recursion is possible. */
+
+if (mcontext != NULL && mcontext->match_buffer != NULL)
+  {
+  PCRE2_SIZE size = mcontext->match_buffer_size;
+  if (size / 1024 >= mb->heap_limit) size = mb->heap_limit * 1024;
+  mb->fixed_workspace = TRUE;
+  if (size >= sizeof(RWS_anchor))
+    {
+    rws = (RWS_anchor *)mcontext->match_buffer;
+    rws->next = NULL;
+    rws->size = (size/sizeof(int) > UINT32_MAX)? UINT32_MAX :
+      (uint32_t)(size/sizeof(int));
+    rws->free = rws->size - RWS_ANCHOR_SIZE;
+    mb->rws_top = rws;
+    }
+  else rws->free = 0;
+  }
+
 /* Call the main matching function, looping for a non-anchored regex after a
 failed match. If not restarting, perform certain optimizations at the start of
 a match. */
@@ -3904,7 +3985,7 @@ for (;;)
     workspace,                    /* workspace vector */
     (int)wscount,                 /* size of same */
     0,                            /* function recurse level */
-    base_recursion_workspace);    /* initial workspace for recursion */
+    (int *)rws);                  /* initial workspace for recursion */
 
   /* Anything other than "no match" means we are done, always; otherwise, carry
   on only if not anchored. */
@@ -3926,7 +4007,11 @@ for (;;)
       length = CU2BYTES(length + was_zero_terminated);
       match_data->subject = match_data->memctl.malloc(length,
         match_data->memctl.memory_data);
-      if (match_data->subject == NULL) return PCRE2_ERROR_NOMEMORY;
+      if (match_data->subject == NULL)
+        {
+        rc = PCRE2_ERROR_NOMEMORY;
+        goto EXIT;
+        }
       memcpy((void *)match_data->subject, subject, length);
       match_data->flags |= PCRE2_MD_COPIED_SUBJECT;
       }
@@ -3969,14 +4054,92 @@ NOMATCH_EXIT:
 rc = PCRE2_ERROR_NOMATCH;
 
 EXIT:
-while (rws->next != NULL)
+if (dws != NULL)
+  dws->rws_blocks = rws->next;
+else while (rws->next != NULL)
   {
   RWS_anchor *next = rws->next;
   rws->next = next->next;
   mb->memctl.free(next, mb->memctl.memory_data);
   }
 
+#ifdef SUPPORT_TELEMETRY
+PRIV(telemetry_match)(TELEMETRY_DFA_MATCHES, rc);
+#endif
 return rc;
 }
 
+
+
+
+/*************************************************
+*          Create a DFA workspace object         *
+*************************************************/
+
+/* The workspace vector is allocated in the same block as the structure. A
+size of zero requests the default, which is enough for most patterns.
+
+Arguments:
+  wscount    number of ints in the workspace vector
+  gcontext   points to a general context, or is NULL
+
+Returns:     pointer to the new object, or NULL if there is no memory
+*/
+
+#define DFA_WORKSPACE_DEFAULT 1000
+#define DFA_WORKSPACE_MIN     20
+
+PCRE2_EXP_DEFN pcre2_dfa_workspace * PCRE2_CALL_CONVENTION
+pcre2_dfa_workspace_create(PCRE2_SIZE wscount, pcre2_general_context *gcontext)
+{
+pcre2_real_dfa_workspace *dws;
+int *workspace;
+
+if (wscount == 0) wscount = DFA_WORKSPACE_DEFAULT;
+else if (wscount < DFA_WORKSPACE_MIN) wscount = DFA_WORKSPACE_MIN;
+if (wscount > (PCRE2_SIZE)(~(PCRE2_SIZE)0 - sizeof(pcre2_real_dfa_workspace))/
+    sizeof(int))
+  return NULL;
+dws = PRIV(memctl_malloc)(sizeof(pcre2_real_dfa_workspace) +
+  wscount * sizeof(int), (pcre2_memctl *)gcontext);
+if (dws == NULL) return NULL;
+dws->rws_blocks = NULL;
+dws->wscount = wscount;
+
+/* Make sure that an attempt to restart a match that was never started is
+diagnosed. */
+
+workspace = (int *)((char *)dws + sizeof(pcre2_real_dfa_workspace));
+workspace[0] = workspace[1] = 0;
+return dws;
+}
+
+
+
+/*************************************************
+*          Free a DFA workspace object           *
+*************************************************/
+
+/* This frees any recursion workspace blocks that have been retained, as well
+as the object itself.
+
+Argument:  the object to be freed, or NULL
+Returns:   nothing
+*/
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_dfa_workspace_free(pcre2_dfa_workspace *dws)
+{
+RWS_anchor *rws;
+if (dws == NULL) return;
+rws = (RWS_anchor *)dws->rws_blocks;
+while (rws != NULL)
+  {
+  RWS_anchor *next = rws->next;
+  dws->memctl.free(rws, dws->memctl.memory_data);
+  rws = next;
+  }
+dws->memctl.free(dws, dws->memctl.memory_data);
+}
+
 /* End of pcre2_dfa_match.c */
@@ -92,7 +92,22 @@ PCRE2_SPTR
 PRIV(extuni)(uint32_t c, PCRE2_SPTR eptr, PCRE2_SPTR start_subject,
   PCRE2_SPTR end_subject, BOOL utf, int *xcount)
 {
-int lgb = UCD_GRAPHBREAK(c);
+int lgb;
+
+/* Between two ASCII characters there is always a grapheme break, except
+between CR and LF, after which there is always a break. A sequence that
+starts with an ASCII character that is followed by another can therefore be
+handled without looking up any properties. This is by far the commonest case
+in most text. */
+
+if (c < 128 && eptr < end_subject && *eptr < 128)
+  {
+  if (c != 0x0d || *eptr != 0x0a) return eptr;
+  if (xcount != NULL) *xcount += 1;
+  return eptr + 1;
+  }
+
+lgb = UCD_GRAPHBREAK(c);
 
 while (eptr < end_subject)
   {
@@ -0,0 +1,1285 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+     Original API code Copyright (c) 1997-2012 University of Cambridge
+          New API code Copyright (c) 2016-2020 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+/* This module contains pcre2_glob_compile(), pcre2_glob_match(), and
+pcre2_glob_free(), which match globs directly instead of converting them into
+regular expressions. The results are the same as those obtained by converting
+a glob with pcre2_pattern_convert() and matching the result with pcre2_match(),
+with no compile options other than PCRE2_UTF when the glob is UTF.
+
+The converted pattern uses (*COMMIT) before each wildcard that is not in the
+scope of an earlier **, and an atomic group for each single * after one. Once
+(*COMMIT) has been passed, no earlier choice is ever revisited, so a glob is
+compiled into "parts", each of which is a wildcard followed by a segment of
+fixed-length items, and the parts are grouped into regions that each start at
+a (*COMMIT). Within a region only the wildcard of the first part can be
+retried; the rest are atomic, so each finds the first place where its segment
+matches. This is done without any recursion or backtracking stack. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pcre2_internal.h"
+
+#define ALL_OPTIONS (PCRE2_CONVERT_UTF|PCRE2_CONVERT_NO_UTF_CHECK| \
+  PCRE2_CONVERT_GLOB_NO_WILD_SEPARATOR| \
+  PCRE2_CONVERT_GLOB_NO_STARSTAR)
+
+/* The number of atomic parts in a region for which the results of earlier
+scans are remembered. Later ones are still matched correctly, but may rescan
+the same characters. */
+
+#define GLOB_MEMO_SIZE 16
+
+/* Types of wildcard at the start of a part. GW_NONE is used only for the
+first part of a glob that does not start with a wildcard (the \A of the
+converted pattern). GW_NOSEP is [^/]*?, GW_ANY is .*? (or an unanchored start),
+and GW_DIR is (?:.*?/)?? (or (?:\A|/) at the start). */
+
+enum { GW_NONE, GW_NOSEP, GW_ANY, GW_DIR };
+
+/* Flags for parts */
+
+#define GP_COMMIT  0x01u    /* Part starts a new region */
+#define GP_ATEND   0x02u    /* Segment must end at the end of the subject */
+
+/* Types of segment item */
+
+enum { GI_LITERAL, GI_ANY, GI_ANYNS, GI_CLASS };
+
+/* Flags in the first word of a class */
+
+#define GC_NEGATED 0x01u    /* Match characters not in the set */
+#define GC_NOSEP   0x02u    /* Never match the separator */
+
+/* Each class starts with a flags word, a count of ranges, and a bitmap for
+characters less than 256, followed by pairs of values for ranges whose upper
+end is 256 or more. */
+
+#define GLOB_CLASS_HEADER (2 + 256/32)
+
+typedef struct glob_part {
+  uint8_t  wild;                  /* Wildcard type */
+  uint8_t  flags;                 /* GP_xxx flags */
+  uint16_t dummy;                 /* For alignment */
+  uint32_t first_item;            /* Index of first segment item */
+  uint32_t item_count;            /* Number of segment items */
+  uint32_t first_cu;              /* First code unit of segment or NOTACHAR */
+} glob_part;
+
+typedef struct glob_item {
+  uint32_t type;                  /* GI_xxx type */
+  uint32_t offset;                /* Offset of literal units or class data */
+  uint32_t length;                /* Number of literal units */
+} glob_item;
+
+/* Block used while compiling. In the sizing pass the vectors are NULL and
+only the counts are kept. */
+
+typedef struct glob_compile_block {
+  glob_part   *parts;
+  glob_item   *items;
+  uint32_t    *classdata;
+  PCRE2_UCHAR *literals;
+  uint32_t     part_count;
+  uint32_t     item_count;
+  uint32_t     class_size;
+  uint32_t     literal_size;
+  uint32_t     separator;
+  uint32_t     escape;
+  BOOL         utf;
+  BOOL         no_wildsep;
+  BOOL         no_starstar;
+} glob_compile_block;
+
+/* Block used while matching */
+
+typedef struct glob_match_block {
+  const glob_part *parts;
+  const glob_item *items;
+  const uint32_t  *classdata;
+  PCRE2_SPTR       literals;
+  PCRE2_SPTR       end_subject;
+  uint32_t         separator;
+  BOOL             utf;
+} glob_match_block;
+
+/* Bitmaps for the POSIX classes, in the order of the names that are
+recognized in globs. Each entry is the same as in pcre2_compile(): the
+offset of the main table in cbits, an optional table to add or remove, and an
+option to remove vertical space (1) or underscore (2). */
+
+static const char *posix_classes = "alnum:alpha:ascii:blank:cntrl:digit:"
+  "graph:lower:print:punct:space:upper:word:xdigit:";
+
+static const int posix_class_maps[] = {
+  cbit_word,  -1,          2,             /* alnum */
+  cbit_word,  cbit_digit, -2,             /* alpha */
+  cbit_print, cbit_cntrl,  0,             /* ascii */
+  cbit_space, -1,          1,             /* blank */
+  cbit_cntrl, -1,          0,             /* cntrl */
+  cbit_digit, -1,          0,             /* digit */
+  cbit_graph, -1,          0,             /* graph */
+  cbit_lower, -1,          0,             /* lower */
+  cbit_print, -1,          0,             /* print */
+  cbit_punct, -1,          0,             /* punct */
+  cbit_space, -1,          0,             /* space */
+  cbit_upper, -1,          0,             /* upper */
+  cbit_word,  -1,          0,             /* word */
+  cbit_xdigit,-1,          0              /* xdigit */
+};
+
+
+
+/*************************************************
+*        Add parts and items to a glob           *
+*************************************************/
+
+/* In the sizing pass these functions just count.
+
+Arguments:
+  cb         compile block
+  wild       wildcard type
+  flags      part flags
+*/
+
+static void
+glob_add_part(glob_compile_block *cb, int wild, uint32_t flags)
+{
+if (cb->parts != NULL)
+  {
+  glob_part *part = cb->parts + cb->part_count;
+  part->wild = (uint8_t)wild;
+  part->flags = (uint8_t)flags;
+  part->dummy = 0;
+  part->first_item = cb->item_count;
+  part->item_count = 0;
+  part->first_cu = NOTACHAR;
+  }
+cb->part_count++;
+}
+
+
+/* Add an item to the current part.
+
+Arguments:
+  cb         compile block
+  type       item type
+  offset     offset of literal units or class data
+*/
+
+static void
+glob_add_item(glob_compile_block *cb, uint32_t type, uint32_t offset)
+{
+if (cb->parts != NULL)
+  {
+  glob_item *item = cb->items + cb->item_count;
+  item->type = type;
+  item->offset = offset;
+  item->length = 0;
+  cb->parts[cb->part_count - 1].item_count++;
+  }
+cb->item_count++;
+}
+
+
+/* Add a literal code unit, extending the last item if it is a literal.
+
+Arguments:
+  cb         compile block
+  cu         the code unit
+*/
+
+static void
+glob_add_literal(glob_compile_block *cb, PCRE2_UCHAR cu)
+{
+if (cb->parts != NULL)
+  {
+  glob_part *part = cb->parts + cb->part_count - 1;
+  glob_item *item = cb->items + cb->item_count - 1;
+
+  if (part->item_count == 0 || item->type != GI_LITERAL)
+    {
+    glob_add_item(cb, GI_LITERAL, cb->literal_size);
+    item = cb->items + cb->item_count - 1;
+    }
+  if (part->item_count == 1 && item->length == 0) part->first_cu = cu;
+  cb->literals[cb->literal_size] = cu;
+  item->length++;
+  }
+
+/* In the sizing pass, count one item per unit, which is more than enough. */
+
+else cb->item_count++;
+cb->literal_size++;
+}
+
+
+/* Add a range of characters to the class that is being built, which is at the
+end of the class data.
+
+Arguments:
+  cb         compile block
+  cls        offset of the class
+  lo         first character
+  hi         last character
+*/
+
+static void
+glob_class_add(glob_compile_block *cb, uint32_t cls, uint32_t lo, uint32_t hi)
+{
+if (cb->parts != NULL)
+  {
+  uint32_t *data = cb->classdata + cls;
+  uint32_t c;
+
+  for (c = lo; c <= hi && c < 256; c++) data[2 + c/32] |= 1u << (c%32);
+  if (hi >= 256)
+    {
+    cb->classdata[cb->class_size] = (lo < 256)? 256 : lo;
+    cb->classdata[cb->class_size + 1] = hi;
+    data[1]++;
+    }
+  }
+if (hi >= 256) cb->class_size += 2;
+}
+
+
+
+/*************************************************
+*            Parse a POSIX class                 *
+*************************************************/
+
+/* This follows convert_glob_parse_class() in pcre2_convert.c.
+
+Arguments:
+  from           starting point of scanning the range
+  pattern_end    end of pattern
+
+Returns:  >0 => class index
+          0  => malformed class
+*/
+
+static int
+glob_parse_posix(PCRE2_SPTR *from, PCRE2_SPTR pattern_end)
+{
+PCRE2_SPTR start = *from + 1;
+PCRE2_SPTR pattern = start;
+const char *class_ptr;
+PCRE2_UCHAR c;
+int class_index;
+
+while (TRUE)
+  {
+  if (pattern >= pattern_end) return 0;
+
+  c = *pattern++;
+
+  if (c < CHAR_a || c > CHAR_z) break;
+  }
+
+if (c != CHAR_COLON || pattern >= pattern_end ||
+    *pattern != CHAR_RIGHT_SQUARE_BRACKET)
+  return 0;
+
+class_ptr = posix_classes;
+class_index = 1;
+
+while (TRUE)
+  {
+  if (*class_ptr == CHAR_NUL) return 0;
+
+  pattern = start;
+
+  while (*pattern == (PCRE2_UCHAR) *class_ptr)
+    {
+    if (*pattern == CHAR_COLON)
+      {
+      *from = pattern + 2;
+      return class_index;
+      }
+    pattern++;
+    class_ptr++;
+    }
+
+  while (*class_ptr != CHAR_COLON) class_ptr++;
+  class_ptr++;
+  class_index++;
+  }
+}
+
+
+/* Check whether a character is in a POSIX class, as the glob converter does
+when deciding whether a class can match the separator.
+
+Arguments:
+  class_index    class index
+  c              character
+
+Returns:         TRUE if the character is in the class
+*/
+
+static BOOL
+glob_char_in_posix(int class_index, uint32_t c)
+{
+switch (class_index)
+  {
+  case 1: return isalnum(c);
+  case 2: return isalpha(c);
+  case 3: return 1;
+  case 4: return c == CHAR_HT || c == CHAR_SPACE;
+  case 5: return iscntrl(c);
+  case 6: return isdigit(c);
+  case 7: return isgraph(c);
+  case 8: return islower(c);
+  case 9: return isprint(c);
+  case 10: return ispunct(c);
+  case 11: return isspace(c);
+  case 12: return isupper(c);
+  case 13: return isalnum(c) || c == CHAR_UNDERSCORE;
+  default: return isxdigit(c);
+  }
+}
+
+
+/* Add the characters of a POSIX class to the class that is being built,
+using the default character tables.
+
+Arguments:
+  cb             compile block
+  cls            offset of the class
+  class_index    class index
+*/
+
+static void
+glob_class_add_posix(glob_compile_block *cb, uint32_t cls, int class_index)
+{
+const uint8_t *cbits = PRIV(default_tables) + cbits_offset;
+const int *map = posix_class_maps + 3*(class_index - 1);
+uint8_t pbits[32];
+int i;
+
+if (cb->parts == NULL) return;
+
+memcpy(pbits, cbits + map[0], 32);
+if (map[1] >= 0)
+  {
+  if (map[2] >= 0)
+    for (i = 0; i < 32; i++) pbits[i] |= cbits[i + map[1]];
+  else
+    for (i = 0; i < 32; i++) pbits[i] &= ~cbits[i + map[1]];
+  }
+if (map[2] == 1 || map[2] == -1) pbits[1] &= ~0x3c;
+  else if (map[2] == 2 || map[2] == -2) pbits[11] &= 0x7f;
+
+for (i = 0; i < 256; i++)
+  {
+  if ((pbits[i/8] & (1u << (i%8))) != 0)
+    cb->classdata[cls + 2 + i/32] |= 1u << (i%32);
+  }
+}
+
+
+
+/*************************************************
+*              Parse a class                     *
+*************************************************/
+
+/* This follows convert_glob_parse_range() in pcre2_convert.c, building a
+class instead of writing one out, so that the same globs are accepted and the
+same errors are given at the same offsets.
+
+Arguments:
+  from           starting point of scanning the range
+  pattern_end    end of pattern
+  cb             compile block
+
+Returns:         0 => success
+                !0 => error code
+*/
+
+static int
+glob_parse_range(PCRE2_SPTR *from, PCRE2_SPTR pattern_end,
+  glob_compile_block *cb)
+{
+BOOL utf = cb->utf;
+BOOL is_negative = FALSE;
+BOOL separator_seen = FALSE;
+BOOL has_prev_c;
+PCRE2_SPTR pattern = *from;
+uint32_t separator = cb->separator;
+uint32_t escape = cb->escape;
+uint32_t cls = cb->class_size;
+uint32_t c, prev_c;
+int class_index;
+
+(void)utf; /* Avoid compiler warning. */
+
+if (cb->parts != NULL)
+  memset(cb->classdata + cls, 0, GLOB_CLASS_HEADER*sizeof(uint32_t));
+cb->class_size += GLOB_CLASS_HEADER;
+
+if (pattern >= pattern_end)
+  {
+  *from = pattern;
+  return PCRE2_ERROR_MISSING_SQUARE_BRACKET;
+  }
+
+if (*pattern == CHAR_EXCLAMATION_MARK
+    || *pattern == CHAR_CIRCUMFLEX_ACCENT)
+  {
+  pattern++;
+
+  if (pattern >= pattern_end)
+    {
+    *from = pattern;
+    return PCRE2_ERROR_MISSING_SQUARE_BRACKET;
+    }
+
+  is_negative = TRUE;
+  }
+
+has_prev_c = FALSE;
+prev_c = 0;
+
+if (*pattern == CHAR_RIGHT_SQUARE_BRACKET)
+  {
+  glob_class_add(cb, cls, CHAR_RIGHT_SQUARE_BRACKET,
+    CHAR_RIGHT_SQUARE_BRACKET);
+  has_prev_c = TRUE;
+  prev_c = CHAR_RIGHT_SQUARE_BRACKET;
+  pattern++;
+  }
+
+while (pattern < pattern_end)
+  {
+  GETCHARINCTEST(c, pattern);
+
+  if (c == CHAR_RIGHT_SQUARE_BRACKET)
+    {
+    if (cb->parts != NULL)
+      {
+      uint32_t flags = 0;
+      if (is_negative)
+        {
+        flags |= GC_NEGATED;
+        if (!cb->no_wildsep) flags |= GC_NOSEP;
+        }
+      else if (!cb->no_wildsep && separator_seen) flags |= GC_NOSEP;
+      cb->classdata[cls] = flags;
+      }
+    glob_add_item(cb, GI_CLASS, cls);
+    *from = pattern;
+    return 0;
+    }
+
+  if (pattern >= pattern_end) break;
+
+  if (c == CHAR_LEFT_SQUARE_BRACKET && *pattern == CHAR_COLON)
+    {
+    *from = pattern;
+    class_index = glob_parse_posix(from, pattern_end);
+
+    if (class_index != 0)
+      {
+      pattern = *from;
+
+      has_prev_c = FALSE;
+      prev_c = 0;
+
+      glob_class_add_posix(cb, cls, class_index);
+      if (!is_negative && glob_char_in_posix(class_index, separator))
+        separator_seen = TRUE;
+      continue;
+      }
+    }
+  else if (c == CHAR_MINUS && has_prev_c &&
+           *pattern != CHAR_RIGHT_SQUARE_BRACKET)
+    {
+    GETCHARINCTEST(c, pattern);
+
+    if (pattern >= pattern_end) break;
+
+    if (escape != 0 && c == escape)
+      {
+      GETCHARINCTEST(c, pattern);
+      }
+    else if (c == CHAR_LEFT_SQUARE_BRACKET && *pattern == CHAR_COLON)
+      {
+      *from = pattern;
+      return PCRE2_ERROR_CONVERT_SYNTAX;
+      }
+
+    if (prev_c > c)
+      {
+      *from = pattern;
+      return PCRE2_ERROR_CONVERT_SYNTAX;
+      }
+
+    if (prev_c < separator && separator < c) separator_seen = TRUE;
+    glob_class_add(cb, cls, prev_c, c);
+
+    has_prev_c = FALSE;
+    prev_c = 0;
+    }
+  else
+    {
+    if (escape != 0 && c == escape)
+      {
+      GETCHARINCTEST(c, pattern);
+
+      if (pattern >= pattern_end) break;
+      }
+
+    has_prev_c = TRUE;
+    prev_c = c;
+    }
+
+  if (c == separator) separator_seen = TRUE;
+  glob_class_add(cb, cls, c, c);
+  }
+
+*from = pattern;
+return PCRE2_ERROR_MISSING_SQUARE_BRACKET;
+}
+
+
+
+/*************************************************
+*              Parse a glob                      *
+*************************************************/
+
+/* This follows convert_glob() in pcre2_convert.c. It is run twice, first to
+find the sizes of the vectors, and then to fill them in.
+
+Arguments:
+  cb             compile block
+  pattern        the glob
+  plength        length in code units
+  erroroffset    where to put an error offset
+
+Returns:         0 => success
+                !0 => error code
+*/
+
+static int
+glob_parse(glob_compile_block *cb, PCRE2_SPTR pattern, PCRE2_SIZE plength,
+  PCRE2_SIZE *erroroffset)
+{
+PCRE2_SPTR pattern_start = pattern;
+PCRE2_SPTR pattern_end = pattern + plength;
+uint32_t separator = cb->separator;
+uint32_t escape = cb->escape;
+PCRE2_UCHAR c;
+BOOL no_wildsep = cb->no_wildsep;
+BOOL no_starstar = cb->no_starstar;
+BOOL after_starstar = FALSE;
+BOOL no_slash_z = FALSE;
+BOOL is_start, after_separator;
+int result = 0;
+
+is_start = TRUE;
+
+if (pattern < pattern_end && pattern[0] == CHAR_ASTERISK)
+  {
+  if (no_wildsep)
+    is_start = FALSE;
+  else if (!no_starstar && pattern + 1 < pattern_end &&
+           pattern[1] == CHAR_ASTERISK)
+    is_start = FALSE;
+  }
+
+/* The first part is anchored at the start unless the glob starts with a
+wildcard that can skip separators. */
+
+glob_add_part(cb, is_start? GW_NONE : GW_ANY, 0);
+
+while (pattern < pattern_end)
+  {
+  c = *pattern++;
+
+  if (c == CHAR_ASTERISK)
+    {
+    is_start = pattern == pattern_start + 1;
+
+    if (!no_starstar && pattern < pattern_end && *pattern == CHAR_ASTERISK)
+      {
+      after_separator = is_start || (pattern[-2] == separator);
+
+      do pattern++; while (pattern < pattern_end &&
+                           *pattern == CHAR_ASTERISK);
+
+      if (pattern >= pattern_end)
+        {
+        no_slash_z = TRUE;
+        break;
+        }
+
+      after_starstar = TRUE;
+
+      if (after_separator && escape != 0 && *pattern == escape &&
+          pattern + 1 < pattern_end && pattern[1] == separator)
+        pattern++;
+
+      if (is_start)
+        {
+        if (*pattern != separator) continue;
+        if (cb->parts != NULL) cb->parts[0].wild = GW_DIR;
+        pattern++;
+        continue;
+        }
+
+      if (!after_separator || *pattern != separator)
+        {
+        glob_add_part(cb, GW_ANY, GP_COMMIT);
+        continue;
+        }
+
+      glob_add_part(cb, GW_DIR, GP_COMMIT);
+      pattern++;
+      continue;
+      }
+
+    if (pattern < pattern_end && *pattern == CHAR_ASTERISK)
+      {
+      do pattern++; while (pattern < pattern_end &&
+                           *pattern == CHAR_ASTERISK);
+      }
+
+    if (no_wildsep)
+      {
+      if (pattern >= pattern_end)
+        {
+        no_slash_z = TRUE;
+        break;
+        }
+
+      /* Start check must be after the end check. */
+      if (is_start) continue;
+      }
+
+    /* A wildcard at the very start belongs to the first part; others start a
+    new part, which is atomic after a **. */
+
+    if (is_start)
+      {
+      if (cb->parts != NULL) cb->parts[0].wild = GW_NOSEP;
+      }
+    else glob_add_part(cb, no_wildsep? GW_ANY : GW_NOSEP,
+      after_starstar? 0 : GP_COMMIT);
+    continue;
+    }
+
+  if (c == CHAR_QUESTION_MARK)
+    {
+    glob_add_item(cb, no_wildsep? GI_ANY : GI_ANYNS, 0);
+    continue;
+    }
+
+  if (c == CHAR_LEFT_SQUARE_BRACKET)
+    {
+    result = glob_parse_range(&pattern, pattern_end, cb);
+    if (result != 0) break;
+    continue;
+    }
+
+  if (escape != 0 && c == escape)
+    {
+    if (pattern >= pattern_end)
+      {
+      result = PCRE2_ERROR_CONVERT_SYNTAX;
+      break;
+      }
+    c = *pattern++;
+    }
+
+  glob_add_literal(cb, c);
+  }
+
+if (result != 0)
+  {
+  *erroroffset = pattern - pattern_start;
+  return result;
+  }
+
+if (!no_slash_z && cb->parts != NULL)
+  cb->parts[cb->part_count - 1].flags |= GP_ATEND;
+return 0;
+}
+
+
+
+/*************************************************
+*              Compile a glob                    *
+*************************************************/
+
+/* This function has the same arguments and errors as pcre2_pattern_convert()
+with PCRE2_CONVERT_GLOB, but produces a compiled glob for use with
+pcre2_glob_match().
+
+Arguments:
+  pattern       the glob
+  plength       length of glob, or PCRE2_ZERO_TERMINATED
+  options       options bits
+  errorptr      pointer to errorcode
+  erroroffset   pointer to error offset
+  ccontext      convert context or NULL
+
+Returns:        pointer to compiled glob, or NULL on error
+*/
+
+PCRE2_EXP_DEFN pcre2_glob * PCRE2_CALL_CONVENTION
+pcre2_glob_compile(PCRE2_SPTR pattern, PCRE2_SIZE plength, uint32_t options,
+  int *errorptr, PCRE2_SIZE *erroroffset, pcre2_convert_context *ccontext)
+{
+glob_compile_block cb;
+pcre2_real_glob *glob;
+uint8_t *p;
+size_t size;
+BOOL utf = (options & PCRE2_CONVERT_UTF) != 0;
+int rc;
+
+if (errorptr == NULL || erroroffset == NULL) return NULL;
+*errorptr = 0;
+*erroroffset = 0;
+
+if (pattern == NULL)
+  {
+  *errorptr = PCRE2_ERROR_NULL;
+  return NULL;
+  }
+
+/* PCRE2_CONVERT_GLOB is implied, and is part of the two glob options. */
+
+options &= ~PCRE2_CONVERT_GLOB;
+if ((options & ~ALL_OPTIONS) != 0)
+  {
+  *errorptr = PCRE2_ERROR_BADOPTION;
+  return NULL;
+  }
+
+if (plength == PCRE2_ZERO_TERMINATED) plength = PRIV(strlen)(pattern);
+if (ccontext == NULL) ccontext =
+  (pcre2_convert_context *)(&PRIV(default_convert_context));
+
+#ifndef SUPPORT_UNICODE
+if (utf)
+  {
+  *errorptr = PCRE2_ERROR_UNICODE_NOT_SUPPORTED;
+  return NULL;
+  }
+#else
+if (utf && (options & PCRE2_CONVERT_NO_UTF_CHECK) == 0)
+  {
+  rc = PRIV(valid_utf)(pattern, plength, erroroffset);
+  if (rc != 0)
+    {
+    *errorptr = rc;
+    return NULL;
+    }
+  }
+
+if (utf && (ccontext->glob_separator >= 128 || ccontext->glob_escape >= 128))
+  {
+  /* Currently only ASCII characters are supported. */
+  *errorptr = PCRE2_ERROR_CONVERT_SYNTAX;
+  return NULL;
+  }
+#endif
+
+memset(&cb, 0, sizeof(cb));
+cb.separator = ccontext->glob_separator;
+cb.escape = ccontext->glob_escape;
+cb.utf = utf;
+cb.no_wildsep =
+  (options & PCRE2_CONVERT_GLOB_NO_WILD_SEPARATOR & ~PCRE2_CONVERT_GLOB) != 0;
+cb.no_starstar =
+  (options & PCRE2_CONVERT_GLOB_NO_STARSTAR & ~PCRE2_CONVERT_GLOB) != 0;
+
+/* Sizing pass */
+
+rc = glob_parse(&cb, pattern, plength, erroroffset);
+if (rc != 0)
+  {
+  *errorptr = rc;
+  return NULL;
+  }
+
+size = sizeof(pcre2_real_glob) + cb.part_count*sizeof(glob_part) +
+  cb.item_count*sizeof(glob_item) + cb.class_size*sizeof(uint32_t) +
+  CU2BYTES(cb.literal_size);
+
+glob = PRIV(memctl_malloc)(size, (pcre2_memctl *)ccontext);
+if (glob == NULL)
+  {
+  *errorptr = PCRE2_ERROR_NOMEMORY;
+  return NULL;
+  }
+
+p = (uint8_t *)glob + sizeof(pcre2_real_glob);
+cb.parts = (glob_part *)p;
+p += cb.part_count*sizeof(glob_part);
+cb.items = (glob_item *)p;
+p += cb.item_count*sizeof(glob_item);
+cb.classdata = (uint32_t *)p;
+p += cb.class_size*sizeof(uint32_t);
+cb.literals = (PCRE2_UCHAR *)p;
+
+/* The vectors are located by the sizes from the first pass. The second pass
+may use fewer items, because the first one counts one for each literal code
+unit. It cannot fail. */
+
+glob->options = options;
+glob->separator = cb.separator;
+glob->part_count = cb.part_count;
+glob->item_count = cb.item_count;
+glob->class_size = cb.class_size;
+
+cb.part_count = cb.item_count = cb.class_size = cb.literal_size = 0;
+(void)glob_parse(&cb, pattern, plength, erroroffset);
+return glob;
+}
+
+
+
+/*************************************************
+*            Free a compiled glob                *
+*************************************************/
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_glob_free(pcre2_glob *glob)
+{
+if (glob != NULL)
+  glob->memctl.free(glob, glob->memctl.memory_data);
+}
+
+
+
+/*************************************************
+*        Match a character against a class       *
+*************************************************/
+
+/*
+Arguments:
+  cls          the class data
+  c            the character
+  separator    the separator
+
+Returns:       TRUE if the character matches
+*/
+
+static BOOL
+glob_class_match(const uint32_t *cls, uint32_t c, uint32_t separator)
+{
+BOOL found;
+
+if (c == separator && (cls[0] & GC_NOSEP) != 0) return FALSE;
+
+if (c < 256) found = (cls[2 + c/32] & (1u << (c%32))) != 0; else
+  {
+  const uint32_t *range = cls + GLOB_CLASS_HEADER;
+  const uint32_t *range_end = range + 2*cls[1];
+
+  found = FALSE;
+  for (; range < range_end; range += 2)
+    {
+    if (c >= range[0] && c <= range[1])
+      {
+      found = TRUE;
+      break;
+      }
+    }
+  }
+
+return ((cls[0] & GC_NEGATED) != 0)? !found : found;
+}
+
+
+
+/*************************************************
+*          Match the segment of a part           *
+**************************************************/
+
+/*
+Arguments:
+  mb           match block
+  part         the part
+  eptr         where the segment starts in the subject
+
+Returns:       pointer to the end of the segment, or NULL if it does not match
+*/
+
+static PCRE2_SPTR
+glob_match_segment(const glob_match_block *mb, const glob_part *part,
+  PCRE2_SPTR eptr)
+{
+const glob_item *item = mb->items + part->first_item;
+const glob_item *item_end = item + part->item_count;
+BOOL utf = mb->utf;
+
+(void)utf; /* Avoid compiler warning. */
+
+for (; item < item_end; item++)
+  {
+  uint32_t c;
+
+  if (item->type == GI_LITERAL)
+    {
+    if ((PCRE2_SIZE)(mb->end_subject - eptr) < item->length ||
+        memcmp(eptr, mb->literals + item->offset, CU2BYTES(item->length))
+          != 0)
+      return NULL;
+    eptr += item->length;
+    continue;
+    }
+
+  if (eptr >= mb->end_subject) return NULL;
+  GETCHARINCTEST(c, eptr);
+
+  if (item->type == GI_ANYNS)
+    {
+    if (c == mb->separator) return NULL;
+    }
+  else if (item->type == GI_CLASS)
+    {
+    if (!glob_class_match(mb->classdata + item->offset, c, mb->separator))
+      return NULL;
+    }
+  }
+
+if ((part->flags & GP_ATEND) != 0 && eptr != mb->end_subject) return NULL;
+return eptr;
+}
+
+
+
+/*************************************************
+*     Find where a part's segment might start    *
+*************************************************/
+
+/* The wildcard of a part determines the places where its segment can start,
+in the order in which the converted pattern would try them. When the segment
+starts with a literal, places where its first code unit does not appear are
+skipped; in the 8-bit library this search is done by memchr().
+
+Arguments:
+  mb           match block
+  part         the part
+  eptr         where the wildcard starts, or the previous place tried
+  advance      FALSE for the first place, TRUE for the next one
+
+Returns:       the next place to try, or NULL if there are none
+*/
+
+static PCRE2_SPTR
+glob_next_start(const glob_match_block *mb, const glob_part *part,
+  PCRE2_SPTR eptr, BOOL advance)
+{
+PCRE2_SPTR end_subject = mb->end_subject;
+uint32_t separator = mb->separator;
+uint32_t fc = part->first_cu;
+BOOL utf = mb->utf;
+
+(void)utf; /* Avoid compiler warning. */
+
+switch(part->wild)
+  {
+  case GW_NONE:
+  if (advance) return NULL;
+  break;
+
+  /* [^/]*? cannot move past a separator. */
+
+  case GW_NOSEP:
+  if (advance)
+    {
+    if (eptr >= end_subject || *eptr == separator) return NULL;
+    eptr++;
+#ifdef SUPPORT_UNICODE
+    if (utf) { FORWARDCHARTEST(eptr, end_subject); }
+#endif
+    }
+  if (fc != NOTACHAR)
+    {
+#if PCRE2_CODE_UNIT_WIDTH == 8
+    PCRE2_SPTR next = memchr(eptr, (int)fc, end_subject - eptr);
+    if (next == NULL ||
+        memchr(eptr, (int)separator, next - eptr) != NULL) return NULL;
+    eptr = next;
+#else
+    for (; eptr < end_subject && *eptr != fc; eptr++)
+      if (*eptr == separator) return NULL;
+    if (eptr >= end_subject) return NULL;
+#endif
+    }
+  break;
+
+  case GW_ANY:
+  if (advance)
+    {
+    if (eptr >= end_subject) return NULL;
+    eptr++;
+#ifdef SUPPORT_UNICODE
+    if (utf) { FORWARDCHARTEST(eptr, end_subject); }
+#endif
+    }
+  if (fc != NOTACHAR)
+    {
+#if PCRE2_CODE_UNIT_WIDTH == 8
+    eptr = memchr(eptr, (int)fc, end_subject - eptr);
+#else
+    while (eptr < end_subject && *eptr != fc) eptr++;
+    if (eptr >= end_subject) return NULL;
+#endif
+    }
+  break;
+
+  /* (?:.*?/)?? tries the starting point, then the place after each following
+  separator. */
+
+  case GW_DIR:
+  for (;;)
+    {
+    if (!advance && (fc == NOTACHAR || (eptr < end_subject && *eptr == fc)))
+      break;
+    advance = FALSE;
+#if PCRE2_CODE_UNIT_WIDTH == 8
+    eptr = memchr(eptr, (int)separator, end_subject - eptr);
+    if (eptr == NULL) return NULL;
+#else
+    while (eptr < end_subject && *eptr != separator) eptr++;
+    if (eptr >= end_subject) return NULL;
+#endif
+    eptr++;
+    }
+  break;
+  }
+
+return eptr;
+}
+
+
+
+/*************************************************
+*        Find where a part's wildcard ends       *
+*************************************************/
+
+/* Used for the atomic parts of a region, which match only at the first place
+where their segment matches. If there is no such place, *stopptr is set to the
+last place that could have been tried.
+
+Arguments:
+  mb           match block
+  part         the part
+  eptr         where the wildcard starts
+  startptr     where to put the start of the segment
+  stopptr      where to put the end of the scan on failure
+
+Returns:       pointer to the end of the segment, or NULL
+*/
+
+static PCRE2_SPTR
+glob_match_atomic(const glob_match_block *mb, const glob_part *part,
+  PCRE2_SPTR eptr, PCRE2_SPTR *startptr, PCRE2_SPTR *stopptr)
+{
+PCRE2_SPTR start = glob_next_start(mb, part, eptr, FALSE);
+
+while (start != NULL)
+  {
+  PCRE2_SPTR yield = glob_match_segment(mb, part, start);
+  if (yield != NULL)
+    {
+    *startptr = start;
+    return yield;
+    }
+  start = glob_next_start(mb, part, start, TRUE);
+  }
+
+/* Find where the wildcard would have had to stop. */
+
+if (part->wild == GW_NOSEP)
+  {
+  while (eptr < mb->end_subject && *eptr != mb->separator) eptr++;
+  *stopptr = eptr;
+  }
+else *stopptr = mb->end_subject;
+return NULL;
+}
+
+
+
+/*************************************************
+*           Match a compiled glob                *
+*************************************************/
+
+/* Each region is matched by trying the places where the segment of its first
+part can start, in order. For each of them, the atomic parts that follow are
+matched at the first place possible. The first success ends the region; if
+there is none, the glob does not match, because the converted pattern cannot
+backtrack into an earlier region.
+
+For each atomic part, the range of starting points that are known to lead to
+the same outcome as a previous attempt is remembered. As that attempt failed,
+an attempt that reaches the part with a starting point in that range can be
+abandoned at once. This stops repeated scans of the same characters, so the
+time taken is proportional to the length of the subject multiplied by the
+length of the glob.
+
+Arguments:
+  glob          the compiled glob
+  subject       the subject string
+  length        length of subject, or PCRE2_ZERO_TERMINATED
+  options       option bits
+
+Returns:        1 for a match
+                PCRE2_ERROR_NOMATCH if there is no match
+                other negative values for errors
+*/
+
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_glob_match(const pcre2_glob *glob, PCRE2_SPTR subject,
+  PCRE2_SIZE length, uint32_t options)
+{
+glob_match_block mb;
+PCRE2_SPTR memo_from[GLOB_MEMO_SIZE];
+PCRE2_SPTR memo_to[GLOB_MEMO_SIZE];
+PCRE2_SPTR eptr;
+const uint8_t *p;
+uint32_t i, n, k;
+
+if (glob == NULL || subject == NULL) return PCRE2_ERROR_NULL;
+if ((options & ~PCRE2_NO_UTF_CHECK) != 0) return PCRE2_ERROR_BADOPTION;
+if (length == PCRE2_ZERO_TERMINATED) length = PRIV(strlen)(subject);
+
+mb.utf = (glob->options & PCRE2_CONVERT_UTF) != 0;
+
+#ifdef SUPPORT_UNICODE
+if (mb.utf && (options & PCRE2_NO_UTF_CHECK) == 0)
+  {
+  PCRE2_SIZE erroroffset;
+  int rc = PRIV(valid_utf)(subject, length, &erroroffset);
+  if (rc != 0) return rc;
+  }
+#endif
+
+p = (const uint8_t *)glob + sizeof(pcre2_real_glob);
+mb.parts = (const glob_part *)p;
+p += glob->part_count*sizeof(glob_part);
+mb.items = (const glob_item *)p;
+p += glob->item_count*sizeof(glob_item);
+mb.classdata = (const uint32_t *)p;
+p += glob->class_size*sizeof(uint32_t);
+mb.literals = (PCRE2_SPTR)p;
+mb.end_subject = subject + length;
+mb.separator = glob->separator;
+
+/* If the glob must end with a literal, check the end of the subject first, as
+pcre2_match() would find that the last literal is missing and give up at
+once. */
+
+if ((mb.parts[glob->part_count - 1].flags & GP_ATEND) != 0)
+  {
+  const glob_part *last = mb.parts + glob->part_count - 1;
+  const glob_item *item = mb.items + last->first_item + last->item_count - 1;
+
+  if (last->item_count > 0 && item->type == GI_LITERAL &&
+      (length < item->length ||
+       memcmp(mb.end_subject - item->length, mb.literals + item->offset,
+         CU2BYTES(item->length)) != 0))
+    return PCRE2_ERROR_NOMATCH;
+  }
+
+eptr = subject;
+
+for (i = 0; i < glob->part_count; i = n)
+  {
+  const glob_part *lead = mb.parts + i;
+  PCRE2_SPTR start, yield = NULL;
+
+  for (n = i + 1; n < glob->part_count; n++)
+    {
+    if ((mb.parts[n].flags & GP_COMMIT) != 0) break;
+    if (n - i - 1 < GLOB_MEMO_SIZE) memo_from[n - i - 1] = NULL;
+    }
+
+  for (start = glob_next_start(&mb, lead, eptr, FALSE);
+       start != NULL;
+       start = glob_next_start(&mb, lead, start, TRUE))
+    {
+    yield = glob_match_segment(&mb, lead, start);
+
+    for (k = i + 1; yield != NULL && k < n; k++)
+      {
+      uint32_t m = k - i - 1;
+      PCRE2_SPTR from = yield;
+      PCRE2_SPTR to;
+
+      if (m < GLOB_MEMO_SIZE && memo_from[m] != NULL &&
+          from >= memo_from[m] && from <= memo_to[m])
+        {
+        yield = NULL;
+        break;
+        }
+
+      yield = glob_match_atomic(&mb, mb.parts + k, from, &to, &to);
+
+      /* A later attempt that starts this part anywhere from here to the start
+      of the segment, or to where the scan stopped, gets the same result. */
+
+      if (m < GLOB_MEMO_SIZE)
+        {
+        memo_from[m] = from;
+        memo_to[m] = to;
+        }
+      }
+
+    if (yield != NULL) break;
+    }
+
+  if (yield == NULL) return PCRE2_ERROR_NOMATCH;
+  eptr = yield;
+  }
+
+return 1;
+}
+
+/* End of pcre2_glob.c */
@@ -235,6 +235,12 @@ allocated on the stack. */
 
 #define DFA_START_RWS_SIZE 30720
 
+/* In real-time matching, the caller's buffer takes the place of the heap (and
+of the JIT stack). Its start and size are rounded to this many bytes, which is
+enough for frames, workspace blocks, and JIT stacks on all platforms. */
+
+#define MATCH_BUFFER_ALIGN 16
+
 /* Define the default BSR convention. */
 
 #ifdef BSR_ANYCRLF
@@ -529,9 +535,22 @@ bytes in a code unit in that mode. */
 #define PCRE2_DUPCAPUSED    0x00200000  /* contains (?| */
 #define PCRE2_HASBKC        0x00400000  /* contains \C */
 #define PCRE2_HASACCEPT     0x00800000  /* contains (*ACCEPT) */
+#define PCRE2_HASRECURSE    0x01000000  /* contains recursion or subroutine */
+#define PCRE2_HASDUPREF     0x02000000  /* refers to a duplicated name */
+#define PCRE2_HASCALLOUT    0x04000000  /* contains a callout */
+#define PCRE2_HASCIRCM      0x08000000  /* contains multiline ^ */
 
 #define PCRE2_MODE_MASK     (PCRE2_MODE8 | PCRE2_MODE16 | PCRE2_MODE32)
 
+/* The bitmap of starting code units is needed by only a minority of patterns,
+so it is not part of the fixed pcre2_real_code header. When PCRE2_FIRSTMAPSET
+is set, it occupies the last 32 bytes of the compiled code's memory block,
+where copying and serialization carry it along with everything else. */
+
+#define START_BITMAP_SIZE   32
+#define START_BITMAP(re) \
+  ((const uint8_t *)(re) + (re)->blocksize - START_BITMAP_SIZE)
+
 /* Values for the matchedby field in a match data block. */
 
 enum { PCRE2_MATCHEDBY_INTERPRETER,     /* pcre2_match() */
@@ -541,6 +560,17 @@ enum { PCRE2_MATCHEDBY_INTERPRETER,     /* pcre2_match() */
 /* Values for the flags field in a match data block. */
 
 #define PCRE2_MD_COPIED_SUBJECT  0x01u
+#define PCRE2_MD_STATS           0x02u
+#define PCRE2_MD_PARTIAL         0x04u
+
+/* Indexes of the library-wide telemetry counters that are maintained when
+SUPPORT_TELEMETRY is defined. They are aggregated by pcre2_stats_snapshot(). */
+
+enum { TELEMETRY_COMPILES, TELEMETRY_COMPILE_ERRORS, TELEMETRY_COMPILE_NSEC,
+       TELEMETRY_JIT_COMPILES, TELEMETRY_INTERPRETER_MATCHES,
+       TELEMETRY_JIT_MATCHES, TELEMETRY_DFA_MATCHES, TELEMETRY_MATCH_LIMIT,
+       TELEMETRY_DEPTH_LIMIT, TELEMETRY_HEAP_LIMIT, TELEMETRY_JIT_STACK_LIMIT,
+       TELEMETRY_FRAME_REALLOCS, TELEMETRY_COUNT };
 
 /* Magic number to provide a small check against being handed junk. */
 
@@ -1801,12 +1831,20 @@ typedef struct {
   int16_t dummy;      /* spare - to round to multiple of 4 bytes */
 } ucd_record;
 
-/* UCD access macros */
+/* UCD access macros. The MultiStage2.py script writes the stage 2 blocks in
+the order in which they are first used, and no two of the blocks that cover
+the characters below UCD_DIRECT_LIMIT are the same. Each of those blocks is
+therefore mapped to itself by stage 1, so such characters can index stage 2
+directly, which saves one dependent load for most alphabetic scripts. The JIT
+compiler does the same, and checks the tables in debugging builds. */
 
 #define UCD_BLOCK_SIZE 128
+#define UCD_DIRECT_LIMIT 0x1000
 #define REAL_GET_UCD(ch) (PRIV(ucd_records) + \
+        (((int)(ch) / UCD_BLOCK_SIZE < UCD_DIRECT_LIMIT / UCD_BLOCK_SIZE)? \
+        PRIV(ucd_stage2)[(int)(ch)] : \
         PRIV(ucd_stage2)[PRIV(ucd_stage1)[(int)(ch) / UCD_BLOCK_SIZE] * \
-        UCD_BLOCK_SIZE + (int)(ch) % UCD_BLOCK_SIZE])
+        UCD_BLOCK_SIZE + (int)(ch) % UCD_BLOCK_SIZE]))
 
 #if PCRE2_CODE_UNIT_WIDTH == 32
 #define GET_UCD(ch) ((ch > MAX_UTF_CODE_POINT)? \
@@ -1823,6 +1861,12 @@ typedef struct {
 #define UCD_OTHERCASE(ch)   ((uint32_t)((int)ch + (int)(GET_UCD(ch)->other_case)))
 #define UCD_SCRIPTX(ch)     GET_UCD(ch)->scriptx
 
+/* Offsets of the 16-byte maps in PRIV(ucp_ascii_bits). */
+
+#define ucp_ascii_alnum      0
+#define ucp_ascii_space     16
+#define ucp_ascii_word      32
+
 /* Header for serialized pcre2 codes. */
 
 typedef struct pcre2_serialized_data {
@@ -1884,6 +1928,7 @@ extern const uint8_t          PRIV(utf8_table4)[];
 #define _pcre2_ucd_records             PCRE2_SUFFIX(_pcre2_ucd_records_)
 #define _pcre2_ucd_stage1              PCRE2_SUFFIX(_pcre2_ucd_stage1_)
 #define _pcre2_ucd_stage2              PCRE2_SUFFIX(_pcre2_ucd_stage2_)
+#define _pcre2_ucp_ascii_bits          PCRE2_SUFFIX(_pcre2_ucp_ascii_bits_)
 #define _pcre2_ucp_gbtable             PCRE2_SUFFIX(_pcre2_ucp_gbtable_)
 #define _pcre2_ucp_gentype             PCRE2_SUFFIX(_pcre2_ucp_gentype_)
 #define _pcre2_ucp_typerange           PCRE2_SUFFIX(_pcre2_ucp_typerange_)
@@ -1910,6 +1955,7 @@ extern const ucd_record                PRIV(dummy_ucd_record)[];
 #endif
 extern const uint16_t                  PRIV(ucd_stage1)[];
 extern const uint16_t                  PRIV(ucd_stage2)[];
+extern const uint8_t                   PRIV(ucp_ascii_bits)[];
 extern const uint32_t                  PRIV(ucp_gbtable)[];
 extern const uint32_t                  PRIV(ucp_gentype)[];
 #ifdef SUPPORT_JIT
@@ -1946,11 +1992,13 @@ is available. */
 #define _pcre2_find_bracket          PCRE2_SUFFIX(_pcre2_find_bracket_)
 #define _pcre2_is_newline            PCRE2_SUFFIX(_pcre2_is_newline_)
 #define _pcre2_jit_free_rodata       PCRE2_SUFFIX(_pcre2_jit_free_rodata_)
+#define _pcre2_jit_exec_size         PCRE2_SUFFIX(_pcre2_jit_exec_size_)
 #define _pcre2_jit_free              PCRE2_SUFFIX(_pcre2_jit_free_)
 #define _pcre2_jit_get_size          PCRE2_SUFFIX(_pcre2_jit_get_size_)
 #define _pcre2_jit_get_target        PCRE2_SUFFIX(_pcre2_jit_get_target_)
 #define _pcre2_memctl_malloc         PCRE2_SUFFIX(_pcre2_memctl_malloc_)
 #define _pcre2_ord2utf               PCRE2_SUFFIX(_pcre2_ord2utf_)
+#define _pcre2_partial_resume        PCRE2_SUFFIX(_pcre2_partial_resume_)
 #define _pcre2_script_run            PCRE2_SUFFIX(_pcre2_script_run_)
 #define _pcre2_strcmp                PCRE2_SUFFIX(_pcre2_strcmp_)
 #define _pcre2_strcmp_c8             PCRE2_SUFFIX(_pcre2_strcmp_c8_)
@@ -1973,11 +2021,14 @@ extern PCRE2_SPTR   _pcre2_find_bracket(PCRE2_SPTR, BOOL, int);
 extern BOOL         _pcre2_is_newline(PCRE2_SPTR, uint32_t, PCRE2_SPTR,
                       uint32_t *, BOOL);
 extern void         _pcre2_jit_free_rodata(void *, void *);
+extern size_t       _pcre2_jit_exec_size(void);
 extern void         _pcre2_jit_free(void *, pcre2_memctl *);
 extern size_t       _pcre2_jit_get_size(void *);
 const char *        _pcre2_jit_get_target(void);
 extern void *       _pcre2_memctl_malloc(size_t, pcre2_memctl *);
 extern unsigned int _pcre2_ord2utf(uint32_t, PCRE2_UCHAR *);
+extern PCRE2_SIZE   _pcre2_partial_resume(const pcre2_real_code *,
+                      pcre2_match_data *, PCRE2_SIZE, PCRE2_SIZE);
 extern BOOL         _pcre2_script_run(PCRE2_SPTR, PCRE2_SPTR, BOOL);
 extern int          _pcre2_strcmp(PCRE2_SPTR, PCRE2_SPTR);
 extern int          _pcre2_strcmp_c8(PCRE2_SPTR, const char *);
@@ -1985,12 +2036,23 @@ extern PCRE2_SIZE   _pcre2_strcpy_c8(PCRE2_UCHAR *, const char *);
 extern PCRE2_SIZE   _pcre2_strlen(PCRE2_SPTR);
 extern int          _pcre2_strncmp(PCRE2_SPTR, PCRE2_SPTR, size_t);
 extern int          _pcre2_strncmp_c8(PCRE2_SPTR, const char *, size_t);
-extern int          _pcre2_study(pcre2_real_code *);
+extern int          _pcre2_study(pcre2_real_code *, uint8_t *);
 extern int          _pcre2_valid_utf(PCRE2_SPTR, PCRE2_SIZE, PCRE2_SIZE *);
 extern BOOL         _pcre2_was_newline(PCRE2_SPTR, uint32_t, PCRE2_SPTR,
                       uint32_t *, BOOL);
 extern BOOL         _pcre2_xclass(uint32_t, PCRE2_SPTR, BOOL);
 
+/* These functions exist only when telemetry support is compiled. */
+
+#ifdef SUPPORT_TELEMETRY
+#define _pcre2_telemetry_add         PCRE2_SUFFIX(_pcre2_telemetry_add_)
+#define _pcre2_telemetry_clock       PCRE2_SUFFIX(_pcre2_telemetry_clock_)
+#define _pcre2_telemetry_match       PCRE2_SUFFIX(_pcre2_telemetry_match_)
+extern void         _pcre2_telemetry_add(int, uint64_t);
+extern uint64_t     _pcre2_telemetry_clock(void);
+extern void         _pcre2_telemetry_match(int, int);
+#endif
+
 /* This function is needed only when memmove() is not available. */
 
 #if !defined(VPCOMPAT) && !defined(HAVE_MEMMOVE)
@@ -581,6 +581,7 @@ typedef struct pcre2_real_match_context {
 #ifdef SUPPORT_JIT
   pcre2_jit_callback jit_callback;
   void *jit_callback_data;
+  pcre2_jit_stack_pool *jit_stack_pool;
 #endif
   int    (*callout)(pcre2_callout_block *, void *);
   void    *callout_data;
@@ -590,6 +591,11 @@ typedef struct pcre2_real_match_context {
   uint32_t heap_limit;
   uint32_t match_limit;
   uint32_t depth_limit;
+  uint32_t memo_limit;
+  uint32_t collect_stats;
+  pcre2_dfa_workspace *dfa_workspace;
+  void    *match_buffer;          /* Aligned real-time buffer, or NULL */
+  PCRE2_SIZE match_buffer_size;   /* Its usable size in bytes */
 } pcre2_real_match_context;
 
 /* The real convert context structure. */
@@ -619,7 +625,6 @@ typedef struct pcre2_real_code {
   pcre2_memctl memctl;            /* Memory control fields */
   const uint8_t *tables;          /* The character tables */
   void    *executable_jit;        /* Pointer to JIT code */
-  uint8_t  start_bitmap[32];      /* Bitmap for starting code unit < 256 */
   CODE_BLOCKSIZE_TYPE blocksize;  /* Total (bytes) that was malloc-ed */
   uint32_t magic_number;          /* Paranoid and endianness check */
   uint32_t compile_options;       /* Options passed to pcre2_compile() */
@@ -657,10 +662,13 @@ typedef struct pcre2_real_match_data {
   PCRE2_SIZE       leftchar;      /* Offset to leftmost code unit */
   PCRE2_SIZE       rightchar;     /* Offset to rightmost code unit */
   PCRE2_SIZE       startchar;     /* Offset to starting code unit */
+  PCRE2_SIZE       partial_offset; /* Starting offset for a partial match */
+  PCRE2_SIZE       partial_start; /* Offset where a partial match began */
   uint8_t          matchedby;     /* Type of match (normal, JIT, DFA) */
   uint8_t          flags;         /* Various flags */
   uint16_t         oveccount;     /* Number of pairs */
   int              rc;            /* The return code from the match */
+  pcre2_match_stats stats;        /* Statistics, if requested */
   PCRE2_SIZE       ovector[131072]; /* Must be last in the structure */
 } pcre2_real_match_data;
 
@@ -740,6 +748,7 @@ typedef struct compile_block {
   uint32_t *parsed_pattern;        /* Parsed pattern buffer */
   uint32_t *parsed_pattern_end;    /* Parsed pattern should not get here */
   uint32_t *groupinfo;             /* Group info vector */
+  struct compile_arena *arena;     /* Heap chunks for temporary vectors */
   uint32_t top_backref;            /* Maximum back reference */
   uint32_t backref_map;            /* Bitmap of low back refs */
   uint32_t nltype;                 /* Newline type */
@@ -763,6 +772,52 @@ typedef struct pcre2_real_jit_stack {
   void* stack;
 } pcre2_real_jit_stack;
 
+/* The real JIT stack pool structure. It is followed in the same memory block
+by a vector of slots, each of which holds a pointer to an idle JIT stack or
+NULL. The slots are spaced out so that each one is in its own cache line. */
+
+typedef struct pcre2_real_jit_stack_pool {
+  pcre2_memctl memctl;
+  PCRE2_SIZE startsize;           /* Start size for new stacks */
+  PCRE2_SIZE maxsize;             /* Maximum size for new stacks */
+  uint32_t slotcount;             /* Number of slots */
+} pcre2_real_jit_stack_pool;
+
+/* The real memory provider structure. The general context that is handed out
+to callers is embedded, and its memctl points back into the provider. */
+
+typedef struct pcre2_real_memory_provider {
+  pcre2_memctl memctl;                 /* For getting the provider itself */
+  pcre2_real_general_context gcontext; /* Routes allocations to the provider */
+  struct memory_chunk *chunks;         /* Arena chunks, current one first */
+  PCRE2_SIZE block_size;               /* Arena chunk size, mapping threshold */
+  uint32_t options;                    /* PCRE2_MEMORY_xxx options */
+} pcre2_real_memory_provider;
+
+/* The real compiled glob structure. It is followed in the same memory block
+by vectors of parts and items, the class data, and the literal code units,
+whose layout is private to pcre2_glob.c. */
+
+typedef struct pcre2_real_glob {
+  pcre2_memctl memctl;
+  uint32_t options;               /* PCRE2_CONVERT_xxx options */
+  uint32_t separator;             /* Path separator */
+  uint32_t part_count;            /* Number of parts */
+  uint32_t item_count;            /* Number of segment items */
+  uint32_t class_size;            /* Number of uint32_t words of class data */
+} pcre2_real_glob;
+
+/* The real DFA workspace structure. It holds on to the heap blocks of
+recursion workspace that pcre2_dfa_match() has obtained, so that later matches
+can use them again. The workspace vector of ints follows the structure in the
+same memory block. */
+
+typedef struct pcre2_real_dfa_workspace {
+  pcre2_memctl memctl;
+  void *rws_blocks;               /* Retained recursion workspace blocks */
+  PCRE2_SIZE wscount;             /* Number of ints in the vector */
+} pcre2_real_dfa_workspace;
+
 /* Structure for items in a linked list that represents an explicit recursive
 call within the pattern when running pcre_dfa_match(). */
 
@@ -789,6 +844,7 @@ typedef struct heapframe {
   PCRE2_SIZE length;         /* Used for character, string, or code lengths */
   PCRE2_SIZE back_frame;     /* Amount to subtract on RRETURN */
   PCRE2_SIZE temp_size;      /* Used for short-term PCRE2_SIZE values */
+  PCRE2_SIZE memo_bit;       /* Memo bitmap index of the frame's start */
   uint32_t rdepth;           /* "Recursion" depth */
   uint32_t group_frame_type; /* Type information for group frames */
   uint32_t temp_32[4];       /* Used for short-term 32-bit or BOOL values */
@@ -847,10 +903,14 @@ typedef struct match_block {
   heapframe *match_frames;        /* Points to vector of frames */
   heapframe *match_frames_top;    /* Points after the end of the vector */
   heapframe *stack_frames;        /* The original vector on the stack */
+  BOOL fixed_frames;              /* Vector is a real-time buffer; no heap */
   PCRE2_SIZE heap_limit;          /* As it says */
   uint32_t match_limit;           /* As it says */
   uint32_t match_limit_depth;     /* As it says */
   uint32_t match_call_count;      /* Number of times a new frame is created */
+  uint8_t *memo_bits;             /* Bitmap of known failures, or NULL */
+  PCRE2_SIZE memo_width;          /* Bits per code unit in memo_bits */
+  pcre2_match_stats *stats;       /* Statistics being collected */
   BOOL hitend;                    /* Hit the end of the subject at some point */
   BOOL hasthen;                   /* Pattern contains (*THEN) */
   BOOL allowemptypartial;         /* Allow empty hard partial */
@@ -916,6 +976,8 @@ typedef struct dfa_match_block {
   void *callout_data;             /* To pass back to callouts */
   int (*callout)(pcre2_callout_block *,void *);  /* Callout function or NULL */
   dfa_recursion_info *recursive;  /* Linked list of recursion data */
+  void *rws_top;                  /* Last workspace block counted in heap_used */
+  BOOL fixed_workspace;           /* Workspace is a real-time buffer; no heap */
 } dfa_match_block;
 
 #endif  /* PCRE2_PCRE2TEST */
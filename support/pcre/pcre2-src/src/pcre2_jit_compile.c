@@ -178,6 +178,7 @@ typedef struct jit_arguments {
   /* Pointers first. */
   struct sljit_stack *stack;
   PCRE2_SPTR str;
+  PCRE2_SPTR resume_ptr;
   PCRE2_SPTR begin;
   PCRE2_SPTR end;
   pcre2_match_data *match_data;
@@ -187,6 +188,8 @@ typedef struct jit_arguments {
   void *callout_data;
   /* Everything else after. */
   sljit_uw offset_limit;
+  sljit_uw stats_entries;
+  sljit_uw stats_backtracks;
   sljit_u32 limit_match;
   sljit_u32 oveccount;
   sljit_u32 options;
@@ -200,6 +203,7 @@ typedef struct executable_functions {
   sljit_uw executable_sizes[JIT_NUMBER_OF_COMPILE_MODES];
   sljit_u32 top_bracket;
   sljit_u32 limit_match;
+  BOOL collects_stats[JIT_NUMBER_OF_COMPILE_MODES];
 } executable_functions;
 
 typedef struct jump_list {
@@ -431,6 +435,8 @@ typedef struct compiler_common {
   BOOL has_then;
   /* (*SKIP) or (*SKIP:arg) is found in lookbehind assertion. */
   BOOL has_skip_in_assert_back;
+  /* Statistics are collected (PCRE2_JIT_STATS). */
+  BOOL stats;
   /* Quit is redirected by recurse, negative assertion, or positive assertion in conditional block. */
   BOOL local_quit_available;
   /* Currently in a positive assertion. */
@@ -582,6 +588,10 @@ typedef struct compare_context {
 #define POSSESSIVE1      (3 * sizeof(sljit_sw))
 /* Max limit of recursions. */
 #define LIMIT_MATCH      (4 * sizeof(sljit_sw))
+/* Statistics: start positions tried, and match limit units used by the
+previous start positions. These are present only with PCRE2_JIT_STATS. */
+#define STATS_ENTRIES    (5 * sizeof(sljit_sw))
+#define STATS_BACKTRACKS (6 * sizeof(sljit_sw))
 /* The output vector is stored on the stack, and contains pointers
 to characters. The vector data is divided into two groups: the first
 group contains the start / end character pointers, and the second is
@@ -5041,6 +5051,32 @@ OP_SRC(SLJIT_FAST_RETURN, RETURN_ADDR, 0);
 #define UCD_BLOCK_MASK 127
 #define UCD_BLOCK_SHIFT 7
 
+static void read_ucd_index(compiler_common *common)
+{
+/* Loads the index of the UCD record for the character in TMP1 into TMP2.
+Characters below UCD_DIRECT_LIMIT index stage 2 directly, the others go
+through stage 1 first. TMP1 is overwritten. */
+DEFINE_COMPILER;
+struct sljit_jump *jump;
+
+#if defined SLJIT_DEBUG && SLJIT_DEBUG
+int i;
+for (i = 0; i < UCD_DIRECT_LIMIT / UCD_BLOCK_SIZE; i++)
+  SLJIT_ASSERT(PRIV(ucd_stage1)[i] == i);
+#endif
+
+jump = CMP(SLJIT_LESS, TMP1, 0, SLJIT_IMM, UCD_DIRECT_LIMIT);
+OP2(SLJIT_LSHR, TMP2, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
+OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, 1);
+OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM1(TMP2), (sljit_sw)PRIV(ucd_stage1));
+OP2(SLJIT_AND, TMP1, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_MASK);
+OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
+OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, TMP2, 0);
+JUMPHERE(jump);
+OP1(SLJIT_MOV, TMP2, 0, SLJIT_IMM, (sljit_sw)PRIV(ucd_stage2));
+OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM2(TMP2, TMP1), 1);
+}
+
 static void do_getucd(compiler_common *common)
 {
 /* Search the UCD record for the character comes in TMP1.
@@ -5070,14 +5106,7 @@ if (!common->utf)
   }
 #endif
 
-OP2(SLJIT_LSHR, TMP2, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, 1);
-OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM1(TMP2), (sljit_sw)PRIV(ucd_stage1));
-OP2(SLJIT_AND, TMP1, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_MASK);
-OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, TMP2, 0);
-OP1(SLJIT_MOV, TMP2, 0, SLJIT_IMM, (sljit_sw)PRIV(ucd_stage2));
-OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM2(TMP2, TMP1), 1);
+read_ucd_index(common);
 OP_SRC(SLJIT_FAST_RETURN, RETURN_ADDR, 0);
 }
 
@@ -5110,14 +5139,7 @@ if (!common->utf)
   }
 #endif
 
-OP2(SLJIT_LSHR, TMP2, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, 1);
-OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM1(TMP2), (sljit_sw)PRIV(ucd_stage1));
-OP2(SLJIT_AND, TMP1, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_MASK);
-OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, TMP2, 0);
-OP1(SLJIT_MOV, TMP2, 0, SLJIT_IMM, (sljit_sw)PRIV(ucd_stage2));
-OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM2(TMP2, TMP1), 1);
+read_ucd_index(common);
 
 /* TMP2 is multiplied by 12. Same as (TMP2 << 2) + ((TMP2 << 2) << 1). */
 OP1(SLJIT_MOV, TMP1, 0, SLJIT_IMM, (sljit_sw)PRIV(ucd_records) + SLJIT_OFFSETOF(ucd_record, chartype));
@@ -6264,7 +6286,7 @@ static BOOL optimize_class(compiler_common *common, const sljit_u8 *bits, BOOL n
 static SLJIT_INLINE void fast_forward_start_bits(compiler_common *common)
 {
 DEFINE_COMPILER;
-const sljit_u8 *start_bits = common->re->start_bitmap;
+const sljit_u8 *start_bits = START_BITMAP(common->re);
 struct sljit_label *start;
 struct sljit_jump *partial_quit;
 #if PCRE2_CODE_UNIT_WIDTH != 8
@@ -7351,6 +7373,8 @@ BOOL charsaved = FALSE;
 int typereg = TMP1;
 const sljit_u32 *other_cases;
 sljit_uw typeoffset;
+sljit_u8 ascii_bits[32];
+sljit_u8 *ascii_map;
 #endif /* SUPPORT_UNICODE */
 
 /* Scanning the necessary info. */
@@ -7471,6 +7495,38 @@ else
 #endif /* SUPPORT_UNICODE */
   }
 
+#ifdef SUPPORT_UNICODE
+/* Whether an ASCII character is in the class is worked out now, so that the
+UCD lookup is needed only for other characters. For the common properties and
+scripts this usually comes down to a few range checks. */
+
+if (needstype || needsscript)
+  {
+  memset(ascii_bits, 0, sizeof(ascii_bits));
+  for (c = 0; c < 128; c++)
+    if (PRIV(xclass)((uint32_t)c, cc - 1, common->utf))
+      ascii_bits[c >> 3] |= (sljit_u8)(1 << (c & 0x7));
+
+  jump = CMP(SLJIT_GREATER, TMP1, 0, SLJIT_IMM, 127);
+  if (!optimize_class(common, ascii_bits, FALSE, TRUE, &found))
+    {
+    ascii_map = (sljit_u8 *)allocate_read_only_data(common, 16);
+    if (ascii_map == NULL)
+      return;
+    memcpy(ascii_map, ascii_bits, 16);
+
+    OP2(SLJIT_AND, TMP2, 0, TMP1, 0, SLJIT_IMM, 0x7);
+    OP2(SLJIT_LSHR, TMP1, 0, TMP1, 0, SLJIT_IMM, 3);
+    OP1(SLJIT_MOV_U8, TMP1, 0, SLJIT_MEM1(TMP1), (sljit_sw)ascii_map);
+    OP2(SLJIT_SHL, TMP2, 0, SLJIT_IMM, 1, TMP2, 0);
+    OP2(SLJIT_AND | SLJIT_SET_Z, SLJIT_UNUSED, 0, TMP1, 0, TMP2, 0);
+    add_jump(compiler, &found, JUMP(SLJIT_NOT_ZERO));
+    }
+  add_jump(compiler, backtracks, JUMP(SLJIT_JUMP));
+  JUMPHERE(jump);
+  }
+#endif /* SUPPORT_UNICODE */
+
 if ((cc[-1] & XCL_HASPROP) == 0)
   {
   if ((cc[-1] & XCL_MAP) != 0)
@@ -7543,21 +7599,15 @@ if (needstype || needsscript)
     }
 #endif /* PCRE2_CODE_UNIT_WIDTH == 32 */
 
-  OP2(SLJIT_LSHR, TMP2, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-  OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, 1);
-  OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM1(TMP2), (sljit_sw)PRIV(ucd_stage1));
-  OP2(SLJIT_AND, TMP1, 0, TMP1, 0, SLJIT_IMM, UCD_BLOCK_MASK);
-  OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, UCD_BLOCK_SHIFT);
-  OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, TMP2, 0);
-  OP1(SLJIT_MOV, TMP2, 0, SLJIT_IMM, (sljit_sw)PRIV(ucd_stage2));
-  OP1(SLJIT_MOV_U16, TMP2, 0, SLJIT_MEM2(TMP2, TMP1), 1);
+  read_ucd_index(common);
 
   /* Before anything else, we deal with scripts. */
   if (needsscript)
     {
-    OP2(SLJIT_SHL, TMP1, 0, TMP2, 0, SLJIT_IMM, 3);
-    OP2(SLJIT_SHL, TMP2, 0, TMP2, 0, SLJIT_IMM, 2);
+    /* TMP2 is still needed for the type, so it must not be changed. */
+    OP2(SLJIT_SHL, TMP1, 0, TMP2, 0, SLJIT_IMM, 1);
     OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, TMP2, 0);
+    OP2(SLJIT_SHL, TMP1, 0, TMP1, 0, SLJIT_IMM, 2);
 
     OP1(SLJIT_MOV_U8, TMP1, 0, SLJIT_MEM1(TMP1), (sljit_sw)PRIV(ucd_records) + SLJIT_OFFSETOF(ucd_record, script));
 
@@ -13357,7 +13407,7 @@ OP_SRC(SLJIT_FAST_RETURN, TMP2, 0);
 #undef CURRENT_AS
 
 #define PUBLIC_JIT_COMPILE_CONFIGURATION_OPTIONS \
-  (PCRE2_JIT_INVALID_UTF)
+  (PCRE2_JIT_INVALID_UTF|PCRE2_JIT_STATS)
 
 static int jit_compile(pcre2_code *code, sljit_u32 mode)
 {
@@ -13405,6 +13455,7 @@ rootbacktrack.cc = common->name_table + re->name_count * re->name_entry_size;
 #ifdef SUPPORT_UNICODE
 common->invalid_utf = (mode & PCRE2_JIT_INVALID_UTF) != 0;
 #endif /* SUPPORT_UNICODE */
+common->stats = (mode & PCRE2_JIT_STATS) != 0;
 mode &= ~PUBLIC_JIT_COMPILE_CONFIGURATION_OPTIONS;
 
 common->start = rootbacktrack.cc;
@@ -13480,7 +13531,8 @@ else
 ccend = bracketend(common->start);
 
 /* Calculate the local space size on the stack. */
-common->ovector_start = LIMIT_MATCH + sizeof(sljit_sw);
+common->ovector_start = (common->stats? STATS_BACKTRACKS : LIMIT_MATCH) +
+  sizeof(sljit_sw);
 common->optimized_cbracket = (sljit_u8 *)SLJIT_MALLOC(re->top_bracket + 1, allocator_data);
 if (!common->optimized_cbracket)
   return PCRE2_ERROR_NOMEMORY;
@@ -13562,7 +13614,11 @@ memset(common->private_data_ptrs, 0, total_length * sizeof(sljit_s32));
 
 private_data_size = common->cbra_ptr + (re->top_bracket + 1) * sizeof(sljit_sw);
 set_private_data_ptrs(common, &private_data_size, ccend);
-if ((re->overall_options & PCRE2_ANCHORED) == 0 && (re->overall_options & PCRE2_NO_START_OPTIMIZE) == 0 && !common->has_skip_in_assert_back)
+/* Early fail skips attempts by remembering where earlier ones failed, so a hard
+partial match would depend on where the search began, which must not change
+when it is resumed with PCRE2_PARTIAL_RESUME. */
+if ((re->overall_options & PCRE2_ANCHORED) == 0 && (re->overall_options & PCRE2_NO_START_OPTIMIZE) == 0 && !common->has_skip_in_assert_back
+    && mode != PCRE2_JIT_PARTIAL_HARD)
   detect_early_fail(common, common->start, &private_data_size, 0, 0);
 
 SLJIT_ASSERT(common->early_fail_start_ptr <= common->early_fail_end_ptr);
@@ -13600,7 +13656,9 @@ if (common->req_char_ptr != 0)
 
 OP1(SLJIT_MOV, ARGUMENTS, 0, SLJIT_S0, 0);
 OP1(SLJIT_MOV, TMP1, 0, SLJIT_S0, 0);
-OP1(SLJIT_MOV, STR_PTR, 0, SLJIT_MEM1(TMP1), SLJIT_OFFSETOF(jit_arguments, str));
+/* The first start position is usually str, but it is later when a partial
+match is resumed. */
+OP1(SLJIT_MOV, STR_PTR, 0, SLJIT_MEM1(TMP1), SLJIT_OFFSETOF(jit_arguments, resume_ptr));
 OP1(SLJIT_MOV, STR_END, 0, SLJIT_MEM1(TMP1), SLJIT_OFFSETOF(jit_arguments, end));
 OP1(SLJIT_MOV, TMP2, 0, SLJIT_MEM1(TMP1), SLJIT_OFFSETOF(jit_arguments, stack));
 OP1(SLJIT_MOV_U32, TMP1, 0, SLJIT_MEM1(TMP1), SLJIT_OFFSETOF(jit_arguments, limit_match));
@@ -13608,6 +13666,13 @@ OP1(SLJIT_MOV, STACK_TOP, 0, SLJIT_MEM1(TMP2), SLJIT_OFFSETOF(struct sljit_stack
 OP1(SLJIT_MOV, STACK_LIMIT, 0, SLJIT_MEM1(TMP2), SLJIT_OFFSETOF(struct sljit_stack, start));
 OP2(SLJIT_ADD, TMP1, 0, TMP1, 0, SLJIT_IMM, 1);
 OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), LIMIT_MATCH, TMP1, 0);
+if (common->stats)
+  {
+  /* Nothing is used before the first start position. */
+  OP1(SLJIT_MOV, COUNT_MATCH, 0, TMP1, 0);
+  OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), STATS_ENTRIES, SLJIT_IMM, 0);
+  OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), STATS_BACKTRACKS, SLJIT_IMM, 0);
+  }
 
 if (common->early_fail_start_ptr < common->early_fail_end_ptr)
   reset_early_fail(common);
@@ -13651,6 +13716,13 @@ if (common->req_char_ptr != 0)
 
 /* Store the current STR_PTR in OVECTOR(0). */
 OP1(SLJIT_MOV, SLJIT_MEM1(SLJIT_SP), OVECTOR(0), STR_PTR, 0);
+/* Update the statistics with the limit used by the previous start position. */
+if (common->stats)
+  {
+  OP2(SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), STATS_ENTRIES, SLJIT_MEM1(SLJIT_SP), STATS_ENTRIES, SLJIT_IMM, 1);
+  OP2(SLJIT_SUB, TMP2, 0, SLJIT_MEM1(SLJIT_SP), LIMIT_MATCH, COUNT_MATCH, 0);
+  OP2(SLJIT_ADD, SLJIT_MEM1(SLJIT_SP), STATS_BACKTRACKS, SLJIT_MEM1(SLJIT_SP), STATS_BACKTRACKS, TMP2, 0);
+  }
 /* Copy the limit of allowed recursions. */
 OP1(SLJIT_MOV, COUNT_MATCH, 0, SLJIT_MEM1(SLJIT_SP), LIMIT_MATCH);
 if (common->capture_last_ptr != 0)
@@ -13704,6 +13776,17 @@ if (common->abort != NULL)
 if (minlength_check_failed != NULL)
   SET_LABEL(minlength_check_failed, common->abort_label);
 
+/* Store the statistics. The return value is in TMP1. */
+if (common->stats)
+  {
+  OP2(SLJIT_SUB, TMP2, 0, SLJIT_MEM1(SLJIT_SP), LIMIT_MATCH, COUNT_MATCH, 0);
+  OP2(SLJIT_ADD, TMP2, 0, TMP2, 0, SLJIT_MEM1(SLJIT_SP), STATS_BACKTRACKS);
+  OP1(SLJIT_MOV, STR_PTR, 0, ARGUMENTS, 0);
+  OP1(SLJIT_MOV, SLJIT_MEM1(STR_PTR), SLJIT_OFFSETOF(jit_arguments, stats_backtracks), TMP2, 0);
+  OP1(SLJIT_MOV, TMP2, 0, SLJIT_MEM1(SLJIT_SP), STATS_ENTRIES);
+  OP1(SLJIT_MOV, SLJIT_MEM1(STR_PTR), SLJIT_OFFSETOF(jit_arguments, stats_entries), TMP2, 0);
+  }
+
 sljit_emit_op0(compiler, SLJIT_SKIP_FRAMES_BEFORE_RETURN);
 sljit_emit_return(compiler, SLJIT_MOV, SLJIT_RETURN_REG, 0);
 
@@ -14003,6 +14086,10 @@ SLJIT_ASSERT(mode < JIT_NUMBER_OF_COMPILE_MODES);
 functions->executable_funcs[mode] = executable_func;
 functions->read_only_data_heads[mode] = common->read_only_data_head;
 functions->executable_sizes[mode] = executable_size;
+functions->collects_stats[mode] = common->stats;
+#ifdef SUPPORT_TELEMETRY
+PRIV(telemetry_add)(TELEMETRY_JIT_COMPILES, 1);
+#endif
 return 0;
 }
 
@@ -14024,7 +14111,8 @@ Returns:        0: success or (*NOJIT) was used
 */
 
 #define PUBLIC_JIT_COMPILE_OPTIONS \
-  (PCRE2_JIT_COMPLETE|PCRE2_JIT_PARTIAL_SOFT|PCRE2_JIT_PARTIAL_HARD|PCRE2_JIT_INVALID_UTF)
+  (PCRE2_JIT_COMPLETE|PCRE2_JIT_PARTIAL_SOFT|PCRE2_JIT_PARTIAL_HARD|PCRE2_JIT_INVALID_UTF|\
+   PCRE2_JIT_STATS)
 
 PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_jit_compile(pcre2_code *code, uint32_t options)
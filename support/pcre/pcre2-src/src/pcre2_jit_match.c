@@ -44,6 +44,13 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #ifdef SUPPORT_JIT
 
+/* These are in pcre2_jit_misc.c, which is included after this file. */
+
+static pcre2_jit_stack *jit_stack_pool_lease(pcre2_jit_stack_pool *,
+  uint32_t *);
+static void jit_stack_pool_return(pcre2_jit_stack_pool *, pcre2_jit_stack *,
+  uint32_t);
+
 static SLJIT_NOINLINE int jit_machine_stack_exec(jit_arguments *arguments, jit_function executable_func)
 {
 sljit_u8 local_space[MACHINE_STACK_SIZE];
@@ -57,9 +64,133 @@ arguments->stack = &local_stack;
 return executable_func(arguments);
 }
 
+/* In real-time matching the caller's buffer is the stack. Running out of it is
+reported as it is by the interpreters. */
+
+static int jit_buffer_stack_exec(jit_arguments *arguments, jit_function executable_func, pcre2_match_context *mcontext)
+{
+sljit_u8 *buffer = (sljit_u8 *)mcontext->match_buffer;
+struct sljit_stack buffer_stack;
+int rc;
+
+buffer_stack.min_start = buffer;
+buffer_stack.start = buffer;
+buffer_stack.end = buffer + mcontext->match_buffer_size;
+buffer_stack.top = buffer + mcontext->match_buffer_size;
+arguments->stack = &buffer_stack;
+rc = executable_func(arguments);
+return (rc == PCRE2_ERROR_JIT_STACKLIMIT)? PCRE2_ERROR_HEAPLIMIT : rc;
+}
+
 #endif
 
 
+#ifdef SUPPORT_JIT
+
+/*************************************************
+*         Run one mode of the JIT code           *
+*************************************************/
+
+/* This sets up the arguments block and calls the compiled code for one of the
+modes, on the JIT stack from the match context or on the machine stack. The
+caller must have checked that the code for the mode exists. A real-time buffer
+in the match context takes precedence over everything else. Next comes a stack
+pool, which takes precedence over a stack or callback; a stack is leased from
+the pool for the duration of the call.
+
+Arguments:
+  re              points to the compiled expression
+  functions       the JIT data for the expression
+  index           the mode index (0 = complete, 1 = soft, 2 = hard partial)
+  subject         points to the subject string
+  length          length of subject string
+  start_offset    where to start in the subject string
+  resume_offset   the first starting position to try, normally start_offset
+  options         option bits
+  match_data      points to a match_data block
+  mcontext        points to a match context, or is NULL
+  arguments       the arguments block, which is left for the caller
+
+Returns:          the value returned by the compiled code
+*/
+
+static int
+jit_execute(pcre2_real_code *re, executable_functions *functions, int index,
+  PCRE2_SPTR subject, PCRE2_SIZE length, PCRE2_SIZE start_offset,
+  PCRE2_SIZE resume_offset, uint32_t options, pcre2_match_data *match_data,
+  pcre2_match_context *mcontext, jit_arguments *arguments)
+{
+pcre2_jit_stack *jit_stack;
+pcre2_jit_stack_pool *pool = NULL;
+uint32_t oveccount = match_data->oveccount;
+uint32_t slot = 0;
+int rc;
+union {
+   void *executable_func;
+   jit_function call_executable_func;
+} convert_executable_func;
+
+/* Sanity checks should be handled by pcre_exec. */
+arguments->str = subject + start_offset;
+arguments->resume_ptr = subject + resume_offset;
+arguments->begin = subject;
+arguments->end = subject + length;
+arguments->match_data = match_data;
+arguments->startchar_ptr = subject;
+arguments->mark_ptr = NULL;
+arguments->options = options;
+
+if (mcontext != NULL)
+  {
+  arguments->callout = mcontext->callout;
+  arguments->callout_data = mcontext->callout_data;
+  arguments->offset_limit = mcontext->offset_limit;
+  arguments->limit_match = (mcontext->match_limit < re->limit_match)?
+    mcontext->match_limit : re->limit_match;
+  if (mcontext->match_buffer != NULL)
+    jit_stack = NULL;
+  else if (mcontext->jit_stack_pool != NULL)
+    {
+    pool = mcontext->jit_stack_pool;
+    jit_stack = jit_stack_pool_lease(pool, &slot);
+    if (jit_stack == NULL) return PCRE2_ERROR_NOMEMORY;
+    }
+  else if (mcontext->jit_callback != NULL)
+    jit_stack = mcontext->jit_callback(mcontext->jit_callback_data);
+  else
+    jit_stack = (pcre2_jit_stack *)mcontext->jit_callback_data;
+  }
+else
+  {
+  arguments->callout = NULL;
+  arguments->callout_data = NULL;
+  arguments->offset_limit = PCRE2_UNSET;
+  arguments->limit_match = (MATCH_LIMIT < re->limit_match)?
+    MATCH_LIMIT : re->limit_match;
+  jit_stack = NULL;
+  }
+
+if (oveccount > functions->top_bracket)
+  oveccount = functions->top_bracket;
+arguments->oveccount = oveccount << 1;
+
+convert_executable_func.executable_func = functions->executable_funcs[index];
+if (jit_stack != NULL)
+  {
+  arguments->stack = (struct sljit_stack *)(jit_stack->stack);
+  rc = convert_executable_func.call_executable_func(arguments);
+  if (pool != NULL) jit_stack_pool_return(pool, jit_stack, slot);
+  return rc;
+  }
+if (mcontext != NULL && mcontext->match_buffer != NULL)
+  return jit_buffer_stack_exec(arguments,
+    convert_executable_func.call_executable_func, mcontext);
+return jit_machine_stack_exec(arguments, convert_executable_func.call_executable_func);
+}
+
+#endif  /* SUPPORT_JIT */
+
+
 /*************************************************
 *              Do a JIT pattern match            *
 *************************************************/
@@ -101,14 +232,9 @@ return PCRE2_ERROR_JIT_BADOPTION;
 
 pcre2_real_code *re = (pcre2_real_code *)code;
 executable_functions *functions = (executable_functions *)re->executable_jit;
-pcre2_jit_stack *jit_stack;
-uint32_t oveccount = match_data->oveccount;
-uint32_t max_oveccount;
-union {
-   void *executable_func;
-   jit_function call_executable_func;
-} convert_executable_func;
+uint32_t oveccount;
 jit_arguments arguments;
+PCRE2_SIZE resume_offset = start_offset;
 int rc;
 int index = 0;
 
@@ -120,53 +246,16 @@ else if ((options & PCRE2_PARTIAL_SOFT) != 0)
 if (functions == NULL || functions->executable_funcs[index] == NULL)
   return PCRE2_ERROR_JIT_BADOPTION;
 
-/* Sanity checks should be handled by pcre_exec. */
-arguments.str = subject + start_offset;
-arguments.begin = subject;
-arguments.end = subject + length;
-arguments.match_data = match_data;
-arguments.startchar_ptr = subject;
-arguments.mark_ptr = NULL;
-arguments.options = options;
+/* The checks for resuming a partial match are described in
+pcre2_match_data.c. */
 
-if (mcontext != NULL)
-  {
-  arguments.callout = mcontext->callout;
-  arguments.callout_data = mcontext->callout_data;
-  arguments.offset_limit = mcontext->offset_limit;
-  arguments.limit_match = (mcontext->match_limit < re->limit_match)?
-    mcontext->match_limit : re->limit_match;
-  if (mcontext->jit_callback != NULL)
-    jit_stack = mcontext->jit_callback(mcontext->jit_callback_data);
-  else
-    jit_stack = (pcre2_jit_stack *)mcontext->jit_callback_data;
-  }
-else
-  {
-  arguments.callout = NULL;
-  arguments.callout_data = NULL;
-  arguments.offset_limit = PCRE2_UNSET;
-  arguments.limit_match = (MATCH_LIMIT < re->limit_match)?
-    MATCH_LIMIT : re->limit_match;
-  jit_stack = NULL;
-  }
+if ((options & PCRE2_PARTIAL_RESUME) != 0)
+  resume_offset = PRIV(partial_resume)(re, match_data, start_offset, length);
 
+rc = jit_execute(re, functions, index, subject, length, start_offset,
+  resume_offset, options, match_data, mcontext, &arguments);
 
-max_oveccount = functions->top_bracket;
-if (oveccount > max_oveccount)
-  oveccount = max_oveccount;
-arguments.oveccount = oveccount << 1;
-
-
-convert_executable_func.executable_func = functions->executable_funcs[index];
-if (jit_stack != NULL)
-  {
-  arguments.stack = (struct sljit_stack *)(jit_stack->stack);
-  rc = convert_executable_func.call_executable_func(&arguments);
-  }
-else
-  rc = jit_machine_stack_exec(&arguments, convert_executable_func.call_executable_func);
-
+oveccount = arguments.oveccount >> 1;
 if (rc > (int)oveccount)
   rc = 0;
 match_data->code = re;
@@ -177,7 +266,35 @@ match_data->leftchar = 0;
 match_data->rightchar = 0;
 match_data->mark = arguments.mark_ptr;
 match_data->matchedby = PCRE2_MATCHEDBY_JIT;
+/* As in pcre2_match(), a hard partial match is recorded for
+PCRE2_PARTIAL_RESUME unless it started at the end of the subject. */
+
+if (rc == PCRE2_ERROR_PARTIAL && index == 2 &&
+    match_data->ovector[0] < length)
+  {
+  match_data->partial_offset = start_offset;
+  match_data->partial_start = match_data->ovector[0];
+  match_data->flags |= PCRE2_MD_PARTIAL;
+  }
+else match_data->flags &= ~PCRE2_MD_PARTIAL;
 
+/* JIT code that was compiled with PCRE2_JIT_STATS counts the start positions
+that it tries and the units of the match limit that it uses, which stand in
+for backtracks. No other statistics are available. */
+
+if (mcontext != NULL && mcontext->collect_stats &&
+    functions->collects_stats[index])
+  {
+  memset(&match_data->stats, 0, sizeof(pcre2_match_stats));
+  match_data->stats.start_positions = arguments.stats_entries;
+  match_data->stats.backtracks = arguments.stats_backtracks;
+  match_data->flags |= PCRE2_MD_STATS;
+  }
+else match_data->flags &= ~PCRE2_MD_STATS;
+
+#ifdef SUPPORT_TELEMETRY
+PRIV(telemetry_match)(TELEMETRY_JIT_MATCHES, rc);
+#endif
 return match_data->rc;
 
 #endif  /* SUPPORT_JIT */
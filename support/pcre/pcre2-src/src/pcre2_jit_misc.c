@@ -99,6 +99,30 @@ SLJIT_FREE(functions, allocator_data);
 }
 
 
+/*************************************************
+*        Get size of JIT executable memory       *
+*************************************************/
+
+/* Returns the number of bytes of executable memory currently handed out by the
+JIT allocator for this library, or zero when the built-in allocator is not
+used. */
+
+size_t
+PRIV(jit_exec_size)(void)
+{
+#if defined SUPPORT_JIT && \
+    (defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
+size_t size;
+allocator_grab_lock();
+size = allocated_size;
+allocator_release_lock();
+return size;
+#else
+return 0;
+#endif
+}
+
+
 /*************************************************
 *            Free unused JIT memory              *
 *************************************************/
@@ -197,6 +221,247 @@ if (jit_stack != NULL)
 }
 
 
+#ifdef SUPPORT_JIT
+
+/* Idle stacks are kept in the slots of a pool without locking. A stack is
+taken by atomically exchanging a non-empty slot with NULL, and given back by
+atomically filling a slot that is NULL. As a slot is never changed from one
+stack to another directly, there is no ABA problem. Where no atomic operations
+are known, the lock of the JIT memory allocator is used instead. */
+
+#define POOL_SLOT_SIZE 64     /* Spacing of the slots (a cache line) */
+#define POOL_MAX_SLOTS 65536  /* Keeps the pool's size reasonable */
+#define POOL_SLOT(pool, i) ((void * volatile *)((char *)(pool) + \
+  sizeof(pcre2_real_jit_stack_pool) + (PCRE2_SIZE)(i) * POOL_SLOT_SIZE))
+
+#if defined _WIN32
+#include <windows.h>
+#elif !defined __GNUC__ && \
+  !(defined SLJIT_EXECUTABLE_ALLOCATOR && SLJIT_EXECUTABLE_ALLOCATOR)
+#define POOL_NOT_SUPPORTED
+#endif
+
+
+/*************************************************
+*    Look at, take, or fill a stack pool slot    *
+*************************************************/
+
+/* Looking first avoids writing to the cache lines of slots that are no use. */
+
+static void *
+pool_slot_peek(void * volatile *slot)
+{
+#if defined __ATOMIC_RELAXED
+return __atomic_load_n(slot, __ATOMIC_RELAXED);
+#else
+return *slot;
+#endif
+}
+
+static void *
+pool_slot_take(void * volatile *slot)
+{
+#if defined _WIN32
+return InterlockedExchangePointer((PVOID volatile *)slot, NULL);
+#elif defined __ATOMIC_ACQ_REL
+return __atomic_exchange_n(slot, NULL, __ATOMIC_ACQ_REL);
+#elif defined __GNUC__
+void *stack;
+do stack = *slot;
+  while (stack != NULL && !__sync_bool_compare_and_swap(slot, stack, NULL));
+return stack;
+#elif !defined POOL_NOT_SUPPORTED
+void *stack;
+allocator_grab_lock();
+stack = *slot;
+*slot = NULL;
+allocator_release_lock();
+return stack;
+#else
+(void)slot;
+return NULL;
+#endif
+}
+
+static BOOL
+pool_slot_fill(void * volatile *slot, void *stack)
+{
+#if defined _WIN32
+return InterlockedCompareExchangePointer((PVOID volatile *)slot, stack, NULL)
+  == NULL;
+#elif defined __ATOMIC_ACQ_REL
+void *expected = NULL;
+return __atomic_compare_exchange_n(slot, &expected, stack, 0, __ATOMIC_ACQ_REL,
+  __ATOMIC_RELAXED);
+#elif defined __GNUC__
+return __sync_bool_compare_and_swap(slot, NULL, stack);
+#elif !defined POOL_NOT_SUPPORTED
+BOOL filled;
+allocator_grab_lock();
+filled = *slot == NULL;
+if (filled) *slot = stack;
+allocator_release_lock();
+return filled;
+#else
+(void)slot;
+(void)stack;
+return FALSE;
+#endif
+}
+
+
+/*************************************************
+*       Lease and return a pooled JIT stack      *
+*************************************************/
+
+/* A search for an idle stack, or for an empty slot, starts at a slot that is
+chosen from the address of a local variable. Threads run on different machine
+stacks, so they tend to use different slots (avoiding contention for the same
+cache line), and a thread tends to get back the stack that it used last. If
+there is no idle stack, a new one is created, and if there is no empty slot for
+a returned stack, it is freed. So the pool grows on demand, and it holds at
+most one stack per slot while no matches are running.
+
+Arguments:
+  pool        the pool
+  startptr    where to put the starting slot, for passing to the return
+
+Returns:      a stack, or NULL if a new stack could not be created
+*/
+
+static pcre2_jit_stack *
+jit_stack_pool_lease(pcre2_jit_stack_pool *pool, uint32_t *startptr)
+{
+char local;
+uint32_t hash = (uint32_t)((size_t)&local >> 16) * 0x9e3779b1u;
+uint32_t start = (hash >> 16) % pool->slotcount;
+uint32_t i = start;
+
+*startptr = start;
+do
+  {
+  void * volatile *slot = POOL_SLOT(pool, i);
+  if (pool_slot_peek(slot) != NULL)
+    {
+    void *stack = pool_slot_take(slot);
+    if (stack != NULL) return (pcre2_jit_stack *)stack;
+    }
+  if (++i >= pool->slotcount) i = 0;
+  }
+while (i != start);
+
+return pcre2_jit_stack_create(pool->startsize, pool->maxsize,
+  (pcre2_general_context *)(&pool->memctl));
+}
+
+
+static void
+jit_stack_pool_return(pcre2_jit_stack_pool *pool, pcre2_jit_stack *jit_stack,
+  uint32_t start)
+{
+uint32_t i = start;
+do
+  {
+  void * volatile *slot = POOL_SLOT(pool, i);
+  if (pool_slot_peek(slot) == NULL && pool_slot_fill(slot, jit_stack)) return;
+  if (++i >= pool->slotcount) i = 0;
+  }
+while (i != start);
+
+pcre2_jit_stack_free(jit_stack);
+}
+
+#endif  /* SUPPORT_JIT */
+
+
+
+/*************************************************
+*          Create a pool of JIT stacks           *
+*************************************************/
+
+/* The pool starts empty; stacks are created when matches need them.
+
+Arguments:
+  startsize   the start size of each stack
+  maxsize     the maximum size of each stack
+  slotcount   the maximum number of idle stacks that are kept
+  gcontext    a general context, or NULL
+
+Returns:      the pool, or NULL on error
+*/
+
+PCRE2_EXP_DEFN pcre2_jit_stack_pool * PCRE2_CALL_CONVENTION
+pcre2_jit_stack_pool_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
+  uint32_t slotcount, pcre2_general_context *gcontext)
+{
+#if !defined SUPPORT_JIT || defined POOL_NOT_SUPPORTED
+
+(void)startsize;
+(void)maxsize;
+(void)slotcount;
+(void)gcontext;
+return NULL;
+
+#else  /* SUPPORT_JIT */
+
+pcre2_jit_stack_pool *pool;
+PCRE2_SIZE size;
+
+if (startsize < 1 || maxsize < 1 || slotcount < 1 ||
+    slotcount > POOL_MAX_SLOTS)
+  return NULL;
+
+size = sizeof(pcre2_real_jit_stack_pool) + slotcount * POOL_SLOT_SIZE;
+pool = PRIV(memctl_malloc)(size, (pcre2_memctl *)gcontext);
+if (pool == NULL) return NULL;
+memset((char *)pool + sizeof(pcre2_memctl), 0, size - sizeof(pcre2_memctl));
+pool->startsize = startsize;
+pool->maxsize = maxsize;
+pool->slotcount = slotcount;
+return pool;
+
+#endif  /* SUPPORT_JIT */
+}
+
+
+/*************************************************
+*      Assign a pool of JIT stacks to matches    *
+*************************************************/
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_jit_stack_pool_assign(pcre2_match_context *mcontext,
+  pcre2_jit_stack_pool *pool)
+{
+#ifndef SUPPORT_JIT
+(void)mcontext;
+(void)pool;
+#else  /* SUPPORT_JIT */
+if (mcontext != NULL) mcontext->jit_stack_pool = pool;
+#endif  /* SUPPORT_JIT */
+}
+
+
+/*************************************************
+*           Free a pool of JIT stacks            *
+*************************************************/
+
+/* No match may be using the pool at this time. */
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_jit_stack_pool_free(pcre2_jit_stack_pool *pool)
+{
+#ifndef SUPPORT_JIT
+(void)pool;
+#else  /* SUPPORT_JIT */
+uint32_t i;
+if (pool == NULL) return;
+for (i = 0; i < pool->slotcount; i++)
+  pcre2_jit_stack_free((pcre2_jit_stack *)(*POOL_SLOT(pool, i)));
+pool->memctl.free(pool, pool->memctl.memory_data);
+#endif  /* SUPPORT_JIT */
+}
+
+
 /*************************************************
 *               Get target CPU type              *
 *************************************************/
@@ -96,6 +96,7 @@ static int regression_tests(void);
 static int invalid_utf8_regression_tests(void);
 static int invalid_utf16_regression_tests(void);
 static int invalid_utf32_regression_tests(void);
+static int jit_stack_pool_tests(void);
 
 int main(void)
 {
@@ -114,7 +115,8 @@ int main(void)
 	return regression_tests()
 		| invalid_utf8_regression_tests()
 		| invalid_utf16_regression_tests()
-		| invalid_utf32_regression_tests();
+		| invalid_utf32_regression_tests()
+		| jit_stack_pool_tests();
 }
 
 /* --------------------------------------------------------------------------------------- */
@@ -2484,4 +2486,132 @@ static int invalid_utf32_regression_tests(void)
 
 #endif /* SUPPORT_UNICODE && SUPPORT_PCRE2_32 */
 
+#if defined SUPPORT_PCRE2_8
+
+/* The pattern needs more stack than the default 32K machine stack, so it
+fails without a JIT stack and matches with one leased from a pool. The callout
+matches again, recursively, to lease more stacks at once than the pool keeps. */
+
+#define POOL_SUBJECT_LENGTH 10000
+#define POOL_SLOTS 2
+#define POOL_NESTING 4
+
+struct pool_test_data {
+	pcre2_code_8 *re;
+	pcre2_match_context_8 *mcontext;
+	const char *subject;
+	int depth;
+	int failures;
+};
+
+static int pool_callout(pcre2_callout_block_8 *block, void *arg)
+{
+	struct pool_test_data *data = (struct pool_test_data *)arg;
+	pcre2_match_data_8 *mdata;
+	int result;
+
+	(void)block;
+	if (data->depth >= POOL_NESTING)
+		return 0;
+
+	data->depth++;
+	mdata = pcre2_match_data_create_from_pattern_8(data->re, NULL);
+	result = pcre2_jit_match_8(data->re, (PCRE2_SPTR8)data->subject, POOL_SUBJECT_LENGTH,
+		0, 0, mdata, data->mcontext);
+	if (result != 2)
+		data->failures++;
+	pcre2_match_data_free_8(mdata);
+	data->depth--;
+	return 0;
+}
+
+static int jit_stack_pool_tests(void)
+{
+	struct pool_test_data data;
+	pcre2_jit_stack_pool_8 *pool;
+	pcre2_match_data_8 *mdata;
+	char *subject;
+	int error, result, i;
+	int total = 0, successful = 0;
+	PCRE2_SIZE err_offs;
+
+	printf("\nRunning JIT stack pool tests\n");
+
+	subject = (char *)malloc(POOL_SUBJECT_LENGTH);
+	for (i = 0; i < POOL_SUBJECT_LENGTH - 1; i++)
+		subject[i] = (i & 0x1) ? 'a' : 'b';
+	subject[POOL_SUBJECT_LENGTH - 1] = 'c';
+
+	data.re = pcre2_compile_8((PCRE2_SPTR8)"(?C1)(?:(a)|b)*c", PCRE2_ZERO_TERMINATED,
+		0, &error, &err_offs, NULL);
+	data.mcontext = pcre2_match_context_create_8(NULL);
+	data.subject = subject;
+	data.depth = 0;
+	data.failures = 0;
+	pool = pcre2_jit_stack_pool_create_8(32 * 1024, 1024 * 1024, POOL_SLOTS, NULL);
+	mdata = pcre2_match_data_create_8(2, NULL);
+
+	if (!data.re || pcre2_jit_compile_8(data.re, PCRE2_JIT_COMPLETE) != 0 || !pool) {
+		printf("Cannot set up the JIT stack pool tests\n");
+		return 1;
+	}
+
+	/* Without a pool the machine stack is too small. */
+	total++;
+	result = pcre2_jit_match_8(data.re, (PCRE2_SPTR8)subject, POOL_SUBJECT_LENGTH, 0, 0,
+		mdata, data.mcontext);
+	if (result == PCRE2_ERROR_JIT_STACKLIMIT)
+		successful++;
+	else
+		printf("Match without a pool returns %d\n", result);
+
+	/* With the pool, without and with nested matches. */
+	pcre2_jit_stack_pool_assign_8(data.mcontext, pool);
+	for (i = 0; i < 2; i++) {
+		total++;
+		data.depth = (i == 0) ? POOL_NESTING : 0;
+		pcre2_set_callout_8(data.mcontext, pool_callout, &data);
+		result = pcre2_jit_match_8(data.re, (PCRE2_SPTR8)subject, POOL_SUBJECT_LENGTH, 0, 0,
+			mdata, data.mcontext);
+		if (result == 2 && data.failures == 0)
+			successful++;
+		else
+			printf("Match with a pool (nesting %d) returns %d, %d nested failures\n",
+				i == 0 ? 0 : POOL_NESTING, result, data.failures);
+	}
+
+	/* Removing the pool restores the default. */
+	total++;
+	pcre2_jit_stack_pool_assign_8(data.mcontext, NULL);
+	result = pcre2_jit_match_8(data.re, (PCRE2_SPTR8)subject, POOL_SUBJECT_LENGTH, 0, 0,
+		mdata, data.mcontext);
+	if (result == PCRE2_ERROR_JIT_STACKLIMIT)
+		successful++;
+	else
+		printf("Match after removing the pool returns %d\n", result);
+
+	pcre2_match_data_free_8(mdata);
+	pcre2_match_context_free_8(data.mcontext);
+	pcre2_jit_stack_pool_free_8(pool);
+	pcre2_code_free_8(data.re);
+	free(subject);
+
+	if (total == successful) {
+		printf("All JIT stack pool tests are successfully passed.\n");
+		return 0;
+	} else {
+		printf("JIT stack pool successful test ratio: %d%% (%d failed)\n", successful * 100 / total, total - successful);
+		return 1;
+	}
+}
+
+#else /* !SUPPORT_PCRE2_8 */
+
+static int jit_stack_pool_tests(void)
+{
+	return 0;
+}
+
+#endif /* SUPPORT_PCRE2_8 */
+
 /* End of pcre2_jit_test.c */
@@ -39,6 +39,12 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 
+/* This file includes itself once, with PROFILED_MATCH defined, in order to
+compile a second, instrumented copy of the match() function. Only that function
+is compiled the second time round. */
+
+#ifndef PROFILED_MATCH
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -69,12 +75,13 @@ information, and fields within it. */
 #define PUBLIC_MATCH_OPTIONS \
   (PCRE2_ANCHORED|PCRE2_ENDANCHORED|PCRE2_NOTBOL|PCRE2_NOTEOL|PCRE2_NOTEMPTY| \
    PCRE2_NOTEMPTY_ATSTART|PCRE2_NO_UTF_CHECK|PCRE2_PARTIAL_HARD| \
-   PCRE2_PARTIAL_SOFT|PCRE2_NO_JIT|PCRE2_COPY_MATCHED_SUBJECT)
+   PCRE2_PARTIAL_SOFT|PCRE2_NO_JIT|PCRE2_COPY_MATCHED_SUBJECT| \
+   PCRE2_PARTIAL_RESUME)
 
 #define PUBLIC_JIT_MATCH_OPTIONS \
    (PCRE2_NO_UTF_CHECK|PCRE2_NOTBOL|PCRE2_NOTEOL|PCRE2_NOTEMPTY|\
     PCRE2_NOTEMPTY_ATSTART|PCRE2_PARTIAL_SOFT|PCRE2_PARTIAL_HARD|\
-    PCRE2_COPY_MATCHED_SUBJECT)
+    PCRE2_COPY_MATCHED_SUBJECT|PCRE2_PARTIAL_RESUME)
 
 /* Non-error returns from and within the match() function. Error returns are
 externally defined PCRE2_ERROR_xxx codes, which are all negative. */
@@ -328,6 +335,126 @@ return rc;
 
 
 
+/*************************************************
+*   Check whether a pattern can be memoized      *
+*************************************************/
+
+/* Memoizing failures at (code, subject) positions is valid only if the
+outcome of matching from such a position does not depend on how it was
+reached. This rules out back references, recursion, conditions that test
+groups, callouts, backtracking control verbs, script runs, non-atomic
+assertions, and repeated groups that may match an empty string (because the
+test that breaks the repetition looks at where the group started).
+
+Arguments:
+  code        points to start of the compiled code
+  utf         TRUE in UTF mode
+
+Returns:      TRUE if memoizing is safe for this pattern
+*/
+
+static BOOL
+memo_allowed(PCRE2_SPTR code, BOOL utf)
+{
+for (;;)
+  {
+  PCRE2_UCHAR c = *code;
+
+  switch(c)
+    {
+    case OP_END:
+    return TRUE;
+
+    case OP_CALLOUT:
+    case OP_CALLOUT_STR:
+    case OP_REF:
+    case OP_REFI:
+    case OP_DNREF:
+    case OP_DNREFI:
+    case OP_RECURSE:
+    case OP_CREF:
+    case OP_DNCREF:
+    case OP_RREF:
+    case OP_DNRREF:
+    case OP_MARK:
+    case OP_COMMIT:
+    case OP_COMMIT_ARG:
+    case OP_PRUNE:
+    case OP_PRUNE_ARG:
+    case OP_SKIP:
+    case OP_SKIP_ARG:
+    case OP_THEN:
+    case OP_THEN_ARG:
+    case OP_ACCEPT:
+    case OP_ASSERT_ACCEPT:
+    case OP_SCRIPT_RUN:
+    case OP_ASSERT_NA:
+    case OP_ASSERTBACK_NA:
+    case OP_SBRA:
+    case OP_SCBRA:
+    case OP_SCOND:
+    case OP_SBRAPOS:
+    case OP_SCBRAPOS:
+    return FALSE;
+
+    /* A repeated group must be one that cannot match an empty string, and
+    whose starting frame is not consulted at the ket. */
+
+    case OP_KETRMAX:
+    case OP_KETRMIN:
+      {
+      PCRE2_UCHAR b = *(code - GET(code, 1));
+      if (b != OP_BRA && b != OP_CBRA && b != OP_COND) return FALSE;
+      }
+    break;
+
+    default:
+    break;
+    }
+
+  /* Skip over the item; this follows PRIV(find_bracket)(). */
+
+  if (c == OP_XCLASS)
+    {
+    code += GET(code, 1);
+    continue;
+    }
+
+  switch(c)
+    {
+    case OP_TYPESTAR:
+    case OP_TYPEMINSTAR:
+    case OP_TYPEPLUS:
+    case OP_TYPEMINPLUS:
+    case OP_TYPEQUERY:
+    case OP_TYPEMINQUERY:
+    case OP_TYPEPOSSTAR:
+    case OP_TYPEPOSPLUS:
+    case OP_TYPEPOSQUERY:
+    if (code[1] == OP_PROP || code[1] == OP_NOTPROP) code += 2;
+    break;
+
+    case OP_TYPEUPTO:
+    case OP_TYPEMINUPTO:
+    case OP_TYPEEXACT:
+    case OP_TYPEPOSUPTO:
+    if (code[1 + IMM2_SIZE] == OP_PROP || code[1 + IMM2_SIZE] == OP_NOTPROP)
+      code += 2;
+    break;
+    }
+
+  code += PRIV(OP_lengths)[c];
+
+#ifdef MAYBE_UTF_MULTI
+  if (utf && c >= OP_CHAR && c <= OP_NOTPOSUPTOI && HAS_EXTRALEN(code[-1]))
+    code += GET_EXTRALEN(code[-1]);
+#else
+  (void)(utf);  /* Keep compiler happy by referencing function argument */
+#endif
+  }
+}
+
+
 /*************************************************
 *          Match a back-reference                *
 *************************************************/
@@ -475,6 +602,64 @@ return 0;  /* Match */
 
 
 
+#ifdef SUPPORT_UNICODE
+/*************************************************
+*        Match a run of ASCII characters         *
+*************************************************/
+
+/* A character less than 128 is always a single code unit, and whether it is
+in a class or has one of the common Unicode properties can be read from a
+bitmap, without decoding it or looking it up in the UCD. This function is used
+by the repeat loops in UTF and UCP modes to match runs of such characters. In
+the 8-bit library the subject is first checked a word at a time, so that blocks
+of ASCII text are matched with no per-character test for a multi-unit
+character.
+
+Arguments:
+  eptr        points to the first character
+  end         end of the subject
+  map         bitmap of the ASCII characters that are in the class
+  notmatch    TRUE if the characters in the map are those that do not match
+  max         maximum number of characters to match
+
+Returns:      pointer after the last matching character; this is at a
+                non-ASCII or non-matching character, or at the end
+*/
+
+static PCRE2_SPTR
+match_ascii_run(PCRE2_SPTR eptr, PCRE2_SPTR end, const uint8_t *map,
+  BOOL notmatch, uint32_t max)
+{
+#define ASCII_MATCHES(c) (((map[(c)/8] & (1u << ((c)&7))) != 0) != notmatch)
+
+#if PCRE2_CODE_UNIT_WIDTH == 8
+const size_t highbits = ~(size_t)0 / 0xff * 0x80;
+
+while (max >= sizeof(size_t) && (size_t)(end - eptr) >= sizeof(size_t))
+  {
+  size_t word, i;
+  memcpy(&word, eptr, sizeof(size_t));
+  if ((word & highbits) != 0) break;
+  for (i = 0; i < sizeof(size_t); i++)
+    if (!ASCII_MATCHES(eptr[i])) return eptr + i;
+  eptr += sizeof(size_t);
+  max -= sizeof(size_t);
+  }
+#endif
+
+while (max > 0 && eptr < end && *eptr < 128 && ASCII_MATCHES(*eptr))
+  {
+  eptr++;
+  max--;
+  }
+return eptr;
+
+#undef ASCII_MATCHES
+}
+#endif  /* SUPPORT_UNICODE */
+
+
+
 /******************************************************************************
 *******************************************************************************
                    "Recursion" in the match() function
@@ -548,6 +733,17 @@ remember the backtracking points. */
   goto RETURN_SWITCH;\
   }
 
+/* The match() function is compiled twice. The normal copy is called match()
+and has PROFILING set to 0, so that the code that collects statistics is
+optimized away. The second copy, compiled when this file includes itself below,
+is called match_profiled() and is used only when statistics have been requested
+by pcre2_set_match_stats(). */
+
+#define MATCH_FUNCTION match
+#define PROFILING 0
+
+#endif  /* PROFILED_MATCH */
+
 
 
 /*************************************************
@@ -567,7 +763,7 @@ Arguments:
    start_ecode  starting position in compiled code
    ovector      pointer to the final output vector
    oveccount    number of pairs in ovector
-   top_bracket  number of capturing parentheses in the pattern
+   frame_groups number of capturing groups kept in each frame
    frame_size   size of each backtracking frame
    mb           pointer to "static" variables block
 
@@ -579,8 +775,8 @@ Returns:        MATCH_MATCH if matched            )  these values are >= 0
 */
 
 static int
-match(PCRE2_SPTR start_eptr, PCRE2_SPTR start_ecode, PCRE2_SIZE *ovector,
-  uint16_t oveccount, uint16_t top_bracket, PCRE2_SIZE frame_size,
+MATCH_FUNCTION(PCRE2_SPTR start_eptr, PCRE2_SPTR start_ecode, PCRE2_SIZE *ovector,
+  uint16_t oveccount, uint16_t frame_groups, PCRE2_SIZE frame_size,
   match_block *mb)
 {
 /* Frame-handling variables */
@@ -590,6 +786,7 @@ heapframe *N = NULL;    /* Temporary frame pointers */
 heapframe *P = NULL;
 heapframe *assert_accept_frame = NULL;  /* For passing back a frame with captures */
 PCRE2_SIZE frame_copy_size;     /* Amount to copy when creating a new frame */
+PCRE2_SIZE memo_bit = 0;        /* Memo bitmap index for a new frame */
 
 /* Local variables that do not need to be preserved over calls to RRMATCH(). */
 
@@ -645,8 +842,38 @@ backtracking point. */
 
 MATCH_RECURSE:
 
+/* When failures are being memoized, there is no need to create a frame for a
+code position and subject position from which a match is already known to be
+impossible. Proceed as if such a frame had returned MATCH_NOMATCH.
+
+A frame that starts a branch of an atomic group or a positive assertion is
+neither checked nor recorded. When the group matches, its frames are discarded
+and the loop that tries its branches is made to give up, so a failure that
+happens later is returned to that loop as if the branch had failed. Replaying
+it would let the loop go on to try the remaining branches. */
+
+if (mb->memo_bits != NULL)
+  {
+  if (group_frame_type == (GF_NOCAPTURE | OP_ONCE) ||
+      group_frame_type == (GF_NOCAPTURE | OP_ASSERT) ||
+      group_frame_type == (GF_NOCAPTURE | OP_ASSERTBACK))
+    memo_bit = PCRE2_UNSET;
+  else
+    {
+    memo_bit = (PCRE2_SIZE)(start_ecode - mb->start_code) * mb->memo_width +
+      (PCRE2_SIZE)(Feptr - mb->start_subject);
+    if ((mb->memo_bits[memo_bit/8] & (1u << (memo_bit%8))) != 0)
+      {
+      group_frame_type = 0;
+      rrc = MATCH_NOMATCH;
+      goto RETURN_DISPATCH;
+      }
+    }
+  }
+
 /* Set up a new backtracking frame. If the vector is full, get a new one
-on the heap, doubling the size, but constrained by the heap limit. */
+on the heap, doubling the size, but constrained by the heap limit. A vector in
+a real-time buffer cannot be replaced. */
 
 N = (heapframe *)((char *)F + frame_size);
 if (N >= mb->match_frames_top)
@@ -654,6 +881,7 @@ if (N >= mb->match_frames_top)
   PCRE2_SIZE newsize = mb->frame_vector_size * 2;
   heapframe *new;
 
+  if (mb->fixed_frames) return PCRE2_ERROR_HEAPLIMIT;
   if ((newsize / 1024) > mb->heap_limit)
     {
     PCRE2_SIZE maxsize = ((mb->heap_limit * 1024)/frame_size) * frame_size;
@@ -673,6 +901,9 @@ if (N >= mb->match_frames_top)
   mb->match_frames = new;
   mb->match_frames_top = (heapframe *)((char *)mb->match_frames + newsize);
   mb->frame_vector_size = newsize;
+#ifdef SUPPORT_TELEMETRY
+  PRIV(telemetry_add)(TELEMETRY_FRAME_REALLOCS, 1);
+#endif
   }
 
 #ifdef DEBUG_SHOW_RMATCH
@@ -715,6 +946,7 @@ memcpy((char *)N + offsetof(heapframe, eptr),
        frame_copy_size);
 
 N->rdepth = Frdepth + 1;
+N->memo_bit = memo_bit;
 F = N;
 
 /* Carry on processing with a new frame. */
@@ -724,6 +956,12 @@ Fgroup_frame_type = group_frame_type;
 Fecode = start_ecode;      /* Starting code pointer */
 Fback_frame = frame_size;  /* Default is go back one frame */
 
+if (PROFILING)
+  {
+  mb->stats->frames++;
+  if (Frdepth > mb->stats->max_depth) mb->stats->max_depth = Frdepth;
+  }
+
 /* If this is a special type of group frame, remember its offset for quick
 access at the end of the group. If this is a recursion, set a new current
 recursion value. */
@@ -752,6 +990,7 @@ for (;;)
 fprintf(stderr, "++ op=%d\n", *Fecode);
 #endif
 
+  if (PROFILING) mb->stats->opcodes++;
   Fop = (uint8_t)(*Fecode);  /* Cast needed for 16-bit and 32-bit modes */
   switch(Fop)
     {
@@ -779,9 +1018,13 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
         }
       offset = (number << 1) - 2;
       Fcapture_last = number;
-      Fovector[offset] = P->eptr - mb->start_subject;
-      Fovector[offset+1] = Feptr - mb->start_subject;
-      if (offset >= Foffset_top) Foffset_top = offset + 2;
+      if (number <= frame_groups)
+        {
+        Fovector[offset] = P->eptr - mb->start_subject;
+        Fovector[offset+1] = Feptr - mb->start_subject;
+        if (offset >= Foffset_top) Foffset_top = offset + 2;
+        }
+      else Foffset_top = frame_groups << 1;  /* Group not kept in frames */
       }
     Fecode += PRIV(OP_lengths)[*Fecode];
     break;
@@ -866,7 +1109,7 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
 
     /* Set i to the smaller of the sizes of the external and frame ovectors. */
 
-    i = 2 * ((top_bracket + 1 > oveccount)? oveccount : top_bracket + 1);
+    i = 2 * ((frame_groups + 1 > oveccount)? oveccount : frame_groups + 1);
     memcpy(ovector + 2, Fovector, (i - 2) * sizeof(PCRE2_SIZE));
     while (--i >= Foffset_top + 2) ovector[i] = PCRE2_UNSET;
     return MATCH_MATCH;  /* Note: NOT RRETURN */
@@ -2023,6 +2266,19 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               SCHECK_PARTIAL();
               break;
               }
+
+            /* Runs of ASCII characters are matched without decoding. */
+
+            if (*Feptr < 128)
+              {
+              PCRE2_SPTR next = match_ascii_run(Feptr, mb->end_subject,
+                Lbyte_map, FALSE, Lmax - i);
+              if (next == Feptr) break;
+              i += (uint32_t)(next - Feptr) - 1;
+              Feptr = next;
+              continue;
+              }
+
             GETCHARLEN(fc, Feptr, len);
             if (fc > 255)
               {
@@ -2193,6 +2449,19 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             break;
             }
 #ifdef SUPPORT_UNICODE
+          /* When a class has no properties, its bitmap is all that is needed
+          for ASCII characters. */
+
+          if (*Feptr < 128 &&
+              (*Lxclass_data & (XCL_MAP|XCL_HASPROP)) == XCL_MAP)
+            {
+            PCRE2_SPTR next = match_ascii_run(Feptr, mb->end_subject,
+              (const uint8_t *)(Lxclass_data + 1), FALSE, Lmax - i);
+            if (next == Feptr) break;
+            i += (uint32_t)(next - Feptr) - 1;
+            Feptr = next;
+            continue;
+            }
           GETCHARLENTEST(fc, Feptr, len);
 #else
           fc = *Feptr;
@@ -2893,7 +3162,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             default: RRETURN(MATCH_NOMATCH);
 
             case CHAR_CR:
-            if (Feptr < mb->end_subject && UCHAR21(Feptr) == CHAR_LF) Feptr++;
+            if (Feptr >= mb->end_subject)
+              {
+              SCHECK_PARTIAL();
+              }
+            else if (UCHAR21(Feptr) == CHAR_LF) Feptr++;
             break;
 
             case CHAR_LF:
@@ -3148,7 +3421,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             default: RRETURN(MATCH_NOMATCH);
 
             case CHAR_CR:
-            if (Feptr < mb->end_subject && *Feptr == CHAR_LF) Feptr++;
+            if (Feptr >= mb->end_subject)
+              {
+              SCHECK_PARTIAL();
+              }
+            else if (*Feptr == CHAR_LF) Feptr++;
             break;
 
             case CHAR_LF:
@@ -3634,7 +3911,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               default: RRETURN(MATCH_NOMATCH);
 
               case CHAR_CR:
-              if (Feptr < mb->end_subject && UCHAR21(Feptr) == CHAR_LF) Feptr++;
+              if (Feptr >= mb->end_subject)
+                {
+                SCHECK_PARTIAL();
+                }
+              else if (UCHAR21(Feptr) == CHAR_LF) Feptr++;
               break;
 
               case CHAR_LF:
@@ -3762,7 +4043,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               default: RRETURN(MATCH_NOMATCH);
 
               case CHAR_CR:
-              if (Feptr < mb->end_subject && *Feptr == CHAR_LF) Feptr++;
+              if (Feptr >= mb->end_subject)
+                {
+                SCHECK_PARTIAL();
+                }
+              else if (*Feptr == CHAR_LF) Feptr++;
               break;
 
               case CHAR_LF:
@@ -3972,6 +4257,19 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               SCHECK_PARTIAL();
               break;
               }
+            /* Runs of ASCII characters are matched from a bitmap, without
+            looking them up in the UCD. */
+
+            if (*Feptr < 128)
+              {
+              PCRE2_SPTR next = match_ascii_run(Feptr, mb->end_subject,
+                PRIV(ucp_ascii_bits) + ucp_ascii_alnum, Lctype == OP_NOTPROP,
+                Lmax - i);
+              if (next == Feptr) break;
+              i += (uint32_t)(next - Feptr) - 1;
+              Feptr = next;
+              continue;
+              }
             GETCHARLENTEST(fc, Feptr, len);
             category = UCD_CATEGORY(fc);
             if ((category == ucp_L || category == ucp_N) ==
@@ -3995,6 +4293,16 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               SCHECK_PARTIAL();
               break;
               }
+            if (*Feptr < 128)
+              {
+              PCRE2_SPTR next = match_ascii_run(Feptr, mb->end_subject,
+                PRIV(ucp_ascii_bits) + ucp_ascii_space, Lctype == OP_NOTPROP,
+                Lmax - i);
+              if (next == Feptr) break;
+              i += (uint32_t)(next - Feptr) - 1;
+              Feptr = next;
+              continue;
+              }
             GETCHARLENTEST(fc, Feptr, len);
             switch(fc)
               {
@@ -4023,6 +4331,16 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
               SCHECK_PARTIAL();
               break;
               }
+            if (*Feptr < 128)
+              {
+              PCRE2_SPTR next = match_ascii_run(Feptr, mb->end_subject,
+                PRIV(ucp_ascii_bits) + ucp_ascii_word, Lctype == OP_NOTPROP,
+                Lmax - i);
+              if (next == Feptr) break;
+              i += (uint32_t)(next - Feptr) - 1;
+              Feptr = next;
+              continue;
+              }
             GETCHARLENTEST(fc, Feptr, len);
             category = UCD_CATEGORY(fc);
             if ((category == ucp_L || category == ucp_N ||
@@ -4101,6 +4419,7 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
 
       else if (Lctype == OP_EXTUNI)
         {
+        PCRE2_SPTR lastptr = mb->end_subject - 1;
         for (i = Lmin; i < Lmax; i++)
           {
           if (Feptr >= mb->end_subject)
@@ -4110,6 +4429,17 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             }
           else
             {
+            /* Each ASCII character other than CR that is followed by another
+            ASCII character is a sequence on its own. Pass over a run of them
+            without calling extuni(); the last character of the run is left
+            for the general code. */
+
+            while (i < Lmax - 1 && Feptr < lastptr && *Feptr < 128 &&
+                   *Feptr != 0x0d && Feptr[1] < 128)
+              {
+              Feptr++;
+              i++;
+              }
             GETCHARINCTEST(fc, Feptr);
             Feptr = PRIV(extuni)(fc, Feptr, mb->start_subject, mb->end_subject,
               utf, NULL);
@@ -4240,7 +4570,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             GETCHARLEN(fc, Feptr, len);
             if (fc == CHAR_CR)
               {
-              if (++Feptr >= mb->end_subject) break;
+              if (++Feptr >= mb->end_subject)
+                {
+                SCHECK_PARTIAL();
+                break;
+                }
               if (UCHAR21(Feptr) == CHAR_LF) Feptr++;
               }
             else
@@ -4465,7 +4799,11 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
             fc = *Feptr;
             if (fc == CHAR_CR)
               {
-              if (++Feptr >= mb->end_subject) break;
+              if (++Feptr >= mb->end_subject)
+                {
+                SCHECK_PARTIAL();
+                break;
+                }
               if (*Feptr == CHAR_LF) Feptr++;
               }
             else
@@ -5646,13 +5984,20 @@ fprintf(stderr, "++ op=%d\n", *Fecode);
         continue;  /* With next opcode */
         }
 
-      /* Deal with actual capturing. */
+      /* Deal with actual capturing. A group that is beyond those kept in the
+      frames (see pcre2_match() below) is not saved, but it sets the offset top
+      to the end of the frame vector, so that the match is reported as having
+      too many captures for the ovector. */
 
       offset = (number << 1) - 2;
       Fcapture_last = number;
-      Fovector[offset] = P->eptr - mb->start_subject;
-      Fovector[offset+1] = Feptr - mb->start_subject;
-      if (offset >= Foffset_top) Foffset_top = offset + 2;
+      if (number <= frame_groups)
+        {
+        Fovector[offset] = P->eptr - mb->start_subject;
+        Fovector[offset+1] = Feptr - mb->start_subject;
+        if (offset >= Foffset_top) Foffset_top = offset + 2;
+        }
+      else Foffset_top = frame_groups << 1;
       break;
       }  /* End actions relating to the starting opcode */
 
@@ -6044,6 +6389,25 @@ if (Frdepth == 0) return rrc;                     /* Exit from the top level */
 F = (heapframe *)((char *)F - Fback_frame);       /* Backtrack */
 mb->cb->callout_flags |= PCRE2_CALLOUT_BACKTRACK; /* Note for callouts */
 
+if (PROFILING && (rrc == MATCH_NOMATCH ||
+    (rrc >= MATCH_BACKTRACK_MIN && rrc <= MATCH_BACKTRACK_MAX)))
+  mb->stats->backtracks++;
+
+/* A frame that is backtracked into with MATCH_NOMATCH has a child frame
+immediately following it whose starting position has now been shown to fail.
+This is so even when intermediate frames have been discarded at the end of an
+atomic group or assertion. The child is not recorded if it started a branch
+of such a group (see MATCH_RECURSE above). */
+
+if (rrc == MATCH_NOMATCH && mb->memo_bits != NULL)
+  {
+  memo_bit = ((heapframe *)((char *)F + frame_size))->memo_bit;
+  if (memo_bit != PCRE2_UNSET)
+    mb->memo_bits[memo_bit/8] |= (uint8_t)(1u << (memo_bit%8));
+  }
+
+RETURN_DISPATCH:
+
 #ifdef DEBUG_SHOW_RMATCH
 fprintf(stderr, "++ RETURN %d to %d\n", rrc, Freturn_id);
 #endif
@@ -6073,6 +6437,20 @@ switch (Freturn_id)
 #undef LBL
 }
 
+#ifndef PROFILED_MATCH
+
+/* Now compile the instrumented copy of match(). */
+
+#define PROFILED_MATCH
+#undef MATCH_FUNCTION
+#undef PROFILING
+#define MATCH_FUNCTION match_profiled
+#define PROFILING 1
+#include "pcre2_match.c"
+#undef MATCH_FUNCTION
+#undef PROFILING
+#undef PROFILED_MATCH
+
 
 /*************************************************
 *           Match a Regular Expression           *
@@ -6151,6 +6529,7 @@ BOOL jit_checked_utf = FALSE;
 #endif  /* SUPPORT_UNICODE */
 
 PCRE2_SIZE frame_size;
+uint16_t frame_groups;
 
 /* We need to have mb as a pointer to a match block, because the IS_NEWLINE
 macro is used below, and it expects NLBLOCK to be defined as a pointer. */
@@ -6248,6 +6627,13 @@ if (mcontext != NULL && mcontext->offset_limit != PCRE2_UNSET &&
      (re->overall_options & PCRE2_USE_OFFSET_LIMIT) == 0)
   return PCRE2_ERROR_BADOFFSETLIMIT;
 
+/* Nothing may be allocated when a real-time buffer is set, so a copy of the
+subject cannot be kept. */
+
+if (mcontext != NULL && mcontext->match_buffer != NULL &&
+    (options & PCRE2_COPY_MATCHED_SUBJECT) != 0)
+  return PCRE2_ERROR_HEAPLIMIT;
+
 /* If the match data block was previously used with PCRE2_COPY_MATCHED_SUBJECT,
 free the memory that was obtained. Set the field to NULL for no match cases. */
 
@@ -6258,6 +6644,7 @@ if ((match_data->flags & PCRE2_MD_COPIED_SUBJECT) != 0)
   match_data->flags &= ~PCRE2_MD_COPIED_SUBJECT;
   }
 match_data->subject = NULL;
+match_data->flags &= ~PCRE2_MD_STATS;
 
 /* Zero the error offset in case the first code unit is invalid UTF. */
 
@@ -6599,10 +6986,29 @@ the pattern. It is not used at all if there are no capturing parentheses.
 
 The last of these is changed within the match() function if the frame vector
 has to be expanded. We therefore put it into the match block so that it is
-correct when calling match() more than once for non-anchored patterns. */
+correct when calling match() more than once for non-anchored patterns.
+
+When the ovector in the match data is smaller than the number of capturing
+parentheses, the groups that cannot be returned need not be kept in the frames,
+which makes them smaller and cheaper to copy. A match data block with an
+ovector of one pair, for example, asks only whether and where the pattern
+matches. This is possible only if nothing during the match can look at the
+missing groups: there must be no recursion and no callout that can be taken
+(either the pattern has none or there is no callout function), and back
+references and conditions must refer to kept groups (a reference to a
+duplicated name could refer to any of them). One group more than the ovector
+can hold is kept, so that a match that sets a higher group is still detected
+and gives a zero return, as it does when all the groups are kept. */
+
+frame_groups = re->top_bracket;
+if (match_data->oveccount < frame_groups &&
+    (mb->callout == NULL || (re->flags & PCRE2_HASCALLOUT) == 0) &&
+    (re->flags & (PCRE2_HASRECURSE|PCRE2_HASDUPREF)) == 0)
+  frame_groups = (re->top_backref > match_data->oveccount)?
+    re->top_backref : match_data->oveccount;
 
 frame_size = offsetof(heapframe, ovector) +
-  re->top_bracket * 2 * sizeof(PCRE2_SIZE);
+  frame_groups * 2 * sizeof(PCRE2_SIZE);
 
 /* Limits set in the pattern override the match context only if they are
 smaller. */
@@ -6619,9 +7025,29 @@ mb->match_limit_depth = (mcontext->depth_limit < re->limit_depth)?
 /* If a pattern has very many capturing parentheses, the frame size may be very
 large. Ensure that there are at least 10 available frames by getting an initial
 vector on the heap if necessary, except when the heap limit prevents this. Get
-fewer if possible. (The heap limit is in kibibytes.) */
+fewer if possible. (The heap limit is in kibibytes.)
+
+When a real-time buffer is set, the frames are kept in it instead, and it is
+never replaced, so that nothing is allocated. Its size, cut to the heap limit,
+is the most memory that the match can use. */
 
-if (frame_size <= START_FRAMES_SIZE/10)
+mb->fixed_frames = mcontext->match_buffer != NULL;
+if (mb->fixed_frames)
+  {
+  PCRE2_SIZE size = mcontext->match_buffer_size;
+  if (size / 1024 >= mb->heap_limit) size = mb->heap_limit * 1024;
+  if (frame_size > size)
+    {
+#ifdef SUPPORT_TELEMETRY
+    PRIV(telemetry_match)(TELEMETRY_INTERPRETER_MATCHES,
+      PCRE2_ERROR_HEAPLIMIT);
+#endif
+    return PCRE2_ERROR_HEAPLIMIT;
+    }
+  mb->stack_frames = mb->match_frames = (heapframe *)mcontext->match_buffer;
+  mb->frame_vector_size = (size/frame_size) * frame_size;
+  }
+else if (frame_size <= START_FRAMES_SIZE/10)
   {
   mb->match_frames = mb->stack_frames;   /* Initial frame vector on the stack */
   mb->frame_vector_size = ((START_FRAMES_SIZE/frame_size) * frame_size);
@@ -6631,7 +7057,14 @@ else
   mb->frame_vector_size = frame_size * 10;
   if ((mb->frame_vector_size / 1024) > mb->heap_limit)
     {
-    if (frame_size > mb->heap_limit * 1024) return PCRE2_ERROR_HEAPLIMIT;
+    if (frame_size > mb->heap_limit * 1024)
+      {
+#ifdef SUPPORT_TELEMETRY
+      PRIV(telemetry_match)(TELEMETRY_INTERPRETER_MATCHES,
+        PCRE2_ERROR_HEAPLIMIT);
+#endif
+      return PCRE2_ERROR_HEAPLIMIT;
+      }
     mb->frame_vector_size = ((mb->heap_limit * 1024)/frame_size) * frame_size;
     }
   mb->match_frames = mb->memctl.malloc(mb->frame_vector_size,
@@ -6646,7 +7079,56 @@ mb->match_frames_top =
 to avoid uninitialized memory read errors when it is copied to a new frame. */
 
 memset((char *)(mb->match_frames) + offsetof(heapframe, ovector), 0xff,
-  re->top_bracket * 2 * sizeof(PCRE2_SIZE));
+  frame_groups * 2 * sizeof(PCRE2_SIZE));
+
+/* If a memo limit is set, failures are memoized in a bitmap that has one bit
+for each pair of code position and subject position. This is done only when
+the pattern and options make it valid and the bitmap fits within the limit,
+which is in kibibytes. Otherwise matching proceeds without memoizing. Partial
+matching and the "not empty" options are excluded because they make the outcome
+depend on where the match started. So does invalid UTF support, because the
+subject is processed in fragments. The bitmap is never used in real-time
+matching, which must not allocate it. */
+
+mb->memo_bits = NULL;
+if (mcontext->memo_limit > 0 && mb->partial == 0 && !mb->fixed_frames &&
+    (options & (PCRE2_NOTEMPTY|PCRE2_NOTEMPTY_ATSTART)) == 0 &&
+#ifdef SUPPORT_UNICODE
+    !allow_invalid &&
+#endif
+    memo_allowed(mb->start_code, utf))
+  {
+  PCRE2_SIZE code_length = (PCRE2_SIZE)(((uint8_t *)re + re->blocksize) -
+    (uint8_t *)mb->start_code) / (PCRE2_CODE_UNIT_WIDTH/8);
+
+  mb->memo_width = length + 1;
+  if (mb->memo_width <= (PCRE2_SIZE)(-1)/8/code_length)
+    {
+    PCRE2_SIZE memo_size = (code_length * mb->memo_width + 7)/8;
+    if ((memo_size + 1023)/1024 <= mcontext->memo_limit)
+      {
+      mb->memo_bits = mb->memctl.malloc(memo_size, mb->memctl.memory_data);
+      if (mb->memo_bits == NULL)
+        {
+        if (mb->match_frames != mb->stack_frames)
+          mb->memctl.free(mb->match_frames, mb->memctl.memory_data);
+        return PCRE2_ERROR_NOMEMORY;
+        }
+      memset(mb->memo_bits, 0, memo_size);
+      }
+    }
+  }
+
+/* If statistics are wanted, they are collected in the match data block by the
+instrumented copy of match(). */
+
+if (mcontext->collect_stats)
+  {
+  mb->stats = &match_data->stats;
+  memset(mb->stats, 0, sizeof(pcre2_match_stats));
+  match_data->flags |= PCRE2_MD_STATS;
+  }
+else mb->stats = NULL;
 
 /* Pointers to the individual character tables */
 
@@ -6675,7 +7157,7 @@ if ((re->flags & PCRE2_FIRSTSET) != 0)
   }
 else
   if (!startline && (re->flags & PCRE2_FIRSTMAPSET) != 0)
-    start_bits = re->start_bitmap;
+    start_bits = START_BITMAP(re);
 
 /* There may also be a "last known required character" set. */
 
@@ -6697,6 +7179,15 @@ if ((re->flags & PCRE2_LASTSET) != 0)
   }
 
 
+/* When a partial match is being resumed after more data has been added to the
+subject, the earlier starting positions need not be tried again. The UTF check
+above started no later than this, so it has covered everything that can now be
+inspected. */
+
+if ((options & PCRE2_PARTIAL_RESUME) != 0)
+  start_match = subject + PRIV(partial_resume)(re, match_data, start_offset,
+    length);
+
 /* ==========================================================================*/
 
 /* Loop for handling unanchored repeated matching attempts; for anchored regexs
@@ -7049,8 +7540,16 @@ for(;;)
   mb->end_offset_top = 0;
   mb->skip_arg_count = 0;
 
-  rc = match(start_match, mb->start_code, match_data->ovector,
-    match_data->oveccount, re->top_bracket, frame_size, mb);
+  if (mb->stats == NULL)
+    rc = match(start_match, mb->start_code, match_data->ovector,
+      match_data->oveccount, frame_groups, frame_size, mb);
+  else
+    {
+    mb->stats->start_positions++;
+    rc = match_profiled(start_match, mb->start_code, match_data->ovector,
+      match_data->oveccount, frame_groups, frame_size, mb);
+    mb->stats->subject_scanned += (PCRE2_SIZE)(mb->last_used_ptr - start_match);
+    }
 
   if (mb->hitend && start_partial == NULL)
     {
@@ -7232,16 +7731,24 @@ if (utf && end_subject != true_end_subject &&
   }
 #endif  /* SUPPORT_UNICODE */
 
-/* Release an enlarged frame vector that is on the heap. */
+/* Release an enlarged frame vector that is on the heap, and any memo
+bitmap. */
 
 if (mb->match_frames != mb->stack_frames)
   mb->memctl.free(mb->match_frames, mb->memctl.memory_data);
+if (mb->memo_bits != NULL)
+  mb->memctl.free(mb->memo_bits, mb->memctl.memory_data);
+
+#ifdef SUPPORT_TELEMETRY
+PRIV(telemetry_match)(TELEMETRY_INTERPRETER_MATCHES, rc);
+#endif
 
 /* Fill in fields that are always returned in the match data. */
 
 match_data->code = re;
 match_data->mark = mb->mark;
 match_data->matchedby = PCRE2_MATCHEDBY_INTERPRETER;
+match_data->flags &= ~PCRE2_MD_PARTIAL;
 
 /* Handle a fully successful match. Set the return code to the number of
 captured strings, or 0 if there were too many to fit into the ovector, and then
@@ -7282,7 +7789,8 @@ if (rc != MATCH_NOMATCH && rc != PCRE2_ERROR_PARTIAL) match_data->rc = rc;
 /* Handle a partial match. If a "soft" partial match was requested, searching
 for a complete match will have continued, and the value of rc at this point
 will be MATCH_NOMATCH. For a "hard" partial match, it will already be
-PCRE2_ERROR_PARTIAL. */
+PCRE2_ERROR_PARTIAL. A hard partial match is recorded for PCRE2_PARTIAL_RESUME
+unless it started at the end of the subject (see pcre2_match_data.c). */
 
 else if (match_partial != NULL)
   {
@@ -7292,6 +7800,12 @@ else if (match_partial != NULL)
   match_data->startchar = match_partial - subject;
   match_data->leftchar = start_partial - subject;
   match_data->rightchar = end_subject - subject;
+  if (mb->partial > 1 && match_partial < end_subject)
+    {
+    match_data->partial_offset = start_offset;
+    match_data->partial_start = match_partial - subject;
+    match_data->flags |= PCRE2_MD_PARTIAL;
+    }
   match_data->rc = PCRE2_ERROR_PARTIAL;
   }
 
@@ -7302,4 +7816,6 @@ else match_data->rc = PCRE2_ERROR_NOMATCH;
 return match_data->rc;
 }
 
+#endif  /* PROFILED_MATCH */
+
 /* End of pcre2_match.c */
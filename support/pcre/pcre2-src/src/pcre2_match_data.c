@@ -163,4 +163,72 @@ return offsetof(pcre2_match_data, ovector) +
   2 * (match_data->oveccount) * sizeof(PCRE2_SIZE);
 }
 
+
+
+/*************************************************
+*         Get statistics for last match          *
+*************************************************/
+
+/* NULL is returned if statistics were not requested for the last match. */
+
+PCRE2_EXP_DEFN const pcre2_match_stats * PCRE2_CALL_CONVENTION
+pcre2_get_match_stats(pcre2_match_data *match_data)
+{
+return ((match_data->flags & PCRE2_MD_STATS) != 0)? &match_data->stats : NULL;
+}
+
+
+
+
+/*************************************************
+*      Find where to resume a partial match      *
+*************************************************/
+
+/* This is called by pcre2_match() and pcre2_jit_match() when
+PCRE2_PARTIAL_RESUME is set. The caller's subject is the subject of the last
+match that used this block with more data appended. If that match was a hard
+partial match of the same pattern from the same starting offset, every
+starting position before the one where the partial match began failed without
+reaching the end of the subject, so none of them can match the longer subject
+either, and the search can begin at the partial match. The starting offset
+itself is unchanged, so \G and PCRE2_NOTEMPTY_ATSTART still refer to it. Only
+hard partial matches are recorded; after a soft one, the search may have gone
+on past verbs such as (*SKIP), and JIT does not then always report the first
+partial match.
+
+Patterns with PCRE2_FIRSTLINE are excluded because the first line is found
+from the starting offset, as are those with PCRE2_MATCH_INVALID_UTF, which may
+be matched in fragments, and anchored patterns, which have only one starting
+position anyway. So are patterns with a multiline circumflex, because it fails
+after a newline at the end of the subject without recording a partial match,
+unless PCRE2_ALT_CIRCUMFLEX is set. A partial match that started at the end of
+the subject is not recorded (see pcre2_match()), because whether that position
+is tried at all may depend on the data that follows it.
+
+Arguments:
+  re              points to the compiled pattern
+  match_data      points to the match data block
+  start_offset    the starting offset for the new match
+  length          the length of the new subject
+
+Returns:          the offset at which to start searching
+*/
+
+PCRE2_SIZE
+PRIV(partial_resume)(const pcre2_real_code *re, pcre2_match_data *match_data,
+  PCRE2_SIZE start_offset, PCRE2_SIZE length)
+{
+if ((match_data->flags & PCRE2_MD_PARTIAL) == 0 ||
+    match_data->code != re ||
+    match_data->matchedby == PCRE2_MATCHEDBY_DFA_INTERPRETER ||
+    match_data->partial_offset != start_offset ||
+    match_data->partial_start > length ||
+    (re->overall_options &
+      (PCRE2_ANCHORED|PCRE2_FIRSTLINE|PCRE2_MATCH_INVALID_UTF)) != 0 ||
+    ((re->flags & PCRE2_HASCIRCM) != 0 &&
+      (re->overall_options & PCRE2_ALT_CIRCUMFLEX) == 0))
+  return start_offset;
+return match_data->partial_start;
+}
+
 /* End of pcre2_match_data.c */
@@ -0,0 +1,423 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+     Original API code Copyright (c) 1997-2012 University of Cambridge
+          New API code Copyright (c) 2016-2020 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+/* This module contains a ready-made memory provider that can be used instead
+of the system malloc() and free() for everything that is obtained through a
+general context. It gets large blocks directly from the operating system, so
+that they are fresh pages that are placed by the thread that uses them, and
+can optionally ask for them to be backed by transparent huge pages. It also
+has an arena mode in which memory is carved out of large chunks and released
+all at once. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pcre2_internal.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#if !defined MAP_ANONYMOUS && defined MAP_ANON
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifdef MAP_ANONYMOUS
+#define USE_MMAP
+#endif
+#endif
+
+#define PUBLIC_MEMORY_OPTIONS \
+  (PCRE2_MEMORY_ARENA|PCRE2_MEMORY_HUGEPAGES|PCRE2_MEMORY_FIRST_TOUCH)
+
+/* The default block size is used for arena chunks and is also the size from
+which ordinary allocations are mapped directly. When huge pages are requested,
+the default is one huge page. Pages are touched at the smallest common page
+size, which is harmless when the real page size is larger. */
+
+#define MEMORY_BLOCK_DEFAULT   (256*1024)
+#define MEMORY_HUGE_PAGE       (2*1024*1024)
+#define MEMORY_TOUCH_STRIDE    4096
+
+/* Where a block came from, so that it can be given back correctly. */
+
+enum { MEMORY_HEAP, MEMORY_MAPPED };
+
+/* Every block that is handed out in the non-arena mode is preceded by this
+header. The union ensures that what follows is suitably aligned for anything
+the library stores. */
+
+typedef union memory_header {
+  struct {
+    PCRE2_SIZE size;                   /* Length of a mapping */
+    uint32_t   kind;                   /* MEMORY_HEAP or MEMORY_MAPPED */
+  } h;
+  double     align_double;
+  void      *align_pointer;
+  PCRE2_SIZE align_size;
+} memory_header;
+
+/* An arena chunk starts with this header, padded to the same alignment. */
+
+typedef struct memory_chunk {
+  struct memory_chunk *next;           /* Next (older) chunk */
+  PCRE2_SIZE size;                     /* Total length of the chunk */
+  PCRE2_SIZE used;                     /* Offset of the first free byte */
+  uint32_t   kind;                     /* MEMORY_HEAP or MEMORY_MAPPED */
+} memory_chunk;
+
+#define MEMORY_ALIGN           sizeof(memory_header)
+#define MEMORY_ROUND(n, a)     (((n) + (a) - 1) / (a) * (a))
+#define CHUNK_HEADER_SIZE      MEMORY_ROUND(sizeof(memory_chunk), MEMORY_ALIGN)
+
+
+
+/*************************************************
+*      Get a block from the operating system     *
+*************************************************/
+
+/* The length is rounded up to a whole number of pages, or of huge pages when
+they are wanted and the block is big enough. For huge pages, more is mapped
+than is needed and the ends are trimmed, so that the block is aligned on a
+huge page boundary. If mapping is not available or fails, the caller falls
+back to the heap.
+
+Arguments:
+  mp        the memory provider
+  lengthptr points to the length required; updated to the length mapped
+
+Returns:    pointer to the block or NULL
+*/
+
+static void *
+get_mapped(pcre2_memory_provider *mp, PCRE2_SIZE *lengthptr)
+{
+#ifndef USE_MMAP
+(void)mp;
+(void)lengthptr;
+return NULL;
+#else
+
+char *block;
+PCRE2_SIZE length = MEMORY_ROUND(*lengthptr, MEMORY_TOUCH_STRIDE);
+BOOL huge = (mp->options & PCRE2_MEMORY_HUGEPAGES) != 0 &&
+  length >= MEMORY_HUGE_PAGE;
+
+if (huge)
+  {
+  PCRE2_SIZE lead;
+  length = MEMORY_ROUND(length, MEMORY_HUGE_PAGE);
+  block = mmap(NULL, length + MEMORY_HUGE_PAGE, PROT_READ|PROT_WRITE,
+    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (block == MAP_FAILED) return NULL;
+  lead = (MEMORY_HUGE_PAGE - ((size_t)block & (MEMORY_HUGE_PAGE - 1))) &
+    (MEMORY_HUGE_PAGE - 1);
+  if (lead != 0) munmap(block, lead);
+  munmap(block + lead + length, MEMORY_HUGE_PAGE - lead);
+  block += lead;
+#ifdef MADV_HUGEPAGE
+  (void)madvise(block, length, MADV_HUGEPAGE);
+#endif
+  }
+else
+  {
+  block = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
+    -1, 0);
+  if (block == MAP_FAILED) return NULL;
+  }
+
+/* Fresh pages are placed on the NUMA node of the thread that first writes to
+them. Touching them now makes that the thread that asked for the memory,
+rather than whichever thread happens to use it first. */
+
+if ((mp->options & PCRE2_MEMORY_FIRST_TOUCH) != 0)
+  {
+  volatile char *p;
+  for (p = block; p < block + length; p += MEMORY_TOUCH_STRIDE) *p = 0;
+  }
+
+*lengthptr = length;
+return block;
+#endif  /* USE_MMAP */
+}
+
+
+
+/*************************************************
+*     Get a block, from the OS or the heap       *
+*************************************************/
+
+/* Blocks of at least the provider's block size are mapped if possible. All
+others, and all blocks when mapping fails, come from the provider's own
+memory functions.
+
+Arguments:
+  mp        the memory provider
+  lengthptr points to the length required; updated for a mapping
+  kindptr   where to put MEMORY_HEAP or MEMORY_MAPPED
+
+Returns:    pointer to the block or NULL
+*/
+
+static void *
+get_block(pcre2_memory_provider *mp, PCRE2_SIZE *lengthptr, uint32_t *kindptr)
+{
+void *block = NULL;
+if (*lengthptr >= mp->block_size) block = get_mapped(mp, lengthptr);
+if (block != NULL)
+  {
+  *kindptr = MEMORY_MAPPED;
+  return block;
+  }
+*kindptr = MEMORY_HEAP;
+return mp->memctl.malloc(*lengthptr, mp->memctl.memory_data);
+}
+
+
+/* Give back a block obtained by get_block(). */
+
+static void
+release_block(pcre2_memory_provider *mp, void *block, PCRE2_SIZE length,
+  uint32_t kind)
+{
+#ifdef USE_MMAP
+if (kind == MEMORY_MAPPED)
+  {
+  munmap(block, length);
+  return;
+  }
+#else
+(void)length;
+(void)kind;
+#endif
+mp->memctl.free(block, mp->memctl.memory_data);
+}
+
+
+
+/*************************************************
+*        Memory functions for the context        *
+*************************************************/
+
+/* In arena mode, blocks are carved from the current chunk, and freeing does
+nothing. A request that does not fit in the current chunk gets a new chunk.
+If the request is bigger than the standard chunk size it gets a chunk of its
+own, which is placed behind the current chunk so that the latter continues to
+be used for small requests. */
+
+static void *
+provider_malloc(size_t size, void *memory_data)
+{
+pcre2_memory_provider *mp = (pcre2_memory_provider *)memory_data;
+PCRE2_SIZE length;
+uint32_t kind;
+
+if ((mp->options & PCRE2_MEMORY_ARENA) != 0)
+  {
+  memory_chunk *chunk = mp->chunks;
+  char *yield;
+
+  size = MEMORY_ROUND(size, MEMORY_ALIGN);
+  if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+    length = CHUNK_HEADER_SIZE + size;
+    if (length < mp->block_size) length = mp->block_size;
+    chunk = get_block(mp, &length, &kind);
+    if (chunk == NULL) return NULL;
+    chunk->size = length;
+    chunk->used = CHUNK_HEADER_SIZE;
+    chunk->kind = kind;
+    if (mp->chunks != NULL && length > mp->block_size)
+      {
+      chunk->next = mp->chunks->next;
+      mp->chunks->next = chunk;
+      }
+    else
+      {
+      chunk->next = mp->chunks;
+      mp->chunks = chunk;
+      }
+    }
+
+  yield = (char *)chunk + chunk->used;
+  chunk->used += size;
+  return yield;
+  }
+
+/* Not arena mode: each block gets a header that records where it came from. */
+
+else
+  {
+  memory_header *header;
+  length = sizeof(memory_header) + size;
+  header = get_block(mp, &length, &kind);
+  if (header == NULL) return NULL;
+  header->h.size = length;
+  header->h.kind = kind;
+  return header + 1;
+  }
+}
+
+
+static void
+provider_free(void *block, void *memory_data)
+{
+pcre2_memory_provider *mp = (pcre2_memory_provider *)memory_data;
+memory_header *header;
+
+/* Ignore the arena mode, and an attempt to free the embedded context. */
+
+if (block == NULL || (mp->options & PCRE2_MEMORY_ARENA) != 0 ||
+    block == (void *)&mp->gcontext)
+  return;
+
+header = (memory_header *)block - 1;
+release_block(mp, header, header->h.size, header->h.kind);
+}
+
+
+
+/*************************************************
+*           Create a memory provider             *
+*************************************************/
+
+/* A NULL general context means that the provider itself, and any blocks that
+are not mapped, are obtained with the system malloc().
+
+Arguments:
+  options       PCRE2_MEMORY_xxx option bits
+  block_size    arena chunk size and mapping threshold, or 0 for the default
+  gcontext      a general context or NULL
+
+Returns:        pointer to the provider or NULL on failure
+*/
+
+PCRE2_EXP_DEFN pcre2_memory_provider * PCRE2_CALL_CONVENTION
+pcre2_memory_provider_create(uint32_t options, PCRE2_SIZE block_size,
+  pcre2_general_context *gcontext)
+{
+pcre2_memory_provider *mp;
+
+if ((options & ~PUBLIC_MEMORY_OPTIONS) != 0) return NULL;
+if (block_size == 0) block_size = ((options & PCRE2_MEMORY_HUGEPAGES) != 0)?
+  MEMORY_HUGE_PAGE : MEMORY_BLOCK_DEFAULT;
+
+mp = PRIV(memctl_malloc)(sizeof(pcre2_real_memory_provider),
+  (pcre2_memctl *)gcontext);
+if (mp == NULL) return NULL;
+
+mp->gcontext.memctl.malloc = provider_malloc;
+mp->gcontext.memctl.free = provider_free;
+mp->gcontext.memctl.memory_data = mp;
+mp->chunks = NULL;
+mp->block_size = block_size;
+mp->options = options;
+return mp;
+}
+
+
+
+/*************************************************
+*       Get a provider's general context         *
+*************************************************/
+
+/* The context belongs to the provider and must not be freed. */
+
+PCRE2_EXP_DEFN pcre2_general_context * PCRE2_CALL_CONVENTION
+pcre2_memory_provider_context(pcre2_memory_provider *mp)
+{
+return (mp == NULL)? NULL : &mp->gcontext;
+}
+
+
+
+/*************************************************
+*         Release all the arena memory           *
+*************************************************/
+
+/* In arena mode, all chunks except the oldest one are given back, and the
+oldest is made empty, so that everything obtained from the provider becomes
+invalid at once. Nothing happens in the non-arena mode. */
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_memory_provider_reset(pcre2_memory_provider *mp)
+{
+memory_chunk *chunk;
+
+if (mp == NULL || mp->chunks == NULL) return;
+
+chunk = mp->chunks;
+while (chunk->next != NULL)
+  {
+  memory_chunk *next = chunk->next;
+  release_block(mp, chunk, chunk->size, chunk->kind);
+  chunk = next;
+  }
+
+chunk->used = CHUNK_HEADER_SIZE;
+mp->chunks = chunk;
+}
+
+
+
+/*************************************************
+*           Free a memory provider               *
+*************************************************/
+
+/* In the non-arena mode, everything that was obtained through the provider's
+context should have been freed first. In arena mode, all the chunks are given
+back. */
+
+PCRE2_EXP_DEFN void PCRE2_CALL_CONVENTION
+pcre2_memory_provider_free(pcre2_memory_provider *mp)
+{
+memory_chunk *chunk;
+
+if (mp == NULL) return;
+chunk = mp->chunks;
+while (chunk != NULL)
+  {
+  memory_chunk *next = chunk->next;
+  release_block(mp, chunk, chunk->size, chunk->kind);
+  chunk = next;
+  }
+mp->memctl.free(mp, mp->memctl.memory_data);
+}
+
+/* End of pcre2_memory.c */
@@ -161,7 +161,7 @@ switch(what)
 
   case PCRE2_INFO_FIRSTBITMAP:
   *((const uint8_t **)where) = ((re->flags & PCRE2_FIRSTMAPSET) != 0)?
-    &(re->start_bitmap[0]) : NULL;
+    START_BITMAP(re) : NULL;
   break;
 
   case PCRE2_INFO_FRAMESIZE:
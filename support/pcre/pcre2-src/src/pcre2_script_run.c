@@ -81,6 +81,18 @@ records (and is only likely to be a few hundred). */
 
 #define INTERSECTION_LIST_SIZE 50
 
+/* Word-at-a-time tests used to skip runs of ASCII characters in the 8-bit
+library. SWAR_HASDIGIT() is non-zero if any byte of a word whose bytes are all
+less than 128 is an ASCII digit. */
+
+#if PCRE2_CODE_UNIT_WIDTH == 8
+#define SWAR_ONES      (~(size_t)0/0xff)
+#define SWAR_HIGHBITS  (SWAR_ONES*0x80)
+#define SWAR_HASDIGIT(w) \
+  ((SWAR_ONES*(127+0x3a) - (w)) & ~(w) & ((w) + SWAR_ONES*(127-0x2f)) & \
+    SWAR_HIGHBITS)
+#endif
+
 BOOL
 PRIV(script_run)(PCRE2_SPTR ptr, PCRE2_SPTR endptr, BOOL utf)
 {
@@ -118,8 +130,61 @@ Hence the SCRIPT_HANPENDING state. */
 
 for (;;)
   {
-  const ucd_record *ucd = GET_UCD(c);
-  int32_t scriptx = ucd->scriptx;
+  const ucd_record *ucd;
+  int32_t scriptx;
+
+  /* ASCII characters need no table lookups: the letters are all in the Latin
+  script, the digits are all in the first digit set, and everything else is
+  Common. Unless the required script is not yet known to be Latin and this is
+  a letter, handle this character and any following run of ASCII characters
+  here. A letter that is met before the required script has been set is left
+  for the general code below. The numerical values are used rather than CHAR_xx
+  macros because the tables are indexed by code point, even under EBCDIC. */
+
+  if (c < 128 && (require_script == ucp_Latin || (c | 0x20u) - 0x61u >= 26u))
+    {
+    for (;;)
+      {
+      if (c - 0x30u < 10u)
+        {
+        if (require_digitset > 1) return FALSE;
+        require_digitset = 1;
+        }
+
+#if PCRE2_CODE_UNIT_WIDTH == 8
+      /* In the 8-bit library, once the required script is Latin, pass over
+      whole words that contain only ASCII characters and either no digits, or
+      digits when ASCII digits are already required. */
+
+      if (require_script == ucp_Latin)
+        {
+        while ((PCRE2_SIZE)(endptr - ptr) >= sizeof(size_t))
+          {
+          size_t w;
+          memcpy(&w, ptr, sizeof(size_t));
+          if ((w & SWAR_HIGHBITS) != 0) break;
+          if (require_digitset != 1 && SWAR_HASDIGIT(w) != 0) break;
+          ptr += sizeof(size_t);
+          }
+        }
+#endif
+
+      if (ptr >= endptr) return TRUE;
+      c = *ptr;
+      if (c >= 128 ||
+          (require_script != ucp_Latin && (c | 0x20u) - 0x61u < 26u))
+        break;
+      ptr++;
+      }
+
+    /* The next character needs the full check. */
+
+    GETCHARINCTEST(c, ptr);
+    continue;
+    }
+
+  ucd = GET_UCD(c);
+  scriptx = ucd->scriptx;
 
   /* If the script extension is Unknown, the string is not a valid script run.
   Such characters can only form script runs of length one. */
@@ -54,10 +54,26 @@ a sequence of compiled codes. */
 #define SERIALIZED_DATA_MAGIC 0x50523253u
 
 /* Deserialization is limited to the current PCRE version and
-character width. */
+character width. The top byte of the version is a revision number for the
+layout of the compiled code, which must be increased whenever the layout
+changes between releases. Data with a different layout revision from the same
+PCRE2 version is rejected as bad data. Revisions:
+
+  1  The start bitmap is no longer in the fixed part of the compiled code
+  2  The PCRE2_HASRECURSE, PCRE2_HASDUPREF, and PCRE2_HASCALLOUT flags are set
+     by the compiler, and pcre2_match() relies on them
+  3  The PCRE2_HASCIRCM flag is set by the compiler, and PCRE2_PARTIAL_RESUME
+     relies on it
+*/
+
+#define SERIALIZED_DATA_LAYOUT 3
 
 #define SERIALIZED_DATA_VERSION \
-  ((PCRE2_MAJOR) | ((PCRE2_MINOR) << 16))
+  ((PCRE2_MAJOR) | ((PCRE2_MINOR) << 16) | ((SERIALIZED_DATA_LAYOUT) << 24))
+
+#define SERIALIZED_VERSION_ERROR(v) \
+  ((((v) ^ SERIALIZED_DATA_VERSION) & 0x00ffffffu) == 0? \
+    PCRE2_ERROR_BADSERIALIZEDDATA : PCRE2_ERROR_BADMODE)
 
 #define SERIALIZED_DATA_CONFIG \
   (sizeof(PCRE2_UCHAR) | ((sizeof(void*)) << 8) | ((sizeof(PCRE2_SIZE)) << 16))
@@ -178,7 +194,8 @@ if (data == NULL || codes == NULL) return PCRE2_ERROR_NULL;
 if (number_of_codes <= 0) return PCRE2_ERROR_BADDATA;
 if (data->number_of_codes <= 0) return PCRE2_ERROR_BADSERIALIZEDDATA;
 if (data->magic != SERIALIZED_DATA_MAGIC) return PCRE2_ERROR_BADMAGIC;
-if (data->version != SERIALIZED_DATA_VERSION) return PCRE2_ERROR_BADMODE;
+if (data->version != SERIALIZED_DATA_VERSION)
+  return SERIALIZED_VERSION_ERROR(data->version);
 if (data->config != SERIALIZED_DATA_CONFIG) return PCRE2_ERROR_BADMODE;
 
 if (number_of_codes > data->number_of_codes)
@@ -186,14 +203,21 @@ if (number_of_codes > data->number_of_codes)
 
 src_bytes = bytes + sizeof(pcre2_serialized_data);
 
-/* Decode tables. The reference count for the tables is stored immediately
-following them. */
+/* Decode tables. Most patterns are compiled with the built-in default tables,
+and if the encoded tables are identical, the static copy is shared, so that
+nothing need be allocated (tables is left NULL). Otherwise, the reference count
+for the tables is stored immediately following them. */
 
-tables = memctl->malloc(TABLES_LENGTH + sizeof(PCRE2_SIZE), memctl->memory_data);
-if (tables == NULL) return PCRE2_ERROR_NOMEMORY;
-
-memcpy(tables, src_bytes, TABLES_LENGTH);
-*(PCRE2_SIZE *)(tables + TABLES_LENGTH) = number_of_codes;
+if (memcmp(src_bytes, PRIV(default_tables), TABLES_LENGTH) == 0)
+  tables = NULL;
+else
+  {
+  tables = memctl->malloc(TABLES_LENGTH + sizeof(PCRE2_SIZE),
+    memctl->memory_data);
+  if (tables == NULL) return PCRE2_ERROR_NOMEMORY;
+  memcpy(tables, src_bytes, TABLES_LENGTH);
+  *(PCRE2_SIZE *)(tables + TABLES_LENGTH) = number_of_codes;
+  }
 src_bytes += TABLES_LENGTH;
 
 /* Decode the byte stream. We must not try to read the size from the compiled
@@ -216,7 +240,7 @@ for (i = 0; i < number_of_codes; i++)
     (pcre2_memctl *)gcontext);
   if (dst_re == NULL)
     {
-    memctl->free(tables, memctl->memory_data);
+    if (tables != NULL) memctl->free(tables, memctl->memory_data);
     for (j = 0; j < i; j++)
       {
       memctl->free(codes[j], memctl->memory_data);
@@ -239,9 +263,17 @@ for (i = 0; i < number_of_codes; i++)
 
   /* At the moment only one table is supported. */
 
-  dst_re->tables = tables;
   dst_re->executable_jit = NULL;
-  dst_re->flags |= PCRE2_DEREF_TABLES;
+  if (tables == NULL)
+    {
+    dst_re->tables = PRIV(default_tables);
+    dst_re->flags &= ~PCRE2_DEREF_TABLES;
+    }
+  else
+    {
+    dst_re->tables = tables;
+    dst_re->flags |= PCRE2_DEREF_TABLES;
+    }
 
   codes[i] = dst_re;
   src_bytes += blocksize;
@@ -262,7 +294,8 @@ const pcre2_serialized_data *data = (const pcre2_serialized_data *)bytes;
 
 if (data == NULL) return PCRE2_ERROR_NULL;
 if (data->magic != SERIALIZED_DATA_MAGIC) return PCRE2_ERROR_BADMAGIC;
-if (data->version != SERIALIZED_DATA_VERSION) return PCRE2_ERROR_BADMODE;
+if (data->version != SERIALIZED_DATA_VERSION)
+  return SERIALIZED_VERSION_ERROR(data->version);
 if (data->config != SERIALIZED_DATA_CONFIG) return PCRE2_ERROR_BADMODE;
 
 return data->number_of_codes;
@@ -54,7 +54,7 @@ collecting data (e.g. minimum matching length). */
 
 /* Set a bit in the starting code unit bit map. */
 
-#define SET_BIT(c) re->start_bitmap[(c)/8] |= (1u << ((c)&7))
+#define SET_BIT(c) start_bitmap[(c)/8] |= (1u << ((c)&7))
 
 /* Returns from set_start_bits() */
 
@@ -769,6 +769,7 @@ corresponding bit for the other version of a letter if we are caseless.
 
 Arguments:
   re            points to the regex block
+  start_bitmap  points to the bitmap being built
   p             points to the first code unit of the character
   caseless      TRUE if caseless
   utf           TRUE for UTF mode
@@ -778,8 +779,8 @@ Returns:        pointer after the character
 */
 
 static PCRE2_SPTR
-set_table_bit(pcre2_real_code *re, PCRE2_SPTR p, BOOL caseless, BOOL utf,
-  BOOL ucp)
+set_table_bit(pcre2_real_code *re, uint8_t *start_bitmap, PCRE2_SPTR p,
+  BOOL caseless, BOOL utf, BOOL ucp)
 {
 uint32_t c = *p++;   /* First code unit */
 
@@ -856,6 +857,7 @@ So we deal with that case by considering the UTF-8 encoding.
 
 Arguments:
   re             the regex block
+  start_bitmap   the bitmap being built
   cbit type      the type of character wanted
   table_limit    32 for non-UTF-8; 16 for UTF-8
 
@@ -863,11 +865,12 @@ Returns:         nothing
 */
 
 static void
-set_type_bits(pcre2_real_code *re, int cbit_type, unsigned int table_limit)
+set_type_bits(pcre2_real_code *re, uint8_t *start_bitmap,
+  int cbit_type, unsigned int table_limit)
 {
 uint32_t c;
 for (c = 0; c < table_limit; c++)
-  re->start_bitmap[c] |= re->tables[c+cbits_offset+cbit_type];
+  start_bitmap[c] |= re->tables[c+cbits_offset+cbit_type];
 #if defined SUPPORT_UNICODE && PCRE2_CODE_UNIT_WIDTH == 8
 if (table_limit == 32) return;
 for (c = 128; c < 256; c++)
@@ -897,6 +900,7 @@ all high-valued characters. The lowest is 0xc2, but we overkill by starting at
 
 Arguments:
   re             the regex block
+  start_bitmap   the bitmap being built
   cbit type      the type of character wanted
   table_limit    32 for non-UTF-8; 16 for UTF-8
 
@@ -904,13 +908,14 @@ Returns:         nothing
 */
 
 static void
-set_nottype_bits(pcre2_real_code *re, int cbit_type, unsigned int table_limit)
+set_nottype_bits(pcre2_real_code *re, uint8_t *start_bitmap,
+  int cbit_type, unsigned int table_limit)
 {
 uint32_t c;
 for (c = 0; c < table_limit; c++)
-  re->start_bitmap[c] |= ~(re->tables[c+cbits_offset+cbit_type]);
+  start_bitmap[c] |= ~(re->tables[c+cbits_offset+cbit_type]);
 #if defined SUPPORT_UNICODE && PCRE2_CODE_UNIT_WIDTH == 8
-if (table_limit != 32) for (c = 24; c < 32; c++) re->start_bitmap[c] = 0xff;
+if (table_limit != 32) for (c = 24; c < 32; c++) start_bitmap[c] = 0xff;
 #endif
 }
 
@@ -937,6 +942,7 @@ issues.
 
 Arguments:
   re           points to the compiled regex block
+  start_bitmap points to the bitmap being built
   code         points to an expression
   utf          TRUE if in UTF mode
   ucp          TRUE if in UCP mode
@@ -950,8 +956,8 @@ Returns:       SSB_FAIL     => Failed to find any starting code units
 */
 
 static int
-set_start_bits(pcre2_real_code *re, PCRE2_SPTR code, BOOL utf, BOOL ucp,
-  int *depthptr)
+set_start_bits(pcre2_real_code *re, uint8_t *start_bitmap, PCRE2_SPTR code,
+  BOOL utf, BOOL ucp, int *depthptr)
 {
 uint32_t c;
 int yield = SSB_DONE;
@@ -1121,7 +1127,7 @@ do
       case OP_SCRIPT_RUN:
       case OP_ASSERT:
       case OP_ASSERT_NA:
-      rc = set_start_bits(re, tcode, utf, ucp, depthptr);
+      rc = set_start_bits(re, start_bitmap, tcode, utf, ucp, depthptr);
       if (rc == SSB_DONE)
         {
         try_next = FALSE;
@@ -1177,7 +1183,7 @@ do
       case OP_BRAZERO:
       case OP_BRAMINZERO:
       case OP_BRAPOSZERO:
-      rc = set_start_bits(re, ++tcode, utf, ucp, depthptr);
+      rc = set_start_bits(re, start_bitmap, ++tcode, utf, ucp, depthptr);
       if (rc == SSB_FAIL || rc == SSB_UNKNOWN || rc == SSB_TOODEEP) return rc;
       do tcode += GET(tcode,1); while (*tcode == OP_ALT);
       tcode += 1 + LINK_SIZE;
@@ -1199,7 +1205,7 @@ do
       case OP_QUERY:
       case OP_MINQUERY:
       case OP_POSQUERY:
-      tcode = set_table_bit(re, tcode + 1, FALSE, utf, ucp);
+      tcode = set_table_bit(re, start_bitmap, tcode + 1, FALSE, utf, ucp);
       break;
 
       case OP_STARI:
@@ -1208,7 +1214,7 @@ do
       case OP_QUERYI:
       case OP_MINQUERYI:
       case OP_POSQUERYI:
-      tcode = set_table_bit(re, tcode + 1, TRUE, utf, ucp);
+      tcode = set_table_bit(re, start_bitmap, tcode + 1, TRUE, utf, ucp);
       break;
 
       /* Single-char upto sets the bit and tries the next */
@@ -1216,13 +1222,13 @@ do
       case OP_UPTO:
       case OP_MINUPTO:
       case OP_POSUPTO:
-      tcode = set_table_bit(re, tcode + 1 + IMM2_SIZE, FALSE, utf, ucp);
+      tcode = set_table_bit(re, start_bitmap, tcode + 1 + IMM2_SIZE, FALSE, utf, ucp);
       break;
 
       case OP_UPTOI:
       case OP_MINUPTOI:
       case OP_POSUPTOI:
-      tcode = set_table_bit(re, tcode + 1 + IMM2_SIZE, TRUE, utf, ucp);
+      tcode = set_table_bit(re, start_bitmap, tcode + 1 + IMM2_SIZE, TRUE, utf, ucp);
       break;
 
       /* At least one single char sets the bit and stops */
@@ -1234,7 +1240,7 @@ do
       case OP_PLUS:
       case OP_MINPLUS:
       case OP_POSPLUS:
-      (void)set_table_bit(re, tcode + 1, FALSE, utf, ucp);
+      (void)set_table_bit(re, start_bitmap, tcode + 1, FALSE, utf, ucp);
       try_next = FALSE;
       break;
 
@@ -1245,7 +1251,7 @@ do
       case OP_PLUSI:
       case OP_MINPLUSI:
       case OP_POSPLUSI:
-      (void)set_table_bit(re, tcode + 1, TRUE, utf, ucp);
+      (void)set_table_bit(re, start_bitmap, tcode + 1, TRUE, utf, ucp);
       try_next = FALSE;
       break;
 
@@ -1331,32 +1337,32 @@ do
       than 256 are recognized to match the types. */
 
       case OP_NOT_DIGIT:
-      set_nottype_bits(re, cbit_digit, table_limit);
+      set_nottype_bits(re, start_bitmap, cbit_digit, table_limit);
       try_next = FALSE;
       break;
 
       case OP_DIGIT:
-      set_type_bits(re, cbit_digit, table_limit);
+      set_type_bits(re, start_bitmap, cbit_digit, table_limit);
       try_next = FALSE;
       break;
 
       case OP_NOT_WHITESPACE:
-      set_nottype_bits(re, cbit_space, table_limit);
+      set_nottype_bits(re, start_bitmap, cbit_space, table_limit);
       try_next = FALSE;
       break;
 
       case OP_WHITESPACE:
-      set_type_bits(re, cbit_space, table_limit);
+      set_type_bits(re, start_bitmap, cbit_space, table_limit);
       try_next = FALSE;
       break;
 
       case OP_NOT_WORDCHAR:
-      set_nottype_bits(re, cbit_word, table_limit);
+      set_nottype_bits(re, start_bitmap, cbit_word, table_limit);
       try_next = FALSE;
       break;
 
       case OP_WORDCHAR:
-      set_type_bits(re, cbit_word, table_limit);
+      set_type_bits(re, start_bitmap, cbit_word, table_limit);
       try_next = FALSE;
       break;
 
@@ -1461,27 +1467,27 @@ do
         break;
 
         case OP_NOT_DIGIT:
-        set_nottype_bits(re, cbit_digit, table_limit);
+        set_nottype_bits(re, start_bitmap, cbit_digit, table_limit);
         break;
 
         case OP_DIGIT:
-        set_type_bits(re, cbit_digit, table_limit);
+        set_type_bits(re, start_bitmap, cbit_digit, table_limit);
         break;
 
         case OP_NOT_WHITESPACE:
-        set_nottype_bits(re, cbit_space, table_limit);
+        set_nottype_bits(re, start_bitmap, cbit_space, table_limit);
         break;
 
         case OP_WHITESPACE:
-        set_type_bits(re, cbit_space, table_limit);
+        set_type_bits(re, start_bitmap, cbit_space, table_limit);
         break;
 
         case OP_NOT_WORDCHAR:
-        set_nottype_bits(re, cbit_word, table_limit);
+        set_nottype_bits(re, start_bitmap, cbit_word, table_limit);
         break;
 
         case OP_WORDCHAR:
-        set_type_bits(re, cbit_word, table_limit);
+        set_type_bits(re, start_bitmap, cbit_word, table_limit);
         break;
         }
 
@@ -1523,7 +1529,7 @@ do
           case XCL_SINGLE:
           b = *p++;
           while ((*p & 0xc0) == 0x80) p++;
-          re->start_bitmap[b/8] |= (1u << (b&7));
+          start_bitmap[b/8] |= (1u << (b&7));
           break;
 
           case XCL_RANGE:
@@ -1532,7 +1538,7 @@ do
           e = *p++;
           while ((*p & 0xc0) == 0x80) p++;
           for (; b <= e; b++)
-            re->start_bitmap[b/8] |= (1u << (b&7));
+            start_bitmap[b/8] |= (1u << (b&7));
           break;
 
           case XCL_END:
@@ -1560,8 +1566,8 @@ do
 #if defined SUPPORT_UNICODE && PCRE2_CODE_UNIT_WIDTH == 8
       if (utf)
         {
-        re->start_bitmap[24] |= 0xf0;            /* Bits for 0xc4 - 0xc8 */
-        memset(re->start_bitmap+25, 0xff, 7);    /* Bits for 0xc9 - 0xff */
+        start_bitmap[24] |= 0xf0;            /* Bits for 0xc4 - 0xc8 */
+        memset(start_bitmap+25, 0xff, 7);    /* Bits for 0xc9 - 0xff */
         }
 #elif PCRE2_CODE_UNIT_WIDTH != 8
       SET_BIT(0xFF);                             /* For characters >= 255 */
@@ -1594,13 +1600,13 @@ do
 #if defined SUPPORT_UNICODE && PCRE2_CODE_UNIT_WIDTH == 8
         if (utf)
           {
-          for (c = 0; c < 16; c++) re->start_bitmap[c] |= classmap[c];
+          for (c = 0; c < 16; c++) start_bitmap[c] |= classmap[c];
           for (c = 128; c < 256; c++)
             {
             if ((classmap[c/8] & (1u << (c&7))) != 0)
               {
               int d = (c >> 6) | 0xc0;                 /* Set bit for this starter */
-              re->start_bitmap[d/8] |= (1u << (d&7));  /* and then skip on to the */
+              start_bitmap[d/8] |= (1u << (d&7));  /* and then skip on to the */
               c = (c & 0xc0) + 0x40 - 1;               /* next relevant character. */
               }
             }
@@ -1610,7 +1616,7 @@ do
         /* In all modes except UTF-8, the two bit maps are compatible. */
 
           {
-          for (c = 0; c < 32; c++) re->start_bitmap[c] |= classmap[c];
+          for (c = 0; c < 32; c++) start_bitmap[c] |= classmap[c];
           }
         }
 
@@ -1657,10 +1663,13 @@ return yield;
 *************************************************/
 
 /* This function is handed a compiled expression that it must study to produce
-information that will speed up the matching.
+information that will speed up the matching. If a bitmap of starting code
+units is built, PCRE2_FIRSTMAPSET is set, and the caller must then store the
+bitmap at the end of the compiled code's memory (see START_BITMAP).
 
-Argument:
-  re       points to the compiled expression
+Arguments:
+  re            points to the compiled expression
+  start_bitmap  points to a 32-byte vector for the starting code unit bitmap
 
 Returns:   0 normally; non-zero should never normally occur
            1 unknown opcode in set_start_bits
@@ -1669,7 +1678,7 @@ Returns:   0 normally; non-zero should never normally occur
 */
 
 int
-PRIV(study)(pcre2_real_code *re)
+PRIV(study)(pcre2_real_code *re, uint8_t *start_bitmap)
 {
 int count = 0;
 PCRE2_UCHAR *code;
@@ -1688,7 +1697,9 @@ code units. */
 if ((re->flags & (PCRE2_FIRSTSET|PCRE2_STARTLINE)) == 0)
   {
   int depth = 0;
-  int rc = set_start_bits(re, code, utf, ucp, &depth);
+  int rc;
+  memset(start_bitmap, 0, START_BITMAP_SIZE);
+  rc = set_start_bits(re, start_bitmap, code, utf, ucp, &depth);
   if (rc == SSB_UNKNOWN) return 1;
 
   /* If a list of starting code units was set up, scan the list to see if only
@@ -1704,7 +1715,7 @@ if ((re->flags & (PCRE2_FIRSTSET|PCRE2_STARTLINE)) == 0)
     int i;
     int a = -1;
     int b = -1;
-    uint8_t *p = re->start_bitmap;
+    uint8_t *p = start_bitmap;
     uint32_t flags = PCRE2_FIRSTMAPSET;
 
     for (i = 0; i < 256; p++, i += 8)
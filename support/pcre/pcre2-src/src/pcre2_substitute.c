@@ -257,7 +257,8 @@ ovecsave[0] = ovecsave[1] = ovecsave[2] = PCRE2_UNSET;
 /* Partial matching is not valid. This must come after setting *blength to
 PCRE2_UNSET, so as not to imply an offset in the replacement. */
 
-if ((options & (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT)) != 0)
+if ((options &
+    (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT|PCRE2_PARTIAL_RESUME)) != 0)
   return PCRE2_ERROR_BADOPTION;
 
 /* Check for using a match that has already happened. Note that the subject
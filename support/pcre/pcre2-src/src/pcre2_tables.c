@@ -135,6 +135,20 @@ const uint32_t PRIV(ucp_gentype)[] = {
   ucp_Z, ucp_Z, ucp_Z                 /* Zl, Zp, Zs */
 };
 
+/* Bitmaps of the ASCII characters that have the Unicode properties tested by
+\w, \s and [:alnum:] in UCP mode, at the offsets given by the ucp_ascii_xxx
+macros. These properties never change for ASCII characters, so pcre2_match()
+uses these maps for runs of ASCII characters instead of the UCD. */
+
+const uint8_t PRIV(ucp_ascii_bits)[] = {
+  0x00,0x00,0x00,0x00,0x00,0x00,0xff,0x03,  /* alnum: L or N */
+  0xfe,0xff,0xff,0x07,0xfe,0xff,0xff,0x07,
+  0x00,0x3e,0x00,0x00,0x01,0x00,0x00,0x00,  /* space: Z or \t\n\v\f\r */
+  0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+  0x00,0x00,0x00,0x00,0x00,0x00,0xff,0x03,  /* word: L or N or underscore */
+  0xfe,0xff,0xff,0x87,0xfe,0xff,0xff,0x07
+};
+
 /* This table encodes the rules for finding the end of an extended grapheme
 cluster. Every code point has a grapheme break property which is one of the
 ucp_gbXX values defined in pcre2_ucp.h. These changed between Unicode versions
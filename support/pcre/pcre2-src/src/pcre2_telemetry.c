@@ -0,0 +1,280 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* PCRE is a library of functions to support regular expressions whose syntax
+and semantics are as close as possible to those of the Perl 5 language.
+
+                       Written by Philip Hazel
+     Original API code Copyright (c) 1997-2012 University of Cambridge
+          New API code Copyright (c) 2016-2020 University of Cambridge
+
+-----------------------------------------------------------------------------
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of the University of Cambridge nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+-----------------------------------------------------------------------------
+*/
+
+/* This module contains the library-wide telemetry counters and the external
+function pcre2_stats_snapshot(), which aggregates them. The counters are
+compiled only when SUPPORT_TELEMETRY is defined; otherwise the snapshot
+function just reports that they are not available. */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pcre2_internal.h"
+
+
+#ifdef SUPPORT_TELEMETRY
+
+/* Compilations are timed by a monotonic clock, so that the time is the same
+whether or not the thread is descheduled, and is not disturbed by changes to
+the time of day. Where there is no such clock, clock() is used, which measures
+processor time. */
+
+#if defined _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* The counters are kept in a number of shards, each in its own cache line, so
+that threads running on different processors do not keep stealing the same
+line from each other. A thread's shard is chosen from the address of one of
+its stack variables, which is different for each thread and does not need any
+thread-local storage. Two threads may still share a shard, so the counters are
+updated with relaxed atomic additions where the compiler provides them. Without
+them the additions are plain, and a count may occasionally be lost when two
+threads collide; this is acceptable for statistics. The counters have 64 bits
+even on 32-bit hosts, where the total compile time in nanoseconds would
+otherwise wrap after about four seconds. The number of shards must be a power
+of two, no greater than 256. */
+
+#define TELEMETRY_SHARDS      16
+#define TELEMETRY_CACHE_LINE  64
+
+typedef union telemetry_shard {
+  uint64_t counts[TELEMETRY_COUNT];
+  char pad[((TELEMETRY_COUNT * sizeof(uint64_t) + TELEMETRY_CACHE_LINE - 1)/
+    TELEMETRY_CACHE_LINE) * TELEMETRY_CACHE_LINE];
+} telemetry_shard;
+
+static telemetry_shard telemetry[TELEMETRY_SHARDS];
+
+/* GCC-compatible compilers are trusted with 64-bit atomics only where they are
+lock-free, so that no support library is needed. */
+
+#if defined(__GNUC__) && defined(__ATOMIC_RELAXED) && \
+    defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && __GCC_ATOMIC_LLONG_LOCK_FREE == 2
+#define TELEMETRY_ADD(p, v) (void)__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define TELEMETRY_GET(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define TELEMETRY_ADD(p, v) \
+  (void)_InterlockedExchangeAdd64((volatile __int64 *)(p), (__int64)(v))
+#define TELEMETRY_GET(p) \
+  (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)(p), 0, 0)
+
+#else
+#define TELEMETRY_ADD(p, v) (*(p) += (v))
+#define TELEMETRY_GET(p) (*(volatile uint64_t *)(p))
+#endif
+
+
+
+/*************************************************
+*            Add to a telemetry counter          *
+*************************************************/
+
+/* Stacks of different threads are at least tens of kibibytes apart, whereas a
+single thread's calls into the library normally stay within a few kibibytes
+of each other, so the address bits above the bottom 16 make a stable
+per-thread key. They are mixed with a multiplicative hash to pick the shard.
+
+Arguments:
+  index     a TELEMETRY_xxx counter index
+  value     the amount to add
+
+Returns:    nothing
+*/
+
+void
+PRIV(telemetry_add)(int index, uint64_t value)
+{
+int local;
+uint32_t key = (uint32_t)((size_t)(char *)&local >> 16);
+telemetry_shard *shard =
+  telemetry + (((key * 0x9e3779b9u) >> 24) & (TELEMETRY_SHARDS - 1));
+TELEMETRY_ADD(&shard->counts[index], value);
+}
+
+
+
+/*************************************************
+*        Read the clock for timing compiles      *
+*************************************************/
+
+/* The reading is in nanoseconds from an arbitrary origin, so only the
+difference between two readings means anything. A clock that cannot be read
+returns zero, so the time of that compilation is not counted.
+
+Arguments:  none
+Returns:    the time in nanoseconds
+*/
+
+uint64_t
+PRIV(telemetry_clock)(void)
+{
+#if defined _WIN32
+LARGE_INTEGER count, frequency;
+if (!QueryPerformanceCounter(&count) ||
+    !QueryPerformanceFrequency(&frequency)) return 0;
+return (uint64_t)((count.QuadPart / frequency.QuadPart) * 1000000000 +
+  ((count.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+
+#elif defined CLOCK_MONOTONIC
+struct timespec now;
+if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) return 0;
+return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+
+#else
+clock_t now = clock();
+if (now == (clock_t)(-1)) return 0;
+return ((uint64_t)now / CLOCKS_PER_SEC) * 1000000000u +
+  (((uint64_t)now % CLOCKS_PER_SEC) * 1000000000u) / CLOCKS_PER_SEC;
+#endif
+}
+
+
+
+/*************************************************
+*          Record the outcome of a match         *
+*************************************************/
+
+/* This is called once by each matching engine when it has finished, and
+counts the match as well as any resource limit that stopped it.
+
+Arguments:
+  index     TELEMETRY_INTERPRETER_MATCHES, TELEMETRY_JIT_MATCHES, or
+              TELEMETRY_DFA_MATCHES
+  rc        the value the engine is returning
+
+Returns:    nothing
+*/
+
+void
+PRIV(telemetry_match)(int index, int rc)
+{
+PRIV(telemetry_add)(index, 1);
+switch(rc)
+  {
+  case PCRE2_ERROR_MATCHLIMIT:
+  PRIV(telemetry_add)(TELEMETRY_MATCH_LIMIT, 1);
+  break;
+
+  case PCRE2_ERROR_DEPTHLIMIT:
+  PRIV(telemetry_add)(TELEMETRY_DEPTH_LIMIT, 1);
+  break;
+
+  case PCRE2_ERROR_HEAPLIMIT:
+  PRIV(telemetry_add)(TELEMETRY_HEAP_LIMIT, 1);
+  break;
+
+  case PCRE2_ERROR_JIT_STACKLIMIT:
+  PRIV(telemetry_add)(TELEMETRY_JIT_STACK_LIMIT, 1);
+  break;
+
+  default:
+  break;
+  }
+}
+
+#endif  /* SUPPORT_TELEMETRY */
+
+
+
+/*************************************************
+*     Return a snapshot of the library counters  *
+*************************************************/
+
+/* The shards are summed without stopping other threads, so a snapshot taken
+while other threads are compiling or matching is not an exact instant, but
+each counter only ever increases. The JIT memory figure is read directly from
+the executable memory allocator. When telemetry support is not compiled, the
+block is zeroed and PCRE2_ERROR_BADOPTION is returned.
+
+Arguments:
+  stats     points to the block to fill in
+
+Returns:    0 on success
+            PCRE2_ERROR_NULL if stats is NULL
+            PCRE2_ERROR_BADOPTION if telemetry support is not compiled
+*/
+
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_stats_snapshot(pcre2_global_stats *stats)
+{
+#ifdef SUPPORT_TELEMETRY
+uint64_t totals[TELEMETRY_COUNT];
+int i, j;
+#endif
+
+if (stats == NULL) return PCRE2_ERROR_NULL;
+memset(stats, 0, sizeof(pcre2_global_stats));
+
+#ifndef SUPPORT_TELEMETRY
+return PCRE2_ERROR_BADOPTION;
+#else
+
+for (i = 0; i < TELEMETRY_COUNT; i++)
+  {
+  totals[i] = 0;
+  for (j = 0; j < TELEMETRY_SHARDS; j++)
+    totals[i] += TELEMETRY_GET(&telemetry[j].counts[i]);
+  }
+
+stats->compile_usec = totals[TELEMETRY_COMPILE_NSEC] / 1000;
+stats->compiles = (PCRE2_SIZE)totals[TELEMETRY_COMPILES];
+stats->compile_errors = (PCRE2_SIZE)totals[TELEMETRY_COMPILE_ERRORS];
+stats->jit_compiles = (PCRE2_SIZE)totals[TELEMETRY_JIT_COMPILES];
+stats->jit_memory = PRIV(jit_exec_size)();
+stats->interpreter_matches = (PCRE2_SIZE)totals[TELEMETRY_INTERPRETER_MATCHES];
+stats->jit_matches = (PCRE2_SIZE)totals[TELEMETRY_JIT_MATCHES];
+stats->dfa_matches = (PCRE2_SIZE)totals[TELEMETRY_DFA_MATCHES];
+stats->match_limit_hits = (PCRE2_SIZE)totals[TELEMETRY_MATCH_LIMIT];
+stats->depth_limit_hits = (PCRE2_SIZE)totals[TELEMETRY_DEPTH_LIMIT];
+stats->heap_limit_hits = (PCRE2_SIZE)totals[TELEMETRY_HEAP_LIMIT];
+stats->jit_stack_limit_hits = (PCRE2_SIZE)totals[TELEMETRY_JIT_STACK_LIMIT];
+stats->frame_reallocations = (PCRE2_SIZE)totals[TELEMETRY_FRAME_REALLOCS];
+return 0;
+#endif  /* SUPPORT_TELEMETRY */
+}
+
+/* End of pcre2_telemetry.c */
@@ -91,6 +91,32 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #endif
 
+#ifdef SUPPORT_PCRE2GREP_THREADS
+#include <pthread.h>
+#endif
+
+/* Where mmap() is available, regular files can be mapped into memory and
+searched in place. */
+
+#if defined HAVE_SYS_MMAN_H && defined HAVE_UNISTD_H && !defined WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <time.h>
+#define USE_MMAP
+
+/* The nanoseconds of a file's modification or status change time, for
+checking an index file. Where struct stat has POSIX.1-2008 timespec members,
+st_mtime is defined as a macro that refers to one of them. */
+
+#if defined st_mtime && defined __APPLE__
+#define STAT_NSEC(sb, t) ((sb)->st_##t##timespec.tv_nsec)
+#elif defined st_mtime
+#define STAT_NSEC(sb, t) ((sb)->st_##t##tim.tv_nsec)
+#else
+#define STAT_NSEC(sb, t) 0
+#endif
+#endif
+
 #ifdef SUPPORT_LIBZ
 #include <zlib.h>
 #endif
@@ -99,6 +125,14 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <bzlib.h>
 #endif
 
+/* When threads are supported, compressed files are decompressed by a separate
+thread while they are being searched. */
+
+#if defined SUPPORT_PCRE2GREP_THREADS && \
+    (defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2)
+#define USE_READAHEAD
+#endif
+
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include "pcre2.h"
 
@@ -128,6 +162,19 @@ be C99 don't support it (hence DISABLE_PERCENT_ZT). */
 
 typedef int BOOL;
 
+/* When files can be searched in parallel, the variables that hold the state of
+the search of one file have a separate instance in each thread. */
+
+#ifdef SUPPORT_PCRE2GREP_THREADS
+#if defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#else
+#define THREAD_LOCAL __thread
+#endif
+#else
+#define THREAD_LOCAL
+#endif
+
 #define DEFAULT_CAPTURE_MAX 50
 
 #if BUFSIZ > 8192
@@ -147,7 +194,44 @@ enum { FN_NONE, FN_DEFAULT, FN_MATCH_ONLY, FN_NOMATCH_ONLY, FN_FORCE };
 
 /* File reading styles */
 
-enum { FR_PLAIN, FR_LIBZ, FR_LIBBZ2 };
+enum { FR_PLAIN, FR_LIBZ, FR_LIBBZ2, FR_MMAP, FR_READAHEAD };
+
+/* With --index, a mapped file has an index file (see index_open() below),
+which holds a header followed by one of these for each block of the file. */
+
+#define INDEX_SUFFIX  ".pcre2grep-index"
+#define INDEX_MAGIC   "PCRE2IDX"
+#define INDEX_VERSION 2
+#define INDEX_BLOCK   65536
+#define INDEX_HBITS   12
+
+typedef struct index_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t newline;             /* The newline convention (endlinetype) */
+  uint64_t size;                /* Size of the indexed file */
+  int64_t mtime;                /* Its modification time */
+  int64_t ctime;                /* Its status change time */
+  uint32_t mtime_nsec;          /* Nanoseconds of the two times, or zero */
+  uint32_t ctime_nsec;
+  uint64_t inode;               /* Its inode number */
+  uint64_t blockcount;
+} index_header;
+
+typedef struct index_block {
+  uint64_t end;                 /* Offset of the end of the block */
+  uint64_t lines;               /* Number of line endings in the block */
+  uint8_t bits[1 << (INDEX_HBITS - 3)];    /* Trigram hashes */
+} index_block;
+
+/* A mapped file is passed to pcre2grep() as one of these. */
+
+typedef struct mapped_file {
+  char *data;
+  PCRE2_SIZE length;
+  index_block *index;           /* The index blocks, or NULL */
+  PCRE2_SIZE index_count;
+} mapped_file;
 
 /* Actions for the -d and -D options */
 
@@ -213,19 +297,22 @@ static const char *om_separator = NULL;
 static const char *stdin_name = "(standard input)";
 static const char *output_text = NULL;
 
-static char *main_buffer = NULL;
+static THREAD_LOCAL char *main_buffer = NULL;
+static THREAD_LOCAL FILE *outfile = NULL;
 
 static int after_context = 0;
 static int before_context = 0;
 static int binary_files = BIN_BINARY;
 static int both_context = 0;
-static int bufthird = PCRE2GREP_BUFSIZE;
+static THREAD_LOCAL int bufthird = PCRE2GREP_BUFSIZE;
+static THREAD_LOCAL int bufsize = 3*PCRE2GREP_BUFSIZE;
+static int start_bufthird = PCRE2GREP_BUFSIZE;
 static int max_bufthird = PCRE2GREP_MAX_BUFSIZE;
-static int bufsize = 3*PCRE2GREP_BUFSIZE;
 static int endlinetype;
+static int thread_count = 1;
 
-static unsigned long int total_count = 0;
-static unsigned long int counts_printed = 0;
+static THREAD_LOCAL unsigned long int total_count = 0;
+static THREAD_LOCAL unsigned long int counts_printed = 0;
 
 #ifdef WIN32
 static int dee_action = dee_SKIP;
@@ -234,7 +321,7 @@ static int dee_action = dee_READ;
 #endif
 
 static int DEE_action = DEE_READ;
-static int error_count = 0;
+static THREAD_LOCAL int error_count = 0;
 static int filenames = FN_DEFAULT;
 
 #ifdef SUPPORT_PCRE2GREP_JIT
@@ -243,6 +330,11 @@ static BOOL use_jit = TRUE;
 static BOOL use_jit = FALSE;
 #endif
 
+static BOOL use_mmap = FALSE;
+
+static BOOL use_scan = TRUE;
+static BOOL use_index = FALSE;
+
 static const uint8_t *character_tables = NULL;
 
 static uint32_t pcre2_options = 0;
@@ -253,8 +345,11 @@ static uint32_t depth_limit = 0;
 
 static pcre2_compile_context *compile_context;
 static pcre2_match_context *match_context;
-static pcre2_match_data *match_data;
-static PCRE2_SIZE *offsets;
+static pcre2_code *scan_code = NULL;
+static uint32_t *index_hashes = NULL;
+static int index_hash_count = 0;
+static THREAD_LOCAL pcre2_match_data *match_data;
+static THREAD_LOCAL PCRE2_SIZE *offsets;
 static uint32_t offset_size;
 static uint32_t capture_max = DEFAULT_CAPTURE_MAX;
 
@@ -264,19 +359,26 @@ static BOOL do_colour = FALSE;
 static BOOL do_ansi = FALSE;
 #endif
 static BOOL file_offsets = FALSE;
-static BOOL hyphenpending = FALSE;
+static THREAD_LOCAL BOOL hyphenpending = FALSE;
 static BOOL invert = FALSE;
 static BOOL line_buffered = FALSE;
 static BOOL line_offsets = FALSE;
 static BOOL multiline = FALSE;
 static BOOL number = FALSE;
 static BOOL omit_zero_count = FALSE;
-static BOOL resource_error = FALSE;
+static THREAD_LOCAL BOOL resource_error = FALSE;
 static BOOL quiet = FALSE;
 static BOOL show_total_count = FALSE;
 static BOOL silent = FALSE;
 static BOOL utf = FALSE;
 
+#ifdef SUPPORT_PCRE2GREP_THREADS
+static THREAD_LOCAL BOOL lines_started = FALSE;
+static THREAD_LOCAL struct filejob *output_job = NULL;
+static THREAD_LOCAL long int output_check = 0;
+static void check_job_output(void);
+#endif
+
 /* Structure for list of --only-matching capturing numbers. */
 
 typedef struct omstr {
@@ -407,6 +509,11 @@ used to identify them. */
 #define N_OM_SEPARATOR (-22)
 #define N_MAX_BUFSIZE  (-23)
 #define N_OM_CAPTURE   (-24)
+#define N_THREADS      (-25)
+#define N_NOMMAP       (-26)
+#define N_NOSCAN       (-27)
+#define N_INDEX        (-28)
+#define N_MMAP         (-29)
 
 static option_item optionlist[] = {
   { OP_NODATA,     N_NULL,   NULL,              "",              "terminate options" },
@@ -415,7 +522,7 @@ static option_item optionlist[] = {
   { OP_NODATA,     'a',      NULL,              "text",          "treat binary files as text" },
   { OP_NUMBER,     'B',      &before_context,   "before-context=number", "set number of prior context lines" },
   { OP_BINFILES,   N_BINARY_FILES, NULL,        "binary-files=word", "set treatment of binary files" },
-  { OP_NUMBER,     N_BUFSIZE,&bufthird,         "buffer-size=number", "set processing buffer starting size" },
+  { OP_NUMBER,     N_BUFSIZE,&start_bufthird, "buffer-size=number", "set processing buffer starting size" },
   { OP_NUMBER,     N_MAX_BUFSIZE,&max_bufthird, "max-buffer-size=number",  "set processing buffer maximum size" },
   { OP_OP_STRING,  N_COLOUR, &colour_option,    "color=option",  "matched text color option" },
   { OP_OP_STRING,  N_COLOUR, &colour_option,    "colour=option", "matched text colour option" },
@@ -432,6 +539,11 @@ static option_item optionlist[] = {
   { OP_NODATA,     'h',      NULL,              "no-filename",   "suppress the prefixing filename on output" },
   { OP_NODATA,     'I',      NULL,              "",              "treat binary files as not matching (ignore)" },
   { OP_NODATA,     'i',      NULL,              "ignore-case",   "ignore case distinctions" },
+#ifdef USE_MMAP
+  { OP_NODATA,     N_INDEX,  NULL,              "index",         "keep an index file for each mapped file" },
+#else
+  { OP_NODATA,     N_INDEX,  NULL,              "index",         "ignored: this pcre2grep does not map files" },
+#endif
   { OP_NODATA,     'l',      NULL,              "files-with-matches", "print only FILE names containing matches" },
   { OP_NODATA,     'L',      NULL,              "files-without-match","print only FILE names not containing matches" },
   { OP_STRING,     N_LABEL,  &stdin_name,       "label=name",    "set name for standard input" },
@@ -443,6 +555,11 @@ static option_item optionlist[] = {
   { OP_U32NUMBER,  N_M_LIMIT_DEP, &depth_limit, "depth-limit=number", "set PCRE2 depth limit option" },
   { OP_U32NUMBER,  N_M_LIMIT_DEP, &depth_limit, "recursion-limit=number", "obsolete synonym for depth-limit" },
   { OP_NODATA,     'M',      NULL,              "multiline",     "run in multiline mode" },
+#ifdef USE_MMAP
+  { OP_NODATA,     N_MMAP,   NULL,              "mmap",          "map regular files into memory instead of reading them" },
+#else
+  { OP_NODATA,     N_MMAP,   NULL,              "mmap",          "ignored: this pcre2grep does not map files" },
+#endif
   { OP_STRING,     'N',      &newline_arg,      "newline=type",  "set newline type (CR, LF, CRLF, ANYCRLF, ANY, or NUL)" },
   { OP_NODATA,     'n',      NULL,              "line-number",   "print line number with output lines" },
 #ifdef SUPPORT_PCRE2GREP_JIT
@@ -450,6 +567,12 @@ static option_item optionlist[] = {
 #else
   { OP_NODATA,     N_NOJIT,  NULL,              "no-jit",        "ignored: this pcre2grep does not support JIT" },
 #endif
+#ifdef USE_MMAP
+  { OP_NODATA,     N_NOMMAP, NULL,              "no-mmap",       "read files into a buffer instead of mapping them" },
+#else
+  { OP_NODATA,     N_NOMMAP, NULL,              "no-mmap",       "ignored: this pcre2grep does not map files" },
+#endif
+  { OP_NODATA,     N_NOSCAN, NULL,              "no-buffer-scan", "match every line instead of scanning for matches" },
   { OP_STRING,     'O',      &output_text,       "output=text",   "show only this text (possibly expanded)" },
   { OP_OP_NUMBERS, 'o',      &only_matching_data, "only-matching=n", "show only the part of the line that matched" },
   { OP_STRING,     N_OM_SEPARATOR, &om_separator, "om-separator=text", "set separator for multiple -o output" },
@@ -467,6 +590,11 @@ static option_item optionlist[] = {
 #endif
   { OP_NODATA,    's',      NULL,              "no-messages",   "suppress error messages" },
   { OP_NODATA,    't',      NULL,              "total-count",   "print total count of matching lines" },
+#ifdef SUPPORT_PCRE2GREP_THREADS
+  { OP_NUMBER,    N_THREADS, &thread_count,    "threads=number", "search files using this many threads" },
+#else
+  { OP_NUMBER,    N_THREADS, &thread_count,    "threads=number", "ignored: this pcre2grep does not support threads" },
+#endif
   { OP_NODATA,    'u',      NULL,              "utf",           "use UTF mode" },
   { OP_NODATA,    'U',      NULL,              "utf-allow-invalid", "use UTF mode, allow for invalid code units" },
   { OP_NODATA,    'V',      NULL,              "version",       "print version information and exit" },
@@ -896,9 +1024,9 @@ static void
 print_match(const void *buf, int length)
 {
 if (length == 0) return;
-if (do_colour) fprintf(stdout, "%c[%sm", 0x1b, colour_string);
-FWRITE_IGNORE(buf, 1, length, stdout);
-if (do_colour) fprintf(stdout, "%c[0m", 0x1b);
+if (do_colour) fprintf(outfile, "%c[%sm", 0x1b, colour_string);
+FWRITE_IGNORE(buf, 1, length, outfile);
+if (do_colour) fprintf(outfile, "%c[0m", 0x1b);
 }
 
 /* End of Unix-style or native z/OS environment functions. */
@@ -1034,13 +1162,13 @@ print_match(const void *buf, int length)
 if (length == 0) return;
 if (do_colour)
   {
-  if (do_ansi) fprintf(stdout, "%c[%sm", 0x1b, colour_string);
+  if (do_ansi) fprintf(outfile, "%c[%sm", 0x1b, colour_string);
     else SetConsoleTextAttribute(hstdout, match_colour);
   }
-FWRITE_IGNORE(buf, 1, length, stdout);
+FWRITE_IGNORE(buf, 1, length, outfile);
 if (do_colour)
   {
-  if (do_ansi) fprintf(stdout, "%c[0m", 0x1b);
+  if (do_ansi) fprintf(outfile, "%c[0m", 0x1b);
     else SetConsoleTextAttribute(hstdout, csbi.wAttributes);
   }
 }
@@ -1091,7 +1219,7 @@ static void
 print_match(const void *buf, int length)
 {
 if (length == 0) return;
-FWRITE_IGNORE(buf, 1, length, stdout);
+FWRITE_IGNORE(buf, 1, length, outfile);
 }
 
 #endif  /* End of system-specific functions */
@@ -1164,6 +1292,10 @@ printf("Non-fork callout scripts in patterns are supported." STDOUT_NL);
 printf("Callout scripts are not supported in this pcre2grep." STDOUT_NL);
 #endif
 
+#ifdef SUPPORT_PCRE2GREP_THREADS
+printf("Files can be searched in parallel by using --threads." STDOUT_NL);
+#endif
+
 printf("\"-\" can be used as a file name to mean STDIN." STDOUT_NL);
 
 #ifdef SUPPORT_LIBZ
@@ -1405,8 +1537,8 @@ switch(endlinetype)
   {
   default:      /* Just in case */
   case PCRE2_NEWLINE_LF:
-  while (p < endptr && *p != '\n') p++;
-  if (p < endptr)
+  p = (char *)memchr(p, '\n', endptr - p);
+  if (p != NULL)
     {
     *lenptr = 1;
     return p + 1;
@@ -1415,8 +1547,8 @@ switch(endlinetype)
   return endptr;
 
   case PCRE2_NEWLINE_CR:
-  while (p < endptr && *p != '\r') p++;
-  if (p < endptr)
+  p = (char *)memchr(p, '\r', endptr - p);
+  if (p != NULL)
     {
     *lenptr = 1;
     return p + 1;
@@ -1425,8 +1557,8 @@ switch(endlinetype)
   return endptr;
 
   case PCRE2_NEWLINE_NUL:
-  while (p < endptr && *p != '\0') p++;
-  if (p < endptr)
+  p = (char *)memchr(p, '\0', endptr - p);
+  if (p != NULL)
     {
     *lenptr = 1;
     return p + 1;
@@ -1437,7 +1569,8 @@ switch(endlinetype)
   case PCRE2_NEWLINE_CRLF:
   for (;;)
     {
-    while (p < endptr && *p != '\r') p++;
+    char *cr = (char *)memchr(p, '\r', endptr - p);
+    p = (cr == NULL)? endptr : cr;
     if (++p >= endptr)
       {
       *lenptr = 0;
@@ -1582,7 +1715,7 @@ switch(endlinetype)
 
   case PCRE2_NEWLINE_CR:
   p--;
-  while (p > startptr && p[-1] != '\n') p--;
+  while (p > startptr && p[-1] != '\r') p--;
   return p;
 
   case PCRE2_NEWLINE_NUL:
@@ -1665,6 +1798,440 @@ switch(endlinetype)
 
 
 
+/*************************************************
+*      Count single-character newlines           *
+*************************************************/
+
+/* This is used for counting the lines that are skipped after a scan. The data
+is processed a machine word at a time. After an exclusive OR with the newline
+character in every byte, a newline is a zero byte, and the zero-byte test
+below sets just the top bit of each such byte. Shifting those bits down and
+multiplying by a word of ones adds them up in the top byte.
+
+Arguments:
+  p         start of the data
+  endptr    end of the data
+  nl        the newline character
+
+Returns:    the number of newlines
+*/
+
+static unsigned long int
+count_newlines(char *p, char *endptr, char nl)
+{
+const size_t ones = ~(size_t)0 / 0xff;
+const size_t low7bits = ones * 0x7f;
+const size_t nlbytes = ones * (unsigned char)nl;
+unsigned long int count = 0;
+
+while (endptr - p >= (int)sizeof(size_t))
+  {
+  size_t word;
+  memcpy(&word, p, sizeof(size_t));
+  word ^= nlbytes;
+  word = ~(((word & low7bits) + low7bits) | word | low7bits);
+  count += (unsigned long int)
+    (((word >> 7) * ones) >> ((sizeof(size_t) - 1) * 8));
+  p += sizeof(size_t);
+  }
+
+for (; p < endptr; p++) if (*p == nl) count++;
+return count;
+}
+
+
+
+/*************************************************
+*         Skip lines before a position           *
+*************************************************/
+
+/* This is called when a scan of the buffer has found the first place where a
+match may start. It moves past the lines that end before that position. When
+the newline is a single character, the start of the line containing the
+position is found directly and the newlines before it are just counted.
+Otherwise the lines are stepped over one by one. A line with no terminator is
+never skipped.
+
+Arguments:
+  p         start of the first line
+  scanptr   the position that was found
+  endptr    end of available data
+  lnptr     pointer to the line number, which is updated
+
+Returns:    pointer to the start of the line containing scanptr
+*/
+
+static char *
+skip_lines(char *p, char *scanptr, char *endptr, unsigned long int *lnptr)
+{
+char nl;
+char *linestart;
+unsigned long int linenumber = *lnptr;
+
+switch(endlinetype)
+  {
+  case PCRE2_NEWLINE_LF: nl = '\n'; break;
+  case PCRE2_NEWLINE_CR: nl = '\r'; break;
+  case PCRE2_NEWLINE_NUL: nl = '\0'; break;
+
+  default:
+  for (;;)
+    {
+    int ellength;
+    char *pp = end_of_line(p, endptr, &ellength);
+    if (ellength == 0 || pp > scanptr) break;
+    linenumber++;
+    p = pp;
+    }
+  *lnptr = linenumber;
+  return p;
+  }
+
+linestart = scanptr;
+while (linestart > p && linestart[-1] != nl) linestart--;
+*lnptr = linenumber + count_newlines(p, linestart, nl);
+return linestart;
+}
+
+
+
+#ifdef USE_MMAP
+
+/*************************************************
+*          Index files for mapped files          *
+*************************************************/
+
+/* With --index, each mapped file is given an index file, whose name is the
+file's name with INDEX_SUFFIX added. The file is divided into blocks of whole
+lines, each at least INDEX_BLOCK bytes long except the last. For each block the
+index records where the block ends, how many lines it contains, and a bit map
+of hashes of the trigrams (sequences of three bytes, with ASCII letters folded
+to lower case) that occur in it. When a buffer is scanned with a single pattern
+(see pcre2grep()), the trigrams that any match must contain are found from the
+pattern, and blocks that do not contain all of them are skipped without being
+read. An index is rebuilt if the size, modification or status change time, or
+inode of the file, or the newline convention, is not the same as when it was
+built. The status change time is set by every write, and cannot be set back as
+the modification time can. The times are compared to the nanosecond where
+struct stat has them. An index is in the host's byte order, and is not meant to
+be moved to another system.
+
+A trigram is kept in the low 24 bits of a 32-bit value, which is hashed by a
+multiplication. */
+
+#define INDEX_FOLD(c) (((c) >= 'A' && (c) <= 'Z')? (c) + ('a' - 'A') : (c))
+#define INDEX_HASH(t) (((t) * 2654435761u) >> (32 - INDEX_HBITS))
+
+
+
+/*************************************************
+*         Build the index of a mapped file       *
+*************************************************/
+
+/*
+Arguments:
+  mf        the mapped file; its index and index_count are set
+
+Returns:    nothing; the index is left NULL if there is no memory
+*/
+
+static void
+index_build(mapped_file *mf)
+{
+char *p = mf->data;
+char *endptr = mf->data + mf->length;
+index_block *blocks = (index_block *)malloc(
+  (mf->length/INDEX_BLOCK + 1) * sizeof(index_block));
+
+mf->index = blocks;
+mf->index_count = 0;
+if (blocks == NULL) return;
+
+while (p < endptr)
+  {
+  index_block *b = blocks + mf->index_count++;
+  char *start = p;
+  char *target = (endptr - p > INDEX_BLOCK)? p + INDEX_BLOCK : endptr;
+  uint32_t t;
+
+  b->lines = 0;
+  while (p < target)
+    {
+    int ellength;
+    p = end_of_line(p, endptr, &ellength);
+    if (ellength > 0) b->lines++;
+    }
+  b->end = (uint64_t)(p - mf->data);
+
+  memset(b->bits, 0, sizeof(b->bits));
+  if (p - start < 3) continue;
+  t = INDEX_FOLD((unsigned char)start[0]) << 8 |
+      INDEX_FOLD((unsigned char)start[1]);
+  for (start += 2; start < p; start++)
+    {
+    uint32_t h;
+    t = ((t << 8) | INDEX_FOLD((unsigned char)*start)) & 0xffffff;
+    h = INDEX_HASH(t);
+    b->bits[h >> 3] |= 1u << (h & 7);
+    }
+  }
+}
+
+
+
+/*************************************************
+*         Read or write an index file            *
+*************************************************/
+
+/* The index that is read must be for the current size, times, and inode of
+the file, and the current newline convention, and its blocks must cover the
+file exactly.
+
+Arguments:
+  indexname   the name of the index file
+  statbuf     the result of fstat() on the file
+  mf          the mapped file; its index and index_count are set
+
+Returns:      nothing; the index is left NULL if it cannot be used
+*/
+
+static void
+index_read(const char *indexname, struct stat *statbuf, mapped_file *mf)
+{
+index_header h;
+index_block *blocks = NULL;
+FILE *f = fopen(indexname, "rb");
+
+mf->index = NULL;
+if (f == NULL) return;
+
+if (fread(&h, sizeof(h), 1, f) == 1 &&
+    memcmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) == 0 &&
+    h.version == INDEX_VERSION &&
+    h.newline == (uint32_t)endlinetype &&
+    h.size == (uint64_t)statbuf->st_size &&
+    h.mtime == (int64_t)statbuf->st_mtime &&
+    h.mtime_nsec == (uint32_t)STAT_NSEC(statbuf, m) &&
+    h.ctime == (int64_t)statbuf->st_ctime &&
+    h.ctime_nsec == (uint32_t)STAT_NSEC(statbuf, c) &&
+    h.inode == (uint64_t)statbuf->st_ino &&
+    h.blockcount > 0 && h.blockcount <= h.size/INDEX_BLOCK + 1 &&
+    (blocks = (index_block *)malloc(h.blockcount * sizeof(index_block)))
+      != NULL &&
+    fread(blocks, sizeof(index_block), h.blockcount, f) == h.blockcount)
+  {
+  uint64_t i;
+  uint64_t last = 0;
+
+  for (i = 0; i < h.blockcount; i++)
+    {
+    if (blocks[i].end <= last) break;
+    last = blocks[i].end;
+    }
+
+  if (i == h.blockcount && last == h.size)
+    {
+    mf->index = blocks;
+    mf->index_count = (PCRE2_SIZE)h.blockcount;
+    blocks = NULL;
+    }
+  }
+
+free(blocks);
+fclose(f);
+}
+
+
+/* The index is written to a temporary file, which is then renamed, so that a
+partly written index is never seen. The temporary file is created exclusively,
+and if that fails (for example, because the directory cannot be written, or
+another thread is writing the same index), the index is not saved. Errors are
+otherwise ignored, because the search can go on without the index. Because file
+times may be recorded only in seconds, the index is not saved if the file was
+modified in the current second, as another change in the same second might not
+be detected.
+
+Arguments:
+  indexname   the name of the index file
+  statbuf     the result of fstat() on the file
+  mf          the mapped file, with its index
+
+Returns:      nothing
+*/
+
+static void
+index_write(const char *indexname, struct stat *statbuf, mapped_file *mf)
+{
+char tempname[FNBUFSIZ];
+index_header h;
+FILE *f;
+BOOL ok;
+int fd;
+
+if (statbuf->st_mtime >= time(NULL)) return;
+if (snprintf(tempname, sizeof(tempname), "%s.%d", indexname, (int)getpid())
+    >= (int)sizeof(tempname))
+  return;
+
+fd = open(tempname, O_WRONLY|O_CREAT|O_EXCL, 0666);
+if (fd < 0) return;
+f = fdopen(fd, "wb");
+if (f == NULL)
+  {
+  close(fd);
+  unlink(tempname);
+  return;
+  }
+
+memset(&h, 0, sizeof(h));
+memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+h.version = INDEX_VERSION;
+h.newline = (uint32_t)endlinetype;
+h.size = (uint64_t)statbuf->st_size;
+h.mtime = (int64_t)statbuf->st_mtime;
+h.mtime_nsec = (uint32_t)STAT_NSEC(statbuf, m);
+h.ctime = (int64_t)statbuf->st_ctime;
+h.ctime_nsec = (uint32_t)STAT_NSEC(statbuf, c);
+h.inode = (uint64_t)statbuf->st_ino;
+h.blockcount = (uint64_t)mf->index_count;
+
+ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+     fwrite(mf->index, sizeof(index_block), mf->index_count, f) ==
+       mf->index_count;
+if (fclose(f) != 0) ok = FALSE;
+if (!ok || rename(tempname, indexname) != 0) unlink(tempname);
+}
+
+
+
+/*************************************************
+*        Set up the index of a mapped file       *
+*************************************************/
+
+/* This is called from grep_file() for a newly mapped file when --index is set.
+If there is no usable index file, the index is built and saved. The index is
+kept for the search only if the pattern has yielded some trigrams.
+
+Arguments:
+  pathname    the name of the file
+  statbuf     the result of fstat() on the file
+  mf          the mapped file; its index and index_count are set
+
+Returns:      nothing
+*/
+
+static void
+index_open(const char *pathname, struct stat *statbuf, mapped_file *mf)
+{
+char indexname[FNBUFSIZ];
+
+mf->index = NULL;
+if (strlen(pathname) + sizeof(INDEX_SUFFIX) > sizeof(indexname)) return;
+sprintf(indexname, "%s%s", pathname, INDEX_SUFFIX);
+
+index_read(indexname, statbuf, mf);
+if (mf->index == NULL)
+  {
+  index_build(mf);
+  if (mf->index != NULL) index_write(indexname, statbuf, mf);
+  }
+
+if (index_hash_count == 0)
+  {
+  free(mf->index);
+  mf->index = NULL;
+  }
+}
+
+
+
+/*************************************************
+*       Skip blocks that cannot match            *
+*************************************************/
+
+/* A block may contain a match only if it contains every trigram that the
+pattern requires. */
+
+static BOOL
+index_candidate(index_block *b)
+{
+int i;
+for (i = 0; i < index_hash_count; i++)
+  {
+  uint32_t h = index_hashes[i];
+  if ((b->bits[h >> 3] & (1u << (h & 7))) == 0) return FALSE;
+  }
+return TRUE;
+}
+
+
+/* This is called before a scan of a mapped file that has an index. If the
+block that contains the current point cannot contain a match, the rest of it
+and any following blocks that cannot match are skipped. The lines in whole
+blocks are counted from the index, so those blocks are not read. The end of
+the run of blocks that may match is also found, because there is no need to
+scan beyond it.
+
+Arguments:
+  mf         the mapped file
+  p          the start of the current line
+  scanend    where to return the end of the blocks that may match
+  lnptr      pointer to the line number, which is updated
+
+Returns:     pointer to the start of the line from which to scan
+*/
+
+static char *
+index_skip(mapped_file *mf, char *p, char **scanend, unsigned long int *lnptr)
+{
+index_block *blocks = mf->index;
+char *endptr = mf->data + mf->length;
+uint64_t offset = (uint64_t)(p - mf->data);
+PCRE2_SIZE lo = 0;
+PCRE2_SIZE hi = mf->index_count - 1;
+
+/* Find the block that contains the current point. */
+
+while (lo < hi)
+  {
+  PCRE2_SIZE mid = (lo + hi)/2;
+  if (blocks[mid].end > offset) hi = mid; else lo = mid + 1;
+  }
+
+if (!index_candidate(blocks + lo))
+  {
+  char *blockend = mf->data + blocks[lo].end;
+
+  /* An unterminated last line is not skipped (see skip_lines()). */
+
+  p = skip_lines(p, blockend, endptr, lnptr);
+  if (p != blockend)
+    {
+    *scanend = endptr;
+    return p;
+    }
+
+  while (++lo < mf->index_count && !index_candidate(blocks + lo))
+    {
+    *lnptr += (unsigned long int)blocks[lo].lines;
+    p = mf->data + blocks[lo].end;
+    }
+
+  if (lo >= mf->index_count)
+    {
+    *scanend = endptr;
+    return p;
+    }
+  }
+
+while (lo + 1 < mf->index_count && index_candidate(blocks + lo + 1)) lo++;
+*scanend = mf->data + blocks[lo].end;
+return p;
+}
+#endif  /* USE_MMAP */
+
+
+
 /*************************************************
 *              Output newline at end             *
 *************************************************/
@@ -1685,19 +2252,19 @@ switch(endlinetype)
   case PCRE2_NEWLINE_LF:
   case PCRE2_NEWLINE_ANY:
   case PCRE2_NEWLINE_ANYCRLF:
-  fprintf(stdout, "\n");
+  fprintf(outfile, "\n");
   break;
 
   case PCRE2_NEWLINE_CR:
-  fprintf(stdout, "\r");
+  fprintf(outfile, "\r");
   break;
 
   case PCRE2_NEWLINE_CRLF:
-  fprintf(stdout, "\r\n");
+  fprintf(outfile, "\r\n");
   break;
 
   case PCRE2_NEWLINE_NUL:
-  fprintf(stdout, "%c", 0);
+  fprintf(outfile, "%c", 0);
   break;
   }
 }
@@ -1715,6 +2282,7 @@ Arguments:
   lastmatchnumber   the number of the last matching line, plus one
   lastmatchrestart  where we restarted after the last match
   endptr            end of available data
+  bufend            end of the buffer, or NULL if the whole file is mapped
   printname         filename for printing
 
 Returns:            nothing
@@ -1722,7 +2290,7 @@ Returns:            nothing
 
 static void
 do_after_lines(unsigned long int lastmatchnumber, char *lastmatchrestart,
-  char *endptr, const char *printname)
+  char *endptr, char *bufend, const char *printname)
 {
 if (after_context > 0 && lastmatchnumber > 0)
   {
@@ -1731,10 +2299,10 @@ if (after_context > 0 && lastmatchnumber > 0)
   while (lastmatchrestart < endptr && count < after_context)
     {
     char *pp = end_of_line(lastmatchrestart, endptr, &ellength);
-    if (ellength == 0 && pp == main_buffer + bufsize) break;
-    if (printname != NULL) fprintf(stdout, "%s-", printname);
-    if (number) fprintf(stdout, "%lu-", lastmatchnumber++);
-    FWRITE_IGNORE(lastmatchrestart, 1, pp - lastmatchrestart, stdout);
+    if (ellength == 0 && pp == bufend) break;
+    if (printname != NULL) fprintf(outfile, "%s-", printname);
+    if (number) fprintf(outfile, "%lu-", lastmatchnumber++);
+    FWRITE_IGNORE(lastmatchrestart, 1, pp - lastmatchrestart, outfile);
     lastmatchrestart = pp;
     count++;
     }
@@ -1823,47 +2391,410 @@ return FALSE;  /* No match, no errors */
 }
 
 
+
 /*************************************************
-*          Check output text for errors          *
+*   Check whether a pattern can scan a buffer    *
 *************************************************/
 
+/* When there is just one pattern, pcre2grep() can find the next line that may
+match by running the pattern once over the rest of the buffer instead of over
+each line in turn. This is valid only if every match within a line is also
+found, at the same or an earlier position, when the line is followed by a
+newline and more text. Nothing may prevent backtracking or depend on a failure:
+negative assertions, conditions, atomic groups, possessive quantifiers, and
+backtracking verbs are not allowed. The \A, \G, \z, and \Z assertions behave
+differently, as do ^ and $ if multiline mode is unset, and callouts would be
+run too often.
+
+Items that can match a newline are not allowed either. They could only find
+extra matches, which are rejected when the line is matched on its own, but a
+lazy repeat such as [\s\S]*? could then run on for the rest of the buffer from
+every line, making the search quadratic. These are negated classes, the POSIX
+space and cntrl classes, control characters, escapes for such characters and
+for character types or properties that include them, and dot when (?s) is set.
+This is a simple textual check that may reject some patterns unnecessarily.
+
+Argument:  the pattern block
+Returns:   TRUE if the pattern can be used to scan a buffer
+*/
+
 static BOOL
-syntax_check_output_text(PCRE2_SPTR string, BOOL callout)
+pattern_can_scan(patstr *p)
 {
-PCRE2_SPTR begin = string;
-for (; *string != 0; string++)
+static const char *unsafe[] = { "(?!", "(?<!", "(?(", "(?>", "(?C", "(*",
+  "\\A", "\\G", "\\z", "\\Z", "++", "*+", "?+", "}+", "[^", "[:^",
+  "[:space:]", "[:cntrl:]", "\\N{", NULL };
+static const char *newline_escapes = "CDPRWXcfnoprsuvx";
+char *ps = p->string;
+char *pe = ps + p->length;
+
+for (; ps < pe; ps++)
   {
-  if (*string == '$')
+  const char **u;
+  for (u = unsafe; *u != NULL; u++)
     {
-    PCRE2_SIZE capture_id = 0;
-    BOOL brace = FALSE;
+    size_t len = strlen(*u);
+    if ((size_t)(pe - ps) >= len && memcmp(ps, *u, len) == 0) return FALSE;
+    }
 
-    string++;
+  /* Control characters in the pattern are not allowed, because they may be
+  the ends of ranges. */
 
-    /* Syntax error: a character must be present after $. */
-    if (*string == 0)
-      {
-      if (!callout)
-        fprintf(stderr, "pcre2grep: Error in output text at offset %d: %s\n",
-          (int)(string - begin), "no character after $");
+  if ((unsigned char)*ps < 0x20 && *ps != '\t') return FALSE;
+
+  /* An escape for a character that may be a newline, or for a type that
+  includes newlines, is not allowed. \N is allowed on its own. An escape that
+  starts a range, such as \t-~, or that may be an octal number is not allowed.
+  The escaped character is then skipped, so that \[^ is not rejected. */
+
+  if (ps[0] == '\\' && pe - ps > 1)
+    {
+    int c = (unsigned char)ps[1];
+    if (strchr(newline_escapes, c) != NULL) return FALSE;
+    if (c == '0' ||
+        (isdigit(c) && pe - ps > 2 && isdigit((unsigned char)ps[2])))
       return FALSE;
-      }
+    if (isalnum(c) && pe - ps > 2 && ps[2] == '-') return FALSE;
+    ps++;
+    continue;
+    }
 
-    if (*string == '{')
-      {
-      /* Must be a decimal number in braces, e.g: {5} or {38} */
-      string++;
+  /* An option setting such as (?-m) or (?^) may unset multiline mode, and
+  (?s) lets dot match a newline. */
 
-      brace = TRUE;
-      }
+  if (ps[0] == '(' && pe - ps > 1 && ps[1] == '?')
+    {
+    char *pp = ps + 2;
+    while (pp < pe && isalpha((unsigned char)*pp))
+      if (*pp++ == 's') return FALSE;
+    if (pp < pe && (*pp == '-' || *pp == '^')) return FALSE;
+    }
+  }
 
-    if ((*string >= '1' && *string <= '9') || (!callout && *string == '0'))
-      {
-      do
-        {
-        /* Maximum capture id is 65535. */
-        if (capture_id <= 65535)
-          capture_id = capture_id * 10 + (*string - '0');
+return TRUE;
+}
+
+
+#ifdef USE_MMAP
+
+/*************************************************
+*    Find the trigrams that a match must have    *
+*************************************************/
+
+/* These functions are used with --index. They make a simple textual analysis
+of the scan pattern, like pattern_can_scan(), to find runs of literal
+characters that any match must contain, and a hash of each trigram in these
+runs is saved in index_hashes (see index_build() above). A character that is
+followed by a quantifier that allows fewer than one repeat is dropped, and one
+that may be repeated ends a run. Groups and character classes are skipped
+over. The analysis gives up, and finds no trigrams, for an alternation at the
+top level, an option setting that includes x, and any escape sequence other
+than a few simple ones. Non-ASCII bytes end a run, because they cannot be
+caselessly matched by folding bytes, and in UTF mode so do k and s, which have
+non-ASCII case equivalents (U+212A and U+017F). */
+
+/* Skip a character class, starting just after its opening bracket. A POSIX
+class name is recognized as in pcre2_compile().
+
+Arguments:
+  ps        the current point in the pattern
+  pe        the end of the pattern
+
+Returns:    pointer after the class, or NULL if it is not understood
+*/
+
+static char *
+skip_class(char *ps, char *pe)
+{
+if (ps < pe && *ps == '^') ps++;
+if (ps < pe && *ps == ']') ps++;
+
+while (ps < pe)
+  {
+  char c = *ps++;
+  if (c == ']') return ps;
+  if (c == '\\')
+    {
+    if (ps >= pe || *ps == 'Q') return NULL;
+    ps++;
+    }
+  else if (c == '[' && ps < pe && (*ps == ':' || *ps == '.' || *ps == '='))
+    {
+    char term = *ps;
+    char *pp;
+    for (pp = ps + 1; pp < pe - 1; pp++)
+      {
+      if (*pp == '\\' && (pp[1] == ']' || pp[1] == '\\')) pp++;
+      else if ((*pp == '[' && pp[1] == term) || *pp == ']') break;
+      else if (*pp == term && pp[1] == ']')
+        {
+        ps = pp + 2;
+        break;
+        }
+      }
+    }
+  }
+
+return NULL;
+}
+
+
+/* Skip a group, starting just after its opening parenthesis.
+
+Arguments:
+  ps        the current point in the pattern
+  pe        the end of the pattern
+
+Returns:    pointer after the group, or NULL if it is not understood
+*/
+
+static char *
+skip_group(char *ps, char *pe)
+{
+int depth = 1;
+
+while (ps < pe)
+  {
+  char c = *ps++;
+  switch(c)
+    {
+    case '\\':
+    if (ps >= pe || *ps == 'Q') return NULL;
+    ps++;
+    break;
+
+    case '[':
+    ps = skip_class(ps, pe);
+    if (ps == NULL) return NULL;
+    break;
+
+    case '(':
+    if (pe - ps > 1 && ps[0] == '?' && ps[1] == '#')
+      {
+      ps = memchr(ps, ')', pe - ps);
+      if (ps == NULL) return NULL;
+      ps++;
+      }
+    else depth++;
+    break;
+
+    case ')':
+    if (--depth == 0) return ps;
+    break;
+    }
+  }
+
+return NULL;
+}
+
+
+/* Skip a quantifier of the form {n}, {n,}, or {n,m}, starting at its opening
+brace.
+
+Arguments:
+  ps        the current point in the pattern
+  pe        the end of the pattern
+
+Returns:    pointer after the quantifier, or NULL if it is not one
+*/
+
+static char *
+skip_braces(char *ps, char *pe)
+{
+char *pp = ps + 1;
+while (pp < pe && isdigit((unsigned char)*pp)) pp++;
+if (pp == ps + 1) return NULL;
+if (pp < pe && *pp == ',')
+  {
+  pp++;
+  while (pp < pe && isdigit((unsigned char)*pp)) pp++;
+  }
+return (pp < pe && *pp == '}')? pp + 1 : NULL;
+}
+
+
+/* Find the trigrams for the scan pattern.
+
+Argument:  the pattern block
+Returns:   nothing; index_hashes and index_hash_count are set
+*/
+
+static void
+pattern_trigrams(patstr *p)
+{
+char *ps = p->string;
+char *pe = ps + p->length;
+BOOL literal = (pcre2_options & PCRE2_LITERAL) != 0;
+BOOL utf = (pcre2_options & PCRE2_UTF) != 0;
+BOOL quoted = FALSE;
+int pending = -1;
+int run = 0;
+uint32_t t = 0;
+uint32_t *hashes = (uint32_t *)malloc((p->length + 1) * sizeof(uint32_t));
+int count = 0;
+
+if (hashes == NULL) return;
+
+/* A pending character is added to the current run when it is known that it
+is not followed by a quantifier. */
+
+#define ADD_PENDING \
+  if (pending >= 0) \
+    { \
+    t = ((t << 8) | INDEX_FOLD(pending)) & 0xffffff; \
+    if (++run >= 3) hashes[count++] = INDEX_HASH(t); \
+    pending = -1; \
+    }
+
+while (ps < pe)
+  {
+  int c = (unsigned char)*ps++;
+
+  if (quoted)
+    {
+    if (c == '\\' && ps < pe && *ps == 'E')
+      {
+      ps++;
+      quoted = FALSE;
+      continue;
+      }
+    }
+
+  else if (!literal) switch(c)
+    {
+    case '\\':
+    if (ps >= pe) goto GIVE_UP;
+    c = (unsigned char)*ps++;
+    if (c == 'Q')
+      {
+      quoted = TRUE;
+      continue;
+      }
+    if (c == 'E') continue;
+    if (isalnum(c))
+      {
+      if (strchr("bBdDhHRsSvVwWXKCntrefa", c) == NULL) goto GIVE_UP;
+      c = -1;
+      }
+    break;
+
+    case '.':
+    case '^':
+    case '$':
+    c = -1;
+    break;
+
+    case '|':
+    case ')':
+    goto GIVE_UP;
+
+    case '[':
+    ps = skip_class(ps, pe);
+    if (ps == NULL) goto GIVE_UP;
+    c = -1;
+    break;
+
+    case '(':
+    if (ps < pe && *ps == '?')
+      {
+      char *pp = ps + 1;
+      while (pp < pe && isalpha((unsigned char)*pp)) pp++;
+      if (pp < pe && *pp == ')')
+        {
+        if (memchr(ps + 1, 'x', pp - ps - 1) != NULL) goto GIVE_UP;
+        ps = pp + 1;
+        c = -1;
+        break;
+        }
+      }
+    ps = skip_group(ps, pe);
+    if (ps == NULL) goto GIVE_UP;
+    c = -1;
+    break;
+
+    case '{':
+      {
+      char *pp = skip_braces(ps - 1, pe);
+      if (pp == NULL) break;   /* A literal brace */
+      ps = pp;
+      }
+    /* Fall through */
+
+    case '?':
+    case '*':
+    pending = -1;
+    run = 0;
+    if (ps < pe && (*ps == '?' || *ps == '+')) ps++;
+    continue;
+
+    case '+':
+    ADD_PENDING;
+    run = 0;
+    if (ps < pe && (*ps == '?' || *ps == '+')) ps++;
+    continue;
+    }
+
+  ADD_PENDING;
+  if (c < 0 || c >= 0x80 || (utf && (c == 'k' || c == 'K' || c == 's' ||
+      c == 'S')))
+    run = 0;
+  else pending = c;
+  }
+
+ADD_PENDING;
+#undef ADD_PENDING
+
+index_hashes = hashes;
+index_hash_count = count;
+return;
+
+GIVE_UP:
+free(hashes);
+}
+#endif  /* USE_MMAP */
+
+
+/*************************************************
+*          Check output text for errors          *
+*************************************************/
+
+static BOOL
+syntax_check_output_text(PCRE2_SPTR string, BOOL callout)
+{
+PCRE2_SPTR begin = string;
+for (; *string != 0; string++)
+  {
+  if (*string == '$')
+    {
+    PCRE2_SIZE capture_id = 0;
+    BOOL brace = FALSE;
+
+    string++;
+
+    /* Syntax error: a character must be present after $. */
+    if (*string == 0)
+      {
+      if (!callout)
+        fprintf(stderr, "pcre2grep: Error in output text at offset %d: %s\n",
+          (int)(string - begin), "no character after $");
+      return FALSE;
+      }
+
+    if (*string == '{')
+      {
+      /* Must be a decimal number in braces, e.g: {5} or {38} */
+      string++;
+
+      brace = TRUE;
+      }
+
+    if ((*string >= '1' && *string <= '9') || (!callout && *string == '0'))
+      {
+      do
+        {
+        /* Maximum capture id is 65535. */
+        if (capture_id <= 65535)
+          capture_id = capture_id * 10 + (*string - '0');
 
         string++;
         }
@@ -2037,7 +2968,7 @@ for (; *string != 0; string++)
     else if (*string == 'v') ch = '\v';
     else if (*string == 'n')
       {
-      fprintf(stdout, STDOUT_NL);
+      fprintf(outfile, STDOUT_NL);
       printed = FALSE;
       }
     else if (*string == 'o')
@@ -2085,7 +3016,7 @@ for (; *string != 0; string++)
     }
   if (ch != EOF)
     {
-    fprintf(stdout, "%c", ch);
+    fprintf(outfile, "%c", ch);
     printed = TRUE;
     }
   }
@@ -2415,6 +3346,229 @@ return result != 0;
 
 
 
+#ifdef USE_READAHEAD
+
+/*************************************************
+*    Decompress files in a separate thread       *
+*************************************************/
+
+/* A compressed file is read by a reader thread, which decompresses it into a
+ring of chunks while the file is searched. The chunks are the size of the
+buffer's thirds, so each refill of the buffer normally takes one chunk. The
+reader stops when the ring is full, at the end of the file, after an error, or
+when it is told to stop because the search has finished early. */
+
+#define RA_CHUNKS 4
+
+typedef struct readahead {
+  void *handle;                 /* The gzFile or BZFILE */
+  int frtype;                   /* FR_LIBZ or FR_LIBBZ2 */
+  int chunksize;
+  int head;                     /* The next chunk to be used */
+  int count;                    /* The number of chunks filled */
+  int offset;                   /* Amount of the head chunk used */
+  int rc;                       /* Result of the last read at the end */
+  BOOL ended;                   /* The reader has finished */
+  BOOL stop;                    /* The reader must finish */
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t filled;
+  pthread_cond_t emptied;
+  int length[RA_CHUNKS];
+  char *chunk[RA_CHUNKS];
+} readahead;
+
+
+/* The reader thread function. A read that yields no data (the end of the file
+or an error) ends the reading, and its result is kept for the consumer.
+
+Argument:   the readahead block
+Returns:    NULL
+*/
+
+static void *
+readahead_thread(void *arg)
+{
+readahead *ra = (readahead *)arg;
+
+(void)pthread_mutex_lock(&ra->mutex);
+
+for (;;)
+  {
+  int i, n = 0;
+
+  while (ra->count == RA_CHUNKS && !ra->stop)
+    (void)pthread_cond_wait(&ra->emptied, &ra->mutex);
+  if (ra->stop) break;
+
+  i = (ra->head + ra->count) % RA_CHUNKS;
+  (void)pthread_mutex_unlock(&ra->mutex);
+
+#ifdef SUPPORT_LIBZ
+  if (ra->frtype == FR_LIBZ)
+    n = gzread((gzFile)ra->handle, ra->chunk[i], ra->chunksize);
+#endif
+#ifdef SUPPORT_LIBBZ2
+  if (ra->frtype == FR_LIBBZ2)
+    n = BZ2_bzread((BZFILE *)ra->handle, ra->chunk[i], ra->chunksize);
+#endif
+
+  (void)pthread_mutex_lock(&ra->mutex);
+  if (n <= 0)
+    {
+    ra->rc = n;
+    break;
+    }
+  ra->length[i] = n;
+  ra->count++;
+  (void)pthread_cond_signal(&ra->filled);
+  }
+
+ra->ended = TRUE;
+(void)pthread_cond_signal(&ra->filled);
+(void)pthread_mutex_unlock(&ra->mutex);
+return NULL;
+}
+
+
+/* Start reading a compressed file. If anything fails, the file is read in the
+searching thread as before.
+
+Arguments:
+  ra          the readahead block
+  handle      the gzFile or BZFILE
+  frtype      FR_LIBZ or FR_LIBBZ2
+
+Returns:      TRUE if the reader thread was started
+*/
+
+static BOOL
+readahead_start(readahead *ra, void *handle, int frtype)
+{
+int i;
+
+ra->handle = handle;
+ra->frtype = frtype;
+ra->chunksize = bufthird;
+ra->head = ra->count = ra->offset = ra->rc = 0;
+ra->ended = ra->stop = FALSE;
+
+for (i = 0; i < RA_CHUNKS; i++)
+  {
+  ra->chunk[i] = (char *)malloc(ra->chunksize);
+  if (ra->chunk[i] == NULL) break;
+  }
+
+if (i < RA_CHUNKS) goto FAILED;
+if (pthread_mutex_init(&ra->mutex, NULL) != 0) goto FAILED;
+if (pthread_cond_init(&ra->filled, NULL) != 0)
+  {
+  (void)pthread_mutex_destroy(&ra->mutex);
+  goto FAILED;
+  }
+if (pthread_cond_init(&ra->emptied, NULL) != 0)
+  {
+  (void)pthread_cond_destroy(&ra->filled);
+  (void)pthread_mutex_destroy(&ra->mutex);
+  goto FAILED;
+  }
+if (pthread_create(&ra->thread, NULL, readahead_thread, ra) == 0) return TRUE;
+
+(void)pthread_cond_destroy(&ra->emptied);
+(void)pthread_cond_destroy(&ra->filled);
+(void)pthread_mutex_destroy(&ra->mutex);
+
+FAILED:
+while (--i >= 0) free(ra->chunk[i]);
+return FALSE;
+}
+
+
+/* Stop the reader thread, wait for it, and free the chunks. After this, the
+file may be closed, or its error status inspected.
+
+Argument:   the readahead block
+Returns:    nothing
+*/
+
+static void
+readahead_end(readahead *ra)
+{
+int i;
+
+(void)pthread_mutex_lock(&ra->mutex);
+ra->stop = TRUE;
+(void)pthread_cond_signal(&ra->emptied);
+(void)pthread_mutex_unlock(&ra->mutex);
+(void)pthread_join(ra->thread, NULL);
+
+(void)pthread_cond_destroy(&ra->emptied);
+(void)pthread_cond_destroy(&ra->filled);
+(void)pthread_mutex_destroy(&ra->mutex);
+for (i = 0; i < RA_CHUNKS; i++) free(ra->chunk[i]);
+}
+
+
+/* Copy decompressed data into the buffer, waiting for the reader as
+necessary. Like gzread(), this returns less than was asked for only at the end
+of the file. If the reader stopped after an error, its result is returned once
+all the data before it has been used.
+
+Arguments:
+  ra          the readahead block
+  buffer      where to put the data
+  length      the amount wanted
+
+Returns:      the amount copied, or the result of the final read
+*/
+
+static int
+readahead_read(readahead *ra, char *buffer, int length)
+{
+int done = 0;
+
+(void)pthread_mutex_lock(&ra->mutex);
+
+while (done < length)
+  {
+  int i = ra->head;
+  int n;
+
+  if (ra->count == 0)
+    {
+    if (ra->ended) break;
+    (void)pthread_cond_wait(&ra->filled, &ra->mutex);
+    continue;
+    }
+
+  /* The head chunk is not touched by the reader while it is counted as
+  filled, so it can be copied without holding the mutex. */
+
+  n = ra->length[i] - ra->offset;
+  if (n > length - done) n = length - done;
+  (void)pthread_mutex_unlock(&ra->mutex);
+  memcpy(buffer + done, ra->chunk[i] + ra->offset, n);
+  (void)pthread_mutex_lock(&ra->mutex);
+
+  done += n;
+  ra->offset += n;
+  if (ra->offset == ra->length[i])
+    {
+    ra->head = (i + 1) % RA_CHUNKS;
+    ra->count--;
+    ra->offset = 0;
+    (void)pthread_cond_signal(&ra->emptied);
+    }
+  }
+
+if (done == 0) done = ra->rc;
+(void)pthread_mutex_unlock(&ra->mutex);
+return done;
+}
+#endif  /* USE_READAHEAD */
+
+
+
 /*************************************************
 *     Read a portion of the file into buffer     *
 *************************************************/
@@ -2425,6 +3579,12 @@ fill_buffer(void *handle, int frtype, char *buffer, int length,
 {
 (void)frtype;  /* Avoid warning when not used */
 
+#ifdef USE_READAHEAD
+if (frtype == FR_READAHEAD)
+  return readahead_read((readahead *)handle, buffer, length);
+else
+#endif
+
 #ifdef SUPPORT_LIBZ
 if (frtype == FR_LIBZ)
   return gzread((gzFile)handle, buffer, length);
@@ -2455,11 +3615,21 @@ context printing or for multiline scanning. For large files, the pointer will
 be in the middle third most of the time, so the bottom third is available for
 "before" context printing.
 
+When a regular file has been mapped into memory, the whole file is searched
+in place instead, and there is no limit on the length of a line.
+
+If scan_code is set, it is used to find the next line that may match by a
+single match against the rest of the buffer, and the lines before it are
+skipped without being matched individually. If a mapped file has an index, the
+blocks that cannot match are skipped before scanning.
+
 Arguments:
   handle       the fopened FILE stream for a normal file
                the gzFile pointer when reading is via libz
                the BZFILE pointer when reading is via libbz2
-  frtype       FR_PLAIN, FR_LIBZ, or FR_LIBBZ2
+               the mapped_file block for a mapped file
+               the readahead block when decompressing in another thread
+  frtype       FR_PLAIN, FR_LIBZ, FR_LIBBZ2, FR_MMAP, or FR_READAHEAD
   filename     the file name or NULL (for errors)
   printname    the file name if it is to be printed for each match
                or NULL if the file name is not to be printed
@@ -2479,36 +3649,64 @@ int filepos = 0;
 unsigned long int linenumber = 1;
 unsigned long int lastmatchnumber = 0;
 unsigned long int count = 0;
-char *lastmatchrestart = main_buffer;
-char *ptr = main_buffer;
+char *buffer = main_buffer;
+char *bufend = main_buffer + bufsize;
+char *lastmatchrestart;
+char *ptr;
 char *endptr;
+char *scanptr = NULL;
+char *scan_checked = NULL;
 PCRE2_SIZE bufflength;
 BOOL binary = FALSE;
+BOOL scanning;
 BOOL endhyphenpending = FALSE;
 BOOL lines_printed = FALSE;
 BOOL input_line_buffered = line_buffered;
 FILE *in = NULL;                    /* Ensure initialized */
+#ifdef USE_MMAP
+mapped_file *index_file = NULL;
+char *index_runend = NULL;
+#endif
 
 /* Do the first read into the start of the buffer and set up the pointer to end
 of what we have. In the case of libz, a non-zipped .gz file will be read as a
 plain file. However, if a .bz2 file isn't actually bzipped, the first read will
-fail. */
+fail. A mapped file is all available at once; bufend is set NULL because there
+is no end of buffer that a line can run into. */
 
-if (frtype != FR_LIBZ && frtype != FR_LIBBZ2)
+if (frtype == FR_PLAIN)
   {
   in = (FILE *)handle;
   if (is_file_tty(in)) input_line_buffered = TRUE;
   }
 else input_line_buffered = FALSE;
 
-bufflength = fill_buffer(handle, frtype, main_buffer, bufsize,
+if (frtype == FR_MMAP)
+  {
+  mapped_file *mf = (mapped_file *)handle;
+  buffer = mf->data;
+  bufend = NULL;
+  bufflength = mf->length;
+  }
+else bufflength = fill_buffer(handle, frtype, main_buffer, bufsize,
   input_line_buffered);
 
 #ifdef SUPPORT_LIBBZ2
 if (frtype == FR_LIBBZ2 && (int)bufflength < 0) return 2;   /* Gotcha: bufflength is PCRE2_SIZE; */
 #endif
 
-endptr = main_buffer + bufflength;
+#ifdef USE_READAHEAD
+if (frtype == FR_READAHEAD && (int)bufflength < 0) return 2;
+#endif
+
+#ifdef USE_MMAP
+if (frtype == FR_MMAP && ((mapped_file *)handle)->index != NULL)
+  index_file = (mapped_file *)handle;
+#endif
+
+lastmatchrestart = ptr = buffer;
+endptr = buffer + bufflength;
+scanning = scan_code != NULL && !input_line_buffered;
 
 /* Unless binary-files=text, see if we have a binary file. This uses the same
 rule as GNU grep, namely, a search for a binary zero byte near the start of the
@@ -2517,7 +3715,7 @@ file. However, when the newline convention is binary zero, we can't do this. */
 if (binary_files != BIN_TEXT)
   {
   if (endlinetype != PCRE2_NEWLINE_NUL)
-    binary = memchr(main_buffer, 0, (bufflength > 1024)? 1024 : bufflength)
+    binary = memchr(buffer, 0, (bufflength > 1024)? 1024 : bufflength)
       != NULL;
   if (binary && binary_files == BIN_NOMATCH) return 1;
   }
@@ -2537,24 +3735,78 @@ while (ptr < endptr)
   PCRE2_SIZE length, linelength;
   PCRE2_SIZE startoffset = 0;
 
-  /* At this point, ptr is at the start of a line. We need to find the length
-  of the subject string to pass to pcre2_match(). In multiline mode, it is the
-  length remainder of the data in the buffer. Otherwise, it is the length of
-  the next line, excluding the terminating newline. After matching, we always
-  advance by the length of the next line. In multiline mode the PCRE2_FIRSTLINE
-  option is used for compiling, so that any match is constrained to be in the
-  first line. */
+  /* If scanning, and the previous scan result has been passed, match against
+  the rest of the buffer to find the start of the next possible match, or find
+  that there is none, and skip the complete lines before it. An unterminated
+  line at the end is not skipped, because there may be more of it to read.
+  Once part of the buffer has been checked for valid UTF, that is not
+  repeated. If there is an error, matching line by line continues to the end of
+  the file.
 
-  t = end_of_line(t, endptr, &endlinelength);
-  linelength = t - ptr - endlinelength;
-  length = multiline? (PCRE2_SIZE)(endptr - ptr) : linelength;
+  If a mapped file has an index, the scan starts at the first block that may
+  match and stops at the end of the blocks that may match, which is remembered
+  until the current point passes it. If there is no match before then,
+  scanning starts again from there. */
+
+  if (scanning && (scanptr == NULL || ptr > scanptr))
+    {
+    char *scanend = endptr;
+    int src;
+
+#ifdef USE_MMAP
+    if (index_file != NULL)
+      {
+      if (index_runend == NULL || ptr >= index_runend)
+        {
+        t = index_skip(index_file, ptr, &index_runend, &linenumber);
+        filepos += (int)(t - ptr);
+        ptr = t;
+        if (ptr >= endptr) goto END_SKIP;
+        }
+      scanend = index_runend;
+      }
+#endif
+
+    src = pcre2_match(scan_code, (PCRE2_SPTR)ptr, scanend - ptr, 0,
+      (scan_checked != NULL && scanend <= scan_checked)?
+        PCRE2_NO_UTF_CHECK : 0, match_data, match_context);
+
+    if (src >= 0 || src == PCRE2_ERROR_NOMATCH)
+      {
+      scanptr = (src >= 0)? ptr + pcre2_get_startchar(match_data) : scanend;
+      if (scan_checked == NULL || scanend > scan_checked)
+        scan_checked = scanend;
+      t = skip_lines(ptr, scanptr, endptr, &linenumber);
+      if (src < 0 && scanend < endptr) scanptr = NULL;
+
+      if (t != ptr)
+        {
+        filepos += (int)(t - ptr);
+        ptr = t;
+        goto END_SKIP;
+        }
+      }
+    else scanning = FALSE;
+    }
+
+  /* At this point, ptr is at the start of a line. We need to find the length
+  of the subject string to pass to pcre2_match(). In multiline mode, it is the
+  length remainder of the data in the buffer. Otherwise, it is the length of
+  the next line, excluding the terminating newline. After matching, we always
+  advance by the length of the next line. In multiline mode the PCRE2_FIRSTLINE
+  option is used for compiling, so that any match is constrained to be in the
+  first line. */
+
+  t = end_of_line(t, endptr, &endlinelength);
+  linelength = t - ptr - endlinelength;
+  length = multiline? (PCRE2_SIZE)(endptr - ptr) : linelength;
 
   /* Check to see if the line we are looking at extends right to the very end
   of the buffer without a line terminator. This means the line is too long to
   handle at the current buffer size. Until the buffer reaches its maximum size,
   try doubling it and reading more data. */
 
-  if (endlinelength == 0 && t == main_buffer + bufsize)
+  if (endlinelength == 0 && t == bufend)
     {
     if (bufthird < max_bufthird)
       {
@@ -2584,7 +3836,10 @@ while (ptr < endptr)
       ptr = new_buffer + (ptr - main_buffer);
       lastmatchrestart = new_buffer + (lastmatchrestart - main_buffer);
       free(main_buffer);
-      main_buffer = new_buffer;
+      main_buffer = buffer = new_buffer;
+      bufend = main_buffer + bufsize;
+      scanptr = NULL;
+      scan_checked = NULL;
 
       /* Read more data into the buffer and then try to find the line ending
       again. */
@@ -2700,7 +3955,7 @@ while (ptr < endptr)
 
     else if (binary)
       {
-      fprintf(stdout, "Binary file %s matches" STDOUT_NL, filename);
+      fprintf(outfile, "Binary file %s matches" STDOUT_NL, filename);
       return 0;
       }
 
@@ -2709,7 +3964,7 @@ while (ptr < endptr)
 
     else if (filenames == FN_MATCH_ONLY)
       {
-      fprintf(stdout, "%s" STDOUT_NL, printname);
+      fprintf(outfile, "%s" STDOUT_NL, printname);
       return 0;
       }
 
@@ -2728,19 +3983,19 @@ while (ptr < endptr)
         {
         PCRE2_SIZE oldstartoffset;
 
-        if (printname != NULL) fprintf(stdout, "%s:", printname);
-        if (number) fprintf(stdout, "%lu:", linenumber);
+        if (printname != NULL) fprintf(outfile, "%s:", printname);
+        if (number) fprintf(outfile, "%lu:", linenumber);
 
         /* Handle --line-offsets */
 
         if (line_offsets)
-          fprintf(stdout, "%d,%d" STDOUT_NL, (int)(ptr + offsets[0] - ptr),
+          fprintf(outfile, "%d,%d" STDOUT_NL, (int)(ptr + offsets[0] - ptr),
             (int)(offsets[1] - offsets[0]));
 
         /* Handle --file-offsets */
 
         else if (file_offsets)
-          fprintf(stdout, "%d,%d" STDOUT_NL,
+          fprintf(outfile, "%d,%d" STDOUT_NL,
             (int)(filepos + ptr + offsets[0] - ptr),
             (int)(offsets[1] - offsets[0]));
 
@@ -2751,7 +4006,7 @@ while (ptr < endptr)
           if (display_output_text((PCRE2_SPTR)output_text, FALSE,
               (PCRE2_SPTR)ptr, offsets, mrc) || printname != NULL ||
               number)
-            fprintf(stdout, STDOUT_NL);
+            fprintf(outfile, STDOUT_NL);
           }
 
         /* Handle --only-matching, which may occur many times */
@@ -2770,7 +4025,7 @@ while (ptr < endptr)
               if (plen > 0)
                 {
                 if (printed && om_separator != NULL)
-                  fprintf(stdout, "%s", om_separator);
+                  fprintf(outfile, "%s", om_separator);
                 print_match(ptr + offsets[n*2], plen);
                 printed = TRUE;
                 }
@@ -2778,13 +4033,16 @@ while (ptr < endptr)
             }
 
           if (printed || printname != NULL || number)
-            fprintf(stdout, STDOUT_NL);
+            fprintf(outfile, STDOUT_NL);
           }
 
         /* Prepare to repeat to find the next match in the line. */
 
         match = FALSE;
-        if (line_buffered) fflush(stdout);
+        if (line_buffered) fflush(outfile);
+#ifdef SUPPORT_PCRE2GREP_THREADS
+        if (output_job != NULL) check_job_output();
+#endif
         rc = 0;                      /* Had some success */
 
         /* If the pattern contained a lookbehind that included \K, it is
@@ -2827,6 +4085,9 @@ while (ptr < endptr)
     else
       {
       lines_printed = TRUE;
+#ifdef SUPPORT_PCRE2GREP_THREADS
+      lines_started = TRUE;
+#endif
 
       /* See if there is a requirement to print some "after" lines from a
       previous match. We never print any overlaps. */
@@ -2850,10 +4111,10 @@ while (ptr < endptr)
         while (lastmatchrestart < p)
           {
           char *pp = lastmatchrestart;
-          if (printname != NULL) fprintf(stdout, "%s-", printname);
-          if (number) fprintf(stdout, "%lu-", lastmatchnumber++);
+          if (printname != NULL) fprintf(outfile, "%s-", printname);
+          if (number) fprintf(outfile, "%lu-", lastmatchnumber++);
           pp = end_of_line(pp, endptr, &ellength);
-          FWRITE_IGNORE(lastmatchrestart, 1, pp - lastmatchrestart, stdout);
+          FWRITE_IGNORE(lastmatchrestart, 1, pp - lastmatchrestart, outfile);
           lastmatchrestart = pp;
           }
         if (lastmatchrestart != ptr) hyphenpending = TRUE;
@@ -2863,7 +4124,7 @@ while (ptr < endptr)
 
       if (hyphenpending)
         {
-        fprintf(stdout, "--" STDOUT_NL);
+        fprintf(outfile, "--" STDOUT_NL);
         hyphenpending = FALSE;
         hyphenprinted = TRUE;
         }
@@ -2876,25 +4137,25 @@ while (ptr < endptr)
         int linecount = 0;
         char *p = ptr;
 
-        while (p > main_buffer &&
+        while (p > buffer &&
                (lastmatchnumber == 0 || p > lastmatchrestart) &&
                linecount < before_context)
           {
           linecount++;
-          p = previous_line(p, main_buffer);
+          p = previous_line(p, buffer);
           }
 
         if (lastmatchnumber > 0 && p > lastmatchrestart && !hyphenprinted)
-          fprintf(stdout, "--" STDOUT_NL);
+          fprintf(outfile, "--" STDOUT_NL);
 
         while (p < ptr)
           {
           int ellength;
           char *pp = p;
-          if (printname != NULL) fprintf(stdout, "%s-", printname);
-          if (number) fprintf(stdout, "%lu-", linenumber - linecount--);
+          if (printname != NULL) fprintf(outfile, "%s-", printname);
+          if (number) fprintf(outfile, "%lu-", linenumber - linecount--);
           pp = end_of_line(pp, endptr, &ellength);
-          FWRITE_IGNORE(p, 1, pp - p, stdout);
+          FWRITE_IGNORE(p, 1, pp - p, outfile);
           p = pp;
           }
         }
@@ -2905,8 +4166,8 @@ while (ptr < endptr)
       if (after_context > 0 || before_context > 0)
         endhyphenpending = TRUE;
 
-      if (printname != NULL) fprintf(stdout, "%s:", printname);
-      if (number) fprintf(stdout, "%lu:", linenumber);
+      if (printname != NULL) fprintf(outfile, "%s:", printname);
+      if (number) fprintf(outfile, "%lu:", linenumber);
 
       /* This extra option, for Jeffrey Friedl's debugging requirements,
       replaces the matched string, or a specific captured string if it exists,
@@ -2917,9 +4178,9 @@ while (ptr < endptr)
         {
         int first = S_arg * 2;
         int last  = first + 1;
-        FWRITE_IGNORE(ptr, 1, offsets[first], stdout);
-        fprintf(stdout, "X");
-        FWRITE_IGNORE(ptr + offsets[last], 1, linelength - offsets[last], stdout);
+        FWRITE_IGNORE(ptr, 1, offsets[first], outfile);
+        fprintf(outfile, "X");
+        FWRITE_IGNORE(ptr + offsets[last], 1, linelength - offsets[last], outfile);
         }
       else
 #endif
@@ -2945,7 +4206,7 @@ while (ptr < endptr)
           offsets[1] = temp;
           }
 
-        FWRITE_IGNORE(ptr, 1, offsets[0], stdout);
+        FWRITE_IGNORE(ptr, 1, offsets[0], outfile);
         print_match(ptr + offsets[0], offsets[1] - offsets[0]);
 
         for (;;)
@@ -3005,7 +4266,7 @@ while (ptr < endptr)
             offsets[1] = temp;
             }
 
-          FWRITE_IGNORE(ptr + endprevious, 1, offsets[0] - endprevious, stdout);
+          FWRITE_IGNORE(ptr + endprevious, 1, offsets[0] - endprevious, outfile);
           print_match(ptr + offsets[0], offsets[1] - offsets[0]);
           }
 
@@ -3014,18 +4275,22 @@ while (ptr < endptr)
         may be no more to print. */
 
         plength = (int)((linelength + endlinelength) - endprevious);
-        if (plength > 0) FWRITE_IGNORE(ptr + endprevious, 1, plength, stdout);
+        if (plength > 0) FWRITE_IGNORE(ptr + endprevious, 1, plength, outfile);
         }
 
       /* Not colouring or multiline; no need to search for further matches. */
 
-      else FWRITE_IGNORE(ptr, 1, linelength + endlinelength, stdout);
+      else FWRITE_IGNORE(ptr, 1, linelength + endlinelength, outfile);
       }
 
     /* End of doing what has to be done for a match. If --line-buffered was
-    given, flush the output. */
+    given, flush the output. A worker that is holding the output of a file
+    in memory checks whether it can now be written. */
 
-    if (line_buffered) fflush(stdout);
+    if (line_buffered) fflush(outfile);
+#ifdef SUPPORT_PCRE2GREP_THREADS
+    if (output_job != NULL) check_job_output();
+#endif
     rc = 0;    /* Had some success */
 
     /* Remember where the last match happened for after_context. We remember
@@ -3052,95 +4317,719 @@ while (ptr < endptr)
     t = ptr;
     while (t < endmatch)
       {
-      t = end_of_line(t, endptr, &ellength);
-      if (t <= endmatch) linenumber++; else break;
+      t = end_of_line(t, endptr, &ellength);
+      if (t <= endmatch) linenumber++; else break;
+      }
+    endmatch = end_of_line(endmatch, endptr, &ellength);
+    linelength = endmatch - ptr - ellength;
+    }
+
+  /* Advance to after the newline and increment the line number. The file
+  offset to the current line is maintained in filepos. */
+
+  END_ONE_MATCH:
+  ptr += linelength + endlinelength;
+  filepos += (int)(linelength + endlinelength);
+  linenumber++;
+
+  /* After lines are skipped by scanning, the buffer may need refilling. */
+
+  END_SKIP:
+
+  /* If input is line buffered, and the buffer is not yet full, read another
+  line and add it into the buffer. */
+
+  if (input_line_buffered && bufflength < (PCRE2_SIZE)bufsize)
+    {
+    int add = read_one_line(ptr, bufsize - (int)(ptr - main_buffer), in);
+    bufflength += add;
+    endptr += add;
+    }
+
+  /* If we haven't yet reached the end of the file (the buffer is full), and
+  the current point is in the top 1/3 of the buffer, slide the buffer down by
+  1/3 and refill it. Before we do this, if some unprinted "after" lines are
+  about to be lost, print them. A mapped file is never shifted. */
+
+  if (frtype != FR_MMAP && bufflength >= (PCRE2_SIZE)bufsize &&
+      ptr > main_buffer + 2*bufthird)
+    {
+    if (after_context > 0 &&
+        lastmatchnumber > 0 &&
+        lastmatchrestart < main_buffer + bufthird)
+      {
+      do_after_lines(lastmatchnumber, lastmatchrestart, endptr, bufend,
+        printname);
+      lastmatchnumber = 0;  /* Indicates no after lines pending */
+      }
+
+    /* Now do the shuffle */
+
+    (void)memmove(main_buffer, main_buffer + bufthird, 2*bufthird);
+    ptr -= bufthird;
+
+    bufflength = 2*bufthird + fill_buffer(handle, frtype,
+      main_buffer + 2*bufthird, bufthird, input_line_buffered);
+    endptr = main_buffer + bufflength;
+
+    /* Adjust any last match point */
+
+    if (lastmatchnumber > 0) lastmatchrestart -= bufthird;
+    scanptr = NULL;
+    scan_checked = NULL;
+    }
+  }     /* Loop through the whole file */
+
+/* End of file; print final "after" lines if wanted; do_after_lines sets
+hyphenpending if it prints something. */
+
+if (only_matching_count == 0 && !(count_only|show_total_count))
+  {
+  do_after_lines(lastmatchnumber, lastmatchrestart, endptr, bufend, printname);
+  hyphenpending |= endhyphenpending;
+  }
+
+/* Print the file name if we are looking for those without matches and there
+were none. If we found a match, we won't have got this far. */
+
+if (filenames == FN_NOMATCH_ONLY)
+  {
+  fprintf(outfile, "%s" STDOUT_NL, printname);
+  return 0;
+  }
+
+/* Print the match count if wanted */
+
+if (count_only && !quiet)
+  {
+  if (count > 0 || !omit_zero_count)
+    {
+    if (printname != NULL && filenames != FN_NONE)
+      fprintf(outfile, "%s:", printname);
+    fprintf(outfile, "%lu" STDOUT_NL, count);
+    counts_printed++;
+    }
+  }
+
+total_count += count;   /* Can be set without count_only */
+return rc;
+}
+
+
+
+/*************************************************
+*           Open and grep a single file          *
+*************************************************/
+
+/* This is called by grep_or_recurse() when a path has been accepted for
+searching, or by a worker thread when files are searched in parallel. The way
+in which the file is opened depends on its name.
+
+Arguments:
+  pathname          the path of the file
+  only_one_at_top   TRUE if the path is the only one at toplevel
+
+Returns:   0 if there was at least one match
+           1 if there were no matches
+           2 there was some kind of error
+
+However, file opening failures are suppressed if "silent" is set.
+*/
+
+static int
+grep_file(char *pathname, BOOL only_one_at_top)
+{
+int rc;
+int frtype;
+void *handle;
+FILE *in = NULL;           /* Ensure initialized */
+
+#ifdef USE_MMAP
+mapped_file mf;
+#endif
+
+#ifdef USE_READAHEAD
+readahead ra;
+#endif
+
+#ifdef SUPPORT_LIBZ
+gzFile ingz = NULL;
+#endif
+
+#ifdef SUPPORT_LIBBZ2
+BZFILE *inbz2 = NULL;
+#endif
+
+#if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
+int pathlen;
+#endif
+
+#if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
+pathlen = (int)(strlen(pathname));
+#endif
+
+/* Open using zlib if it is supported and the file name ends with .gz. */
+
+#ifdef SUPPORT_LIBZ
+if (pathlen > 3 && strcmp(pathname + pathlen - 3, ".gz") == 0)
+  {
+  ingz = gzopen(pathname, "rb");
+  if (ingz == NULL)
+    {
+    if (!silent)
+      fprintf(stderr, "pcre2grep: Failed to open %s: %s\n", pathname,
+        strerror(errno));
+    return 2;
+    }
+  handle = (void *)ingz;
+  frtype = FR_LIBZ;
+  }
+else
+#endif
+
+/* Otherwise open with bz2lib if it is supported and the name ends with .bz2. */
+
+#ifdef SUPPORT_LIBBZ2
+if (pathlen > 4 && strcmp(pathname + pathlen - 4, ".bz2") == 0)
+  {
+  inbz2 = BZ2_bzopen(pathname, "rb");
+  handle = (void *)inbz2;
+  frtype = FR_LIBBZ2;
+  }
+else
+#endif
+
+/* Otherwise use plain fopen(). The label is so that we can come back here if
+an attempt to read a .bz2 file indicates that it really is a plain file. */
+
+#ifdef SUPPORT_LIBBZ2
+PLAIN_FILE:
+#endif
+  {
+  in = fopen(pathname, "rb");
+  handle = (void *)in;
+  frtype = FR_PLAIN;
+  }
+
+/* All the opening methods return errno when they fail. */
+
+if (handle == NULL)
+  {
+  if (!silent)
+    fprintf(stderr, "pcre2grep: Failed to open %s: %s\n", pathname,
+      strerror(errno));
+  return 2;
+  }
+
+/* With --mmap or --index, a non-empty regular file is mapped into memory if
+possible, unless the input is to be line buffered, or multiline matching is in
+use (where a match may not run further than the buffer). If the file cannot be
+mapped, it is read as usual. Mapping is not the default because a file that is
+truncated while it is being searched would raise SIGBUS. */
+
+#ifdef USE_MMAP
+if (frtype == FR_PLAIN && use_mmap && !line_buffered && !multiline)
+  {
+  struct stat statbuf;
+  if (fstat(fileno(in), &statbuf) == 0 && S_ISREG(statbuf.st_mode) &&
+      statbuf.st_size > 0 &&
+      (off_t)(PCRE2_SIZE)statbuf.st_size == statbuf.st_size)
+    {
+    mf.length = (PCRE2_SIZE)statbuf.st_size;
+    mf.data = (char *)mmap(NULL, mf.length, PROT_READ, MAP_PRIVATE,
+      fileno(in), 0);
+    if (mf.data != (char *)MAP_FAILED)
+      {
+      mf.index = NULL;
+      if (use_index) index_open(pathname, &statbuf, &mf);
+#ifdef MADV_SEQUENTIAL
+      (void)madvise(mf.data, mf.length, MADV_SEQUENTIAL);
+#endif
+      handle = (void *)&mf;
+      frtype = FR_MMAP;
+      }
+    }
+  }
+#endif
+
+/* Now grep the file. A compressed file is decompressed by another thread if
+possible, which must be stopped before the file is closed. */
+
+#ifdef USE_READAHEAD
+if ((frtype == FR_LIBZ || frtype == FR_LIBBZ2) &&
+    readahead_start(&ra, handle, frtype))
+  {
+  rc = pcre2grep(&ra, FR_READAHEAD, pathname, (filenames > FN_DEFAULT ||
+    (filenames == FN_DEFAULT && !only_one_at_top))? pathname : NULL);
+  readahead_end(&ra);
+  }
+else
+#endif
+
+rc = pcre2grep(handle, frtype, pathname, (filenames > FN_DEFAULT ||
+  (filenames == FN_DEFAULT && !only_one_at_top))? pathname : NULL);
+
+/* Close in an appropriate manner. */
+
+#ifdef USE_MMAP
+if (frtype == FR_MMAP)
+  {
+  (void)munmap(mf.data, mf.length);
+  free(mf.index);
+  fclose(in);
+  }
+else
+#endif
+
+#ifdef SUPPORT_LIBZ
+if (frtype == FR_LIBZ)
+  gzclose(ingz);
+else
+#endif
+
+/* If it is a .bz2 file and the result is 3, it means that the first attempt to
+read failed. If the error indicates that the file isn't in fact bzipped, try
+again as a normal file. */
+
+#ifdef SUPPORT_LIBBZ2
+if (frtype == FR_LIBBZ2)
+  {
+  if (rc == 3)
+    {
+    int errnum;
+    const char *err = BZ2_bzerror(inbz2, &errnum);
+    if (errnum == BZ_DATA_ERROR_MAGIC)
+      {
+      BZ2_bzclose(inbz2);
+      goto PLAIN_FILE;
+      }
+    else if (!silent)
+      fprintf(stderr, "pcre2grep: Failed to read %s using bzlib: %s\n",
+        pathname, err);
+    rc = 2;    /* The normal "something went wrong" code */
+    }
+  BZ2_bzclose(inbz2);
+  }
+else
+#endif
+
+/* Normal file close */
+
+fclose(in);
+
+/* Pass back the yield from pcre2grep(). */
+
+return rc;
+}
+
+
+
+#ifdef SUPPORT_PCRE2GREP_THREADS
+
+/*************************************************
+*        Searching files in parallel             *
+*************************************************/
+
+/* When --threads is greater than one, the main thread still walks the
+directories and applies the inclusion and exclusion tests, but instead of
+searching each file it appends the file to a queue. A number of worker threads
+take files from the queue in order and search them, each using its own buffer
+and match data (the per-thread variables above). The output must appear in
+the order in which the files were queued, so that it is the same as for a
+serial search. The file at the head of the queue, all of whose predecessors
+have been written, writes its output straight to stdout. The output of a later
+file is held in a memory stream, which the main thread copies to stdout when
+the file reaches the head. If the stream grows larger than the worker's
+buffer, the worker waits until its file reaches the head, writes what it has
+held, and continues to stdout. The number of files that can be queued but not
+yet written is also limited, so the amount of memory that is used is bounded.
+*/
+
+typedef struct filejob {
+  struct filejob *next;
+  char *output;                 /* Output held for this file */
+  size_t output_length;
+  int rc;                       /* Yield from grep_file() */
+  BOOL done;                    /* The search is complete */
+  BOOL at_head;                 /* All earlier output has been written */
+  BOOL streamed;                /* The output is going straight to stdout */
+  BOOL hyphen_before;           /* Main thread's hyphenpending at the head */
+  BOOL lines_started;           /* The first matching line was printed */
+  BOOL hyphenpending;           /* Value of hyphenpending at the end */
+  BOOL only_one_at_top;
+  char pathname[1];             /* Actually as long as needed */
+} filejob;
+
+/* Each worker passes its counts back through its block when it finishes. */
+
+typedef struct worker {
+  pthread_t thread;
+  unsigned long int total_count;
+  unsigned long int counts_printed;
+  int error_count;
+  BOOL resource_error;
+} worker;
+
+static worker *workers = NULL;
+static int workers_started = 0;
+static int jobs_rc = 1;
+
+/* The queue is a chain from the oldest file whose output has not yet been
+written. The workers claim files from job_next, which is NULL when every file
+in the chain has been claimed. These variables, and the at_head, streamed, and
+hyphen_before fields of the jobs, are protected by job_mutex. */
+
+static filejob *job_first = NULL;
+static filejob *job_last = NULL;
+static filejob *job_next = NULL;
+static int jobs_queued = 0;
+static BOOL jobs_ended = FALSE;
+
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_head = PTHREAD_COND_INITIALIZER;
+
+
+
+/*************************************************
+*            Worker thread function              *
+*************************************************/
+
+/* Each worker sets up its own copies of the buffer and match data, and then
+searches files from the queue until the main thread ends the queue. A file
+that is at the head of the queue when it is claimed is written to stdout,
+starting with the main thread's pending "--" separator. Otherwise the worker
+does not know whether the previous file will leave a separator pending, so it
+starts the file without one, and records whether the file printed a matching
+line, before which any pending separator would have appeared.
+
+Argument:   the worker's block
+Returns:    NULL
+*/
+
+static void *
+worker_thread(void *arg)
+{
+worker *w = (worker *)arg;
+
+bufthird = start_bufthird;
+bufsize = 3*bufthird;
+main_buffer = (char *)malloc(bufsize);
+match_data = pcre2_match_data_create(offset_size, NULL);
+
+if (main_buffer == NULL || match_data == NULL)
+  {
+  fprintf(stderr, "pcre2grep: malloc failed\n");
+  pcre2grep_exit(2);
+  }
+
+offsets = pcre2_get_ovector_pointer(match_data);
+
+(void)pthread_mutex_lock(&job_mutex);
+
+for (;;)
+  {
+  filejob *job;
+
+  while (job_next == NULL && !jobs_ended)
+    (void)pthread_cond_wait(&job_ready, &job_mutex);
+  if ((job = job_next) == NULL) break;
+  job_next = job->next;
+  job->streamed = job->at_head;
+  hyphenpending = job->streamed && job->hyphen_before;
+  (void)pthread_mutex_unlock(&job_mutex);
+
+  lines_started = FALSE;
+  if (job->streamed) outfile = stdout; else
+    {
+    outfile = open_memstream(&job->output, &job->output_length);
+    output_job = job;
+    output_check = bufthird;
+    }
+
+  if (outfile == NULL)
+    {
+    fprintf(stderr, "pcre2grep: Failed to create output stream for %s: %s\n",
+      job->pathname, strerror(errno));
+    job->rc = 2;
+    }
+  else
+    {
+    job->rc = grep_file(job->pathname, job->only_one_at_top);
+    job->lines_started = lines_started;
+    job->hyphenpending = hyphenpending;
+    if (outfile != stdout) (void)fclose(outfile);
+    }
+
+  output_job = NULL;
+  (void)pthread_mutex_lock(&job_mutex);
+  job->done = TRUE;
+  (void)pthread_cond_signal(&job_done);
+  }
+
+(void)pthread_mutex_unlock(&job_mutex);
+
+w->total_count = total_count;
+w->counts_printed = counts_printed;
+w->error_count = error_count;
+w->resource_error = resource_error;
+
+free(main_buffer);
+pcre2_match_data_free(match_data);
+return NULL;
+}
+
+
+
+/*************************************************
+*     Check the output held for a later file     *
+*************************************************/
+
+/* This is called in a worker after it prints a match, while the output for
+its file is being held in a memory stream. Every time the stream has grown by
+another third of the buffer size, the worker checks whether its file has
+reached the head of the queue. If the stream is larger than the buffer, the
+worker waits until it has. When the file is at the head, the held output is
+written, preceded by any separator that the main thread has pending, and the
+rest of the file's output goes straight to stdout.
+
+Arguments:  none
+Returns:    nothing
+*/
+
+static void
+check_job_output(void)
+{
+filejob *job = output_job;
+long int length = ftell(outfile);
+
+if (length < output_check) return;
+
+(void)pthread_mutex_lock(&job_mutex);
+if (!job->at_head && length < bufsize)
+  {
+  (void)pthread_mutex_unlock(&job_mutex);
+  output_check = length + bufthird;
+  return;
+  }
+while (!job->at_head) (void)pthread_cond_wait(&job_head, &job_mutex);
+job->streamed = TRUE;
+if (!lines_started) hyphenpending = job->hyphen_before;
+  else if (job->hyphen_before) fprintf(stdout, "--" STDOUT_NL);
+(void)pthread_mutex_unlock(&job_mutex);
+
+(void)fclose(outfile);
+if (job->output_length > 0)
+  FWRITE_IGNORE(job->output, 1, job->output_length, stdout);
+free(job->output);
+job->output = NULL;
+job->output_length = 0;
+
+outfile = stdout;
+output_job = NULL;
+}
+
+
+
+/*************************************************
+*      Write the output of searched files        *
+*************************************************/
+
+/* This is called only from the main thread. It copies the output of files at
+the head of the queue whose searches are complete to stdout, and waits for
+searches to complete until no more than a given number of files remain. When
+a file whose search is not complete reaches the head, it is told so, along
+with any pending separator, so that it can write to stdout itself. The main
+thread's hyphenpending carries any "--" separator from one file to the next,
+as in a serial search.
+
+Argument:   the number of files that may be left in the queue
+Returns:    nothing
+*/
+
+static void
+write_jobs(int keep)
+{
+(void)pthread_mutex_lock(&job_mutex);
+
+for (;;)
+  {
+  filejob *job = job_first;
+
+  if (job == NULL) break;
+  if (!job->done)
+    {
+    if (!job->at_head)
+      {
+      job->at_head = TRUE;
+      job->hyphen_before = hyphenpending;
+      (void)pthread_cond_broadcast(&job_head);
       }
-    endmatch = end_of_line(endmatch, endptr, &ellength);
-    linelength = endmatch - ptr - ellength;
+    if (jobs_queued <= keep) break;
+    (void)pthread_cond_wait(&job_done, &job_mutex);
+    continue;
     }
 
-  /* Advance to after the newline and increment the line number. The file
-  offset to the current line is maintained in filepos. */
-
-  END_ONE_MATCH:
-  ptr += linelength + endlinelength;
-  filepos += (int)(linelength + endlinelength);
-  linenumber++;
-
-  /* If input is line buffered, and the buffer is not yet full, read another
-  line and add it into the buffer. */
+  job_first = job->next;
+  if (job_first == NULL) job_last = NULL;
+  jobs_queued--;
+  (void)pthread_mutex_unlock(&job_mutex);
 
-  if (input_line_buffered && bufflength < (PCRE2_SIZE)bufsize)
+  if (job->streamed) hyphenpending = job->hyphenpending;
+  else if (job->lines_started)
     {
-    int add = read_one_line(ptr, bufsize - (int)(ptr - main_buffer), in);
-    bufflength += add;
-    endptr += add;
+    if (hyphenpending) fprintf(stdout, "--" STDOUT_NL);
+    hyphenpending = job->hyphenpending;
     }
+  if (job->output_length > 0)
+    FWRITE_IGNORE(job->output, 1, job->output_length, stdout);
+  if (line_buffered) fflush(stdout);
 
-  /* If we haven't yet reached the end of the file (the buffer is full), and
-  the current point is in the top 1/3 of the buffer, slide the buffer down by
-  1/3 and refill it. Before we do this, if some unprinted "after" lines are
-  about to be lost, print them. */
+  if (job->rc > 1) jobs_rc = job->rc;
+    else if (job->rc == 0 && jobs_rc == 1) jobs_rc = 0;
 
-  if (bufflength >= (PCRE2_SIZE)bufsize && ptr > main_buffer + 2*bufthird)
-    {
-    if (after_context > 0 &&
-        lastmatchnumber > 0 &&
-        lastmatchrestart < main_buffer + bufthird)
-      {
-      do_after_lines(lastmatchnumber, lastmatchrestart, endptr, printname);
-      lastmatchnumber = 0;  /* Indicates no after lines pending */
-      }
+  free(job->output);
+  free(job);
+  (void)pthread_mutex_lock(&job_mutex);
+  }
 
-    /* Now do the shuffle */
+(void)pthread_mutex_unlock(&job_mutex);
+}
 
-    (void)memmove(main_buffer, main_buffer + bufthird, 2*bufthird);
-    ptr -= bufthird;
 
-    bufflength = 2*bufthird + fill_buffer(handle, frtype,
-      main_buffer + 2*bufthird, bufthird, input_line_buffered);
-    endptr = main_buffer + bufflength;
 
-    /* Adjust any last match point */
+/*************************************************
+*        Queue a file for a worker thread        *
+*************************************************/
 
-    if (lastmatchnumber > 0) lastmatchrestart -= bufthird;
-    }
-  }     /* Loop through the whole file */
+/* Any output that is ready is written first, and if the queue is full, this
+waits for some files to be finished.
 
-/* End of file; print final "after" lines if wanted; do_after_lines sets
-hyphenpending if it prints something. */
+Arguments:
+  pathname          the path of the file
+  only_one_at_top   TRUE if the path is the only one at toplevel
 
-if (only_matching_count == 0 && !(count_only|show_total_count))
+Returns:  -1 the file was queued (its result is merged by end_threads())
+           2 there was an error
+*/
+
+static int
+queue_file(char *pathname, BOOL only_one_at_top)
+{
+size_t length = strlen(pathname);
+filejob *job = (filejob *)malloc(sizeof(filejob) + length);
+
+if (job == NULL)
   {
-  do_after_lines(lastmatchnumber, lastmatchrestart, endptr, printname);
-  hyphenpending |= endhyphenpending;
+  fprintf(stderr, "pcre2grep: malloc failed\n");
+  return 2;
   }
 
-/* Print the file name if we are looking for those without matches and there
-were none. If we found a match, we won't have got this far. */
+memcpy(job->pathname, pathname, length + 1);
+job->next = NULL;
+job->output = NULL;
+job->output_length = 0;
+job->rc = 1;
+job->done = job->at_head = job->streamed = job->hyphen_before = FALSE;
+job->lines_started = job->hyphenpending = FALSE;
+job->only_one_at_top = only_one_at_top;
 
-if (filenames == FN_NOMATCH_ONLY)
+write_jobs(4*workers_started - 1);
+
+/* A file that is queued when the queue is empty is at its head at once. */
+
+(void)pthread_mutex_lock(&job_mutex);
+if (job_last == NULL)
   {
-  fprintf(stdout, "%s" STDOUT_NL, printname);
-  return 0;
+  job_first = job;
+  job->at_head = TRUE;
+  job->hyphen_before = hyphenpending;
   }
+else job_last->next = job;
+job_last = job;
+if (job_next == NULL) job_next = job;
+jobs_queued++;
+(void)pthread_cond_signal(&job_ready);
+(void)pthread_mutex_unlock(&job_mutex);
+
+return -1;
+}
 
-/* Print the match count if wanted */
 
-if (count_only && !quiet)
+
+/*************************************************
+*        Start and stop the worker threads       *
+*************************************************/
+
+/* If no thread can be created, files are searched serially.
+
+Arguments:  none
+Returns:    nothing
+*/
+
+static void
+start_threads(void)
+{
+workers = (worker *)malloc(thread_count * sizeof(worker));
+if (workers == NULL) return;
+
+for (workers_started = 0; workers_started < thread_count; workers_started++)
   {
-  if (count > 0 || !omit_zero_count)
+  int err = pthread_create(&workers[workers_started].thread, NULL,
+    worker_thread, workers + workers_started);
+  if (err != 0)
     {
-    if (printname != NULL && filenames != FN_NONE)
-      fprintf(stdout, "%s:", printname);
-    fprintf(stdout, "%lu" STDOUT_NL, count);
-    counts_printed++;
+    fprintf(stderr, "pcre2grep: Failed to create thread: %s\n", strerror(err));
+    break;
     }
   }
 
-total_count += count;   /* Can be set without count_only */
+if (workers_started == 0)
+  {
+  free(workers);
+  workers = NULL;
+  }
+}
+
+
+/* Wait for all the queued files to be searched and written, then stop the
+workers and add their counts to those of the main thread.
+
+Argument:   the return code so far
+Returns:    the return code, updated with the results of the queued files
+*/
+
+static int
+end_threads(int rc)
+{
+int i;
+
+write_jobs(0);
+
+(void)pthread_mutex_lock(&job_mutex);
+jobs_ended = TRUE;
+(void)pthread_cond_broadcast(&job_ready);
+(void)pthread_mutex_unlock(&job_mutex);
+
+for (i = 0; i < workers_started; i++)
+  {
+  worker *w = workers + i;
+  (void)pthread_join(w->thread, NULL);
+  total_count += w->total_count;
+  counts_printed += w->counts_printed;
+  error_count += w->error_count;
+  resource_error |= w->resource_error;
+  }
+
+free(workers);
+workers = NULL;
+
+if (jobs_rc > 1) rc = jobs_rc;
+  else if (jobs_rc == 0 && rc == 1) rc = 0;
 return rc;
 }
+#endif  /* SUPPORT_PCRE2GREP_THREADS */
 
 
 
@@ -3156,7 +5045,8 @@ Arguments:
   dir_recurse       TRUE if recursing is wanted (-r or -drecurse)
   only_one_at_top   TRUE if the path is the only one at toplevel
 
-Returns:  -1 the file/directory was skipped
+Returns:  -1 the file/directory was skipped, or the file was queued for
+             searching by a worker thread
            0 if there was at least one match
            1 if there were no matches
            2 there was some kind of error
@@ -3168,22 +5058,7 @@ static int
 grep_or_recurse(char *pathname, BOOL dir_recurse, BOOL only_one_at_top)
 {
 int rc = 1;
-int frtype;
-void *handle;
 char *lastcomp;
-FILE *in = NULL;           /* Ensure initialized */
-
-#ifdef SUPPORT_LIBZ
-gzFile ingz = NULL;
-#endif
-
-#ifdef SUPPORT_LIBBZ2
-BZFILE *inbz2 = NULL;
-#endif
-
-#if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
-int pathlen;
-#endif
 
 #if defined NATIVE_ZOS
 int zos_type;
@@ -3194,6 +5069,9 @@ FILE *zos_test_file;
 
 if (strcmp(pathname, "-") == 0)
   {
+#ifdef SUPPORT_PCRE2GREP_THREADS
+  if (workers != NULL) write_jobs(0);   /* Keep the output in order */
+#endif
   return pcre2grep(stdin, FR_PLAIN, stdin_name,
     (filenames > FN_DEFAULT || (filenames == FN_DEFAULT && !only_one_at_top))?
       stdin_name : NULL);
@@ -3337,115 +5215,26 @@ else if (
         !test_incexc(lastcomp, include_patterns, exclude_patterns))
   return -1;  /* File skipped */
 
+/* With --index, index files are not searched. */
+
+#ifdef USE_MMAP
+if (use_index && strlen(lastcomp) >= sizeof(INDEX_SUFFIX) &&
+    strcmp(lastcomp + strlen(lastcomp) - (sizeof(INDEX_SUFFIX) - 1),
+      INDEX_SUFFIX) == 0)
+  return -1;
+#endif
+
 /* Control reaches here if we have a regular file, or if we have a directory
 and recursion or skipping was not requested, or if we have anything else and
 skipping was not requested. The scan proceeds. If this is the first and only
 argument at top level, we don't show the file name, unless we are only showing
 the file name, or the filename was forced (-H). */
 
-#if defined SUPPORT_LIBZ || defined SUPPORT_LIBBZ2
-pathlen = (int)(strlen(pathname));
-#endif
-
-/* Open using zlib if it is supported and the file name ends with .gz. */
-
-#ifdef SUPPORT_LIBZ
-if (pathlen > 3 && strcmp(pathname + pathlen - 3, ".gz") == 0)
-  {
-  ingz = gzopen(pathname, "rb");
-  if (ingz == NULL)
-    {
-    if (!silent)
-      fprintf(stderr, "pcre2grep: Failed to open %s: %s\n", pathname,
-        strerror(errno));
-    return 2;
-    }
-  handle = (void *)ingz;
-  frtype = FR_LIBZ;
-  }
-else
-#endif
-
-/* Otherwise open with bz2lib if it is supported and the name ends with .bz2. */
-
-#ifdef SUPPORT_LIBBZ2
-if (pathlen > 4 && strcmp(pathname + pathlen - 4, ".bz2") == 0)
-  {
-  inbz2 = BZ2_bzopen(pathname, "rb");
-  handle = (void *)inbz2;
-  frtype = FR_LIBBZ2;
-  }
-else
-#endif
-
-/* Otherwise use plain fopen(). The label is so that we can come back here if
-an attempt to read a .bz2 file indicates that it really is a plain file. */
-
-#ifdef SUPPORT_LIBBZ2
-PLAIN_FILE:
-#endif
-  {
-  in = fopen(pathname, "rb");
-  handle = (void *)in;
-  frtype = FR_PLAIN;
-  }
-
-/* All the opening methods return errno when they fail. */
-
-if (handle == NULL)
-  {
-  if (!silent)
-    fprintf(stderr, "pcre2grep: Failed to open %s: %s\n", pathname,
-      strerror(errno));
-  return 2;
-  }
-
-/* Now grep the file */
-
-rc = pcre2grep(handle, frtype, pathname, (filenames > FN_DEFAULT ||
-  (filenames == FN_DEFAULT && !only_one_at_top))? pathname : NULL);
-
-/* Close in an appropriate manner. */
-
-#ifdef SUPPORT_LIBZ
-if (frtype == FR_LIBZ)
-  gzclose(ingz);
-else
-#endif
-
-/* If it is a .bz2 file and the result is 3, it means that the first attempt to
-read failed. If the error indicates that the file isn't in fact bzipped, try
-again as a normal file. */
-
-#ifdef SUPPORT_LIBBZ2
-if (frtype == FR_LIBBZ2)
-  {
-  if (rc == 3)
-    {
-    int errnum;
-    const char *err = BZ2_bzerror(inbz2, &errnum);
-    if (errnum == BZ_DATA_ERROR_MAGIC)
-      {
-      BZ2_bzclose(inbz2);
-      goto PLAIN_FILE;
-      }
-    else if (!silent)
-      fprintf(stderr, "pcre2grep: Failed to read %s using bzlib: %s\n",
-        pathname, err);
-    rc = 2;    /* The normal "something went wrong" code */
-    }
-  BZ2_bzclose(inbz2);
-  }
-else
+#ifdef SUPPORT_PCRE2GREP_THREADS
+if (workers != NULL) return queue_file(pathname, only_one_at_top);
 #endif
 
-/* Normal file close */
-
-fclose(in);
-
-/* Pass back the yield from pcre2grep(). */
-
-return rc;
+return grep_file(pathname, only_one_at_top);
 }
 
 
@@ -3464,6 +5253,10 @@ switch(letter)
   case N_LBUFFER: line_buffered = TRUE; break;
   case N_LOFFSETS: line_offsets = number = TRUE; break;
   case N_NOJIT: use_jit = FALSE; break;
+  case N_MMAP: use_mmap = TRUE; break;
+  case N_NOMMAP: use_mmap = FALSE; break;
+  case N_NOSCAN: use_scan = FALSE; break;
+  case N_INDEX: use_index = use_mmap = TRUE; break;
   case 'a': binary_files = BIN_TEXT; break;
   case 'c': count_only = TRUE; break;
   case 'F': options |= PCRE2_LITERAL; break;
@@ -3730,6 +5523,9 @@ const char *locale_from = "--locale";
 
 #ifdef SUPPORT_PCRE2GREP_JIT
 pcre2_jit_stack *jit_stack = NULL;
+#ifdef SUPPORT_PCRE2GREP_THREADS
+pcre2_jit_stack_pool *jit_stack_pool = NULL;
+#endif
 #endif
 
 /* In Windows, stdout is set up as a text stream, which means that \n is
@@ -3742,6 +5538,8 @@ must use STDOUT_NL to terminate lines. */
 _setmode(_fileno(stdout), _O_BINARY);
 #endif
 
+outfile = stdout;
+
 /* Process the options */
 
 for (i = 1; i < argc; i++)
@@ -4088,11 +5886,17 @@ if (only_matching_count > 1)
   pcre2grep_exit(usage(2));
   }
 
-/* Check that there is a big enough ovector for all -o settings. */
+/* Check that there is a big enough ovector for all -o settings. Captured
+substrings are needed only for -o with a non-zero group or for --output; in
+other cases an ovector of one pair lets pcre2_match() leave the captures out of
+its backtracking frames. */
+
+offset_size = (output_text != NULL)? capture_max + 1 : 1;
 
 for (om = only_matching; om != NULL; om = om->next)
   {
   int n = om->groupnum;
+  if (n > 0) offset_size = capture_max + 1;
   if (n > (int)capture_max)
     {
     fprintf(stderr, "pcre2grep: Requested group %d cannot be captured.\n", n);
@@ -4109,7 +5913,6 @@ if (output_text != NULL &&
 
 /* Set up default compile and match contexts and a match data block. */
 
-offset_size = capture_max + 1;
 compile_context = pcre2_compile_context_create(NULL);
 match_context = pcre2_match_context_create(NULL);
 match_data = pcre2_match_data_create(offset_size, NULL);
@@ -4274,12 +6077,13 @@ if (use_jit)
 
 /* Get memory for the main buffer. */
 
-if (bufthird <= 0)
+if (start_bufthird <= 0)
   {
   fprintf(stderr, "pcre2grep: --buffer-size must be greater than zero\n");
   goto EXIT2;
   }
 
+bufthird = start_bufthird;
 bufsize = 3*bufthird;
 main_buffer = (char *)malloc(bufsize);
 
@@ -4289,6 +6093,12 @@ if (main_buffer == NULL)
   goto EXIT2;
   }
 
+if (thread_count <= 0)
+  {
+  fprintf(stderr, "pcre2grep: --threads must be greater than zero\n");
+  goto EXIT2;
+  }
+
 /* If no patterns were provided by -e, and there are no files provided by -f,
 the first argument is the one and only pattern, and it must exist. */
 
@@ -4321,15 +6131,75 @@ for (fn = pattern_files; fn != NULL; fn = fn->next)
   if (!read_pattern_file(fn->name, &patterns, &patterns_last)) goto EXIT2;
   }
 
-/* Unless JIT has been explicitly disabled, arrange a stack for it to use. */
+/* Unless JIT has been explicitly disabled, arrange a stack for it to use. When
+files are searched in parallel, a JIT stack cannot be shared, so a pool that
+provides a stack for each concurrent match is used instead. */
 
 #ifdef SUPPORT_PCRE2GREP_JIT
 if (use_jit)
   {
-  jit_stack = pcre2_jit_stack_create(32*1024, 1024*1024, NULL);
-  if (jit_stack != NULL                        )
-    pcre2_jit_stack_assign(match_context, NULL, jit_stack);
+#ifdef SUPPORT_PCRE2GREP_THREADS
+  if (thread_count > 1)
+    {
+    jit_stack_pool = pcre2_jit_stack_pool_create(32*1024, 1024*1024,
+      (uint32_t)thread_count, NULL);
+    if (jit_stack_pool != NULL)
+      pcre2_jit_stack_pool_assign(match_context, jit_stack_pool);
+    }
+  else
+#endif
+    {
+    jit_stack = pcre2_jit_stack_create(32*1024, 1024*1024, NULL);
+    if (jit_stack != NULL                        )
+      pcre2_jit_stack_assign(match_context, NULL, jit_stack);
+    }
+  }
+#endif
+
+/* If there is only one pattern, and lines are matched one at a time, see if
+the buffer can be scanned for matches (see pcre2grep()). A copy of the pattern
+is compiled in multiline mode, so that ^ and $ match at the start and end of
+each line. This is not permitted with PCRE2_LITERAL, which is fine except with
+-x. A pattern that can match an empty string would find a match in every line.
+Without JIT, invalid UTF support checks the whole subject for every match, so
+scanning is not used in that case. */
+
+if (use_scan && patterns != NULL && patterns->next == NULL && !invert &&
+    !multiline && !line_buffered &&
+    ((pcre2_options & PCRE2_LITERAL) != 0?
+      (extra_options & PCRE2_EXTRA_MATCH_LINE) == 0 :
+      pattern_can_scan(patterns)))
+  {
+  int errcode;
+  PCRE2_SIZE erroffset;
+  uint32_t matchempty = 1;
+  size_t jitsize = 0;
+
+  scan_code = pcre2_compile((PCRE2_SPTR)patterns->string, patterns->length,
+    pcre2_options | (((pcre2_options & PCRE2_LITERAL) != 0)? 0 :
+    PCRE2_MULTILINE), &errcode, &erroffset, compile_context);
+
+  if (scan_code != NULL)
+    {
+#ifdef SUPPORT_PCRE2GREP_JIT
+    if (use_jit) (void)pcre2_jit_compile(scan_code, PCRE2_JIT_COMPLETE);
+#endif
+    (void)pcre2_pattern_info(scan_code, PCRE2_INFO_MATCHEMPTY, &matchempty);
+    (void)pcre2_pattern_info(scan_code, PCRE2_INFO_JITSIZE, &jitsize);
+    if (matchempty != 0 ||
+        ((pcre2_options & PCRE2_MATCH_INVALID_UTF) != 0 && jitsize == 0))
+      {
+      pcre2_code_free(scan_code);
+      scan_code = NULL;
+      }
+    }
   }
+
+/* With --index, find the trigrams that any match of the scan pattern must
+contain. */
+
+#ifdef USE_MMAP
+if (use_index && scan_code != NULL) pattern_trigrams(patterns);
 #endif
 
 /* -F, -w, and -x do not apply to include or exclude patterns, so we must
@@ -4376,6 +6246,12 @@ if (file_lists == NULL && i >= argc)
   goto EXIT;
   }
 
+/* Start the worker threads if files are to be searched in parallel. */
+
+#ifdef SUPPORT_PCRE2GREP_THREADS
+if (thread_count > 1) start_threads();
+#endif
+
 /* If any files that contains a list of files to search have been specified,
 read them line by line and search the given files. */
 
@@ -4423,6 +6299,12 @@ for (; i < argc; i++)
     else if (frc == 0 && rc == 1) rc = 0;
   }
 
+/* Wait for any files that were queued for worker threads. */
+
+#ifdef SUPPORT_PCRE2GREP_THREADS
+if (workers != NULL) rc = end_threads(rc);
+#endif
+
 #ifdef SUPPORT_PCRE2GREP_CALLOUT
 /* If separating builtin echo callouts by implicit newline, add one more for
 the final item. */
@@ -4442,9 +6324,16 @@ if (show_total_count && counts_printed != 1 && filenames != FN_NOMATCH_ONLY)
   }
 
 EXIT:
+#ifdef SUPPORT_PCRE2GREP_THREADS
+if (workers != NULL) rc = end_threads(rc);
+#endif
+
 #ifdef SUPPORT_PCRE2GREP_JIT
 pcre2_jit_free_unused_memory(NULL);
 if (jit_stack != NULL) pcre2_jit_stack_free(jit_stack);
+#ifdef SUPPORT_PCRE2GREP_THREADS
+if (jit_stack_pool != NULL) pcre2_jit_stack_pool_free(jit_stack_pool);
+#endif
 #endif
 
 free(main_buffer);
@@ -4453,6 +6342,8 @@ if (character_tables != NULL) pcre2_maketables_free(NULL, character_tables);
 pcre2_compile_context_free(compile_context);
 pcre2_match_context_free(match_context);
 pcre2_match_data_free(match_data);
+pcre2_code_free(scan_code);
+free(index_hashes);
 
 free_pattern_chain(patterns);
 free_pattern_chain(include_patterns);
@@ -322,7 +322,13 @@ if (preg->re_pcre2_code == NULL)
 (void)pcre2_pattern_info((const pcre2_code *)preg->re_pcre2_code,
   PCRE2_INFO_CAPTURECOUNT, &re_nsub);
 preg->re_nsub = (size_t)re_nsub;
-preg->re_match_data = pcre2_match_data_create(re_nsub + 1, NULL);
+
+/* With REG_NOSUB, regexec() never returns any captured substrings, so a match
+data block that holds just the overall match allows pcre2_match() to leave them
+out of its backtracking frames. */
+
+preg->re_match_data = pcre2_match_data_create(
+  ((cflags & REG_NOSUB) != 0)? 1 : re_nsub + 1, NULL);
 preg->re_erroffset = (size_t)(-1);  /* No meaning after successful compile */
 
 if (preg->re_match_data == NULL)
@@ -340,10 +346,11 @@ return 0;
 *              Match a regular expression        *
 *************************************************/
 
-/* A suitable match_data block, large enough to hold all possible captures, was
-obtained when the pattern was compiled, to save having to allocate and free it
-for each match. If REG_NOSUB was specified at compile time, the nmatch and
-pmatch arguments are ignored, and the only result is yes/no/error. */
+/* A suitable match_data block, large enough to hold all possible captures
+(only the overall match for REG_NOSUB), was obtained when the pattern was
+compiled, to save having to allocate and free it for each match. If REG_NOSUB
+was specified at compile time, the nmatch and pmatch arguments are ignored, and
+the only result is yes/no/error. */
 
 PCRE2POSIX_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_regexec(const regex_t *preg, const char *string, size_t nmatch,
@@ -514,6 +514,8 @@ so many of them that they are split into two fields. */
 #define CTL2_CALLOUT_NO_WHERE            0x00000200u
 #define CTL2_CALLOUT_EXTRA               0x00000400u
 #define CTL2_ALLVECTOR                   0x00000800u
+#define CTL2_STATS                       0x00001000u
+#define CTL2_DFA_WORKSPACE               0x00002000u
 
 #define CTL2_NL_SET                      0x40000000u  /* Informational */
 #define CTL2_BSR_SET                     0x80000000u  /* Informational */
@@ -541,7 +543,8 @@ different things in the two cases. */
                     CTL2_SUBSTITUTE_REPLACEMENT_ONLY|\
                     CTL2_SUBSTITUTE_UNKNOWN_UNSET|\
                     CTL2_SUBSTITUTE_UNSET_EMPTY|\
-                    CTL2_ALLVECTOR)
+                    CTL2_ALLVECTOR|\
+                    CTL2_STATS)
 
 /* Structures for holding modifier information for patterns and subject strings
 (data). Fields containing modifiers that can be set either for a pattern or a
@@ -584,6 +587,7 @@ typedef struct datctl {       /* Structure for data line modifiers. */
    int32_t  callout_data;
    int32_t  copy_numbers[MAXCPYGET];
    int32_t  get_numbers[MAXCPYGET];
+  uint32_t  match_buffer;
   uint32_t  oveccount;
   uint32_t  offset;
   uint8_t   copy_names[LENCPYGET];
@@ -654,6 +658,7 @@ static modstruct modlist[] = {
   { "dfa",                         MOD_DAT,  MOD_CTL, CTL_DFA,                    DO(control) },
   { "dfa_restart",                 MOD_DAT,  MOD_OPT, PCRE2_DFA_RESTART,          DO(options) },
   { "dfa_shortest",                MOD_DAT,  MOD_OPT, PCRE2_DFA_SHORTEST,         DO(options) },
+  { "dfa_workspace",               MOD_DAT,  MOD_CTL, CTL2_DFA_WORKSPACE,         DO(control2) },
   { "dollar_endonly",              MOD_PAT,  MOD_OPT, PCRE2_DOLLAR_ENDONLY,       PO(options) },
   { "dotall",                      MOD_PATP, MOD_OPT, PCRE2_DOTALL,               PO(options) },
   { "dupnames",                    MOD_PATP, MOD_OPT, PCRE2_DUPNAMES,             PO(options) },
@@ -680,12 +685,14 @@ static modstruct modlist[] = {
   { "literal",                     MOD_PAT,  MOD_OPT, PCRE2_LITERAL,              PO(options) },
   { "locale",                      MOD_PAT,  MOD_STR, LOCALESIZE,                 PO(locale) },
   { "mark",                        MOD_PNDP, MOD_CTL, CTL_MARK,                   PO(control) },
+  { "match_buffer",                MOD_DAT,  MOD_INT, 0,                          DO(match_buffer) },
   { "match_invalid_utf",           MOD_PAT,  MOD_OPT, PCRE2_MATCH_INVALID_UTF,    PO(options) },
   { "match_limit",                 MOD_CTM,  MOD_INT, 0,                          MO(match_limit) },
   { "match_line",                  MOD_CTC,  MOD_OPT, PCRE2_EXTRA_MATCH_LINE,     CO(extra_options) },
   { "match_unset_backref",         MOD_PAT,  MOD_OPT, PCRE2_MATCH_UNSET_BACKREF,  PO(options) },
   { "match_word",                  MOD_CTC,  MOD_OPT, PCRE2_EXTRA_MATCH_WORD,     CO(extra_options) },
   { "max_pattern_length",          MOD_CTC,  MOD_SIZ, 0,                          CO(max_pattern_length) },
+  { "memo_limit",                  MOD_CTM,  MOD_INT, 0,                          MO(memo_limit) },
   { "memory",                      MOD_PD,   MOD_CTL, CTL_MEMORY,                 PD(control) },
   { "multiline",                   MOD_PATP, MOD_OPT, PCRE2_MULTILINE,            PO(options) },
   { "never_backslash_c",           MOD_PAT,  MOD_OPT, PCRE2_NEVER_BACKSLASH_C,    PO(options) },
@@ -708,6 +715,7 @@ static modstruct modlist[] = {
   { "ovector",                     MOD_DAT,  MOD_INT, 0,                          DO(oveccount) },
   { "parens_nest_limit",           MOD_CTC,  MOD_INT, 0,                          CO(parens_nest_limit) },
   { "partial_hard",                MOD_DAT,  MOD_OPT, PCRE2_PARTIAL_HARD,         DO(options) },
+  { "partial_resume",              MOD_DAT,  MOD_OPT, PCRE2_PARTIAL_RESUME,       DO(options) },
   { "partial_soft",                MOD_DAT,  MOD_OPT, PCRE2_PARTIAL_SOFT,         DO(options) },
   { "ph",                          MOD_DAT,  MOD_OPT, PCRE2_PARTIAL_HARD,         DO(options) },
   { "posix",                       MOD_PAT,  MOD_CTL, CTL_POSIX,                  PO(control) },
@@ -723,6 +731,7 @@ static modstruct modlist[] = {
   { "stackguard",                  MOD_PAT,  MOD_INT, 0,                          PO(stackguard_test) },
   { "startchar",                   MOD_PND,  MOD_CTL, CTL_STARTCHAR,              PO(control) },
   { "startoffset",                 MOD_DAT,  MOD_INT, 0,                          DO(offset) },
+  { "stats",                       MOD_PND,  MOD_CTL, CTL2_STATS,                 PO(control2) },
   { "subject_literal",             MOD_PATP, MOD_CTL, CTL2_SUBJECT_LITERAL,       PO(control2) },
   { "substitute_callout",          MOD_PND,  MOD_CTL, CTL2_SUBSTITUTE_CALLOUT,    PO(control2) },
   { "substitute_extended",         MOD_PND,  MOD_CTL, CTL2_SUBSTITUTE_EXTENDED,   PO(control2) },
@@ -910,6 +919,8 @@ static FILE *outfile;
 static const void *last_callout_mark;
 static PCRE2_JIT_STACK *jit_stack = NULL;
 static size_t jit_stack_size = 0;
+static void *match_buffer = NULL;
+static size_t match_buffer_size = 0;
 
 static BOOL first_callout;
 static BOOL jit_was_used;
@@ -956,6 +967,7 @@ static regex_t preg = { NULL, NULL, 0, 0, 0, 0 };
 #endif
 
 static int *dfa_workspace = NULL;
+static void *dfa_workspace_object = NULL;
 static const uint8_t *locale_tables = NULL;
 static const uint8_t *use_tables = NULL;
 static uint8_t locale_name[32];
@@ -986,6 +998,7 @@ static pcre2_code_8             *compiled_code8;
 static pcre2_general_context_8  *general_context8, *general_context_copy8;
 static pcre2_compile_context_8  *pat_context8, *default_pat_context8;
 static pcre2_convert_context_8  *con_context8, *default_con_context8;
+static pcre2_glob_8             *compiled_glob8;
 static pcre2_match_context_8    *dat_context8, *default_dat_context8;
 static pcre2_match_data_8       *match_data8;
 #endif
@@ -995,6 +1008,7 @@ static pcre2_code_16            *compiled_code16;
 static pcre2_general_context_16 *general_context16, *general_context_copy16;
 static pcre2_compile_context_16 *pat_context16, *default_pat_context16;
 static pcre2_convert_context_16 *con_context16, *default_con_context16;
+static pcre2_glob_16            *compiled_glob16;
 static pcre2_match_context_16   *dat_context16, *default_dat_context16;
 static pcre2_match_data_16      *match_data16;
 static PCRE2_SIZE pbuffer16_size = 0;   /* Set only when needed */
@@ -1006,6 +1020,7 @@ static pcre2_code_32            *compiled_code32;
 static pcre2_general_context_32 *general_context32, *general_context_copy32;
 static pcre2_compile_context_32 *pat_context32, *default_pat_context32;
 static pcre2_convert_context_32 *con_context32, *default_con_context32;
+static pcre2_glob_32            *compiled_glob32;
 static pcre2_match_context_32   *dat_context32, *default_dat_context32;
 static pcre2_match_data_32      *match_data32;
 static PCRE2_SIZE pbuffer32_size = 0;   /* Set only when needed */
@@ -1150,6 +1165,22 @@ are supported. */
   else \
     a = pcre2_dfa_match_32(G(b,32),(PCRE2_SPTR32)c,d,e,f,G(g,32),h,i,j)
 
+#define PCRE2_DFA_WORKSPACE_CREATE(a,b) \
+  if (test_mode == PCRE8_MODE) \
+    a = (void *)pcre2_dfa_workspace_create_8(b,NULL); \
+  else if (test_mode == PCRE16_MODE) \
+    a = (void *)pcre2_dfa_workspace_create_16(b,NULL); \
+  else \
+    a = (void *)pcre2_dfa_workspace_create_32(b,NULL)
+
+#define PCRE2_DFA_WORKSPACE_FREE(a) \
+  if (test_mode == PCRE8_MODE) \
+    pcre2_dfa_workspace_free_8((pcre2_dfa_workspace_8 *)a); \
+  else if (test_mode == PCRE16_MODE) \
+    pcre2_dfa_workspace_free_16((pcre2_dfa_workspace_16 *)a); \
+  else \
+    pcre2_dfa_workspace_free_32((pcre2_dfa_workspace_32 *)a)
+
 #define PCRE2_GET_ERROR_MESSAGE(r,a,b) \
   if (test_mode == PCRE8_MODE) \
     r = pcre2_get_error_message_8(a,G(b,8),G(G(b,8),_size)); \
@@ -1174,6 +1205,22 @@ are supported. */
   else \
     a = pcre2_get_startchar_32(G(b,32))
 
+#define PCRE2_GLOB_COMPILE(a,b,c,d,e,f,g) \
+  if (test_mode == PCRE8_MODE) \
+    G(a,8) = pcre2_glob_compile_8(G(b,8),c,d,e,f,G(g,8)); \
+  else if (test_mode == PCRE16_MODE) \
+    G(a,16) = pcre2_glob_compile_16(G(b,16),c,d,e,f,G(g,16)); \
+  else \
+    G(a,32) = pcre2_glob_compile_32(G(b,32),c,d,e,f,G(g,32))
+
+#define PCRE2_GLOB_MATCH(a,b,c,d,e) \
+  if (test_mode == PCRE8_MODE) \
+    a = pcre2_glob_match_8(G(b,8),(PCRE2_SPTR8)c,d,e); \
+  else if (test_mode == PCRE16_MODE) \
+    a = pcre2_glob_match_16(G(b,16),(PCRE2_SPTR16)c,d,e); \
+  else \
+    a = pcre2_glob_match_32(G(b,32),(PCRE2_SPTR32)c,d,e)
+
 #define PCRE2_JIT_COMPILE(r,a,b) \
   if (test_mode == PCRE8_MODE) r = pcre2_jit_compile_8(G(a,8),b); \
   else if (test_mode == PCRE16_MODE) r = pcre2_jit_compile_16(G(a,16),b); \
@@ -1365,6 +1412,14 @@ are supported. */
   else \
     pcre2_set_heap_limit_32(G(a,32),b)
 
+#define PCRE2_SET_MATCH_BUFFER(a,b,c) \
+  if (test_mode == PCRE8_MODE) \
+    pcre2_set_match_buffer_8(G(a,8),b,c); \
+  else if (test_mode == PCRE16_MODE) \
+    pcre2_set_match_buffer_16(G(a,16),b,c); \
+  else \
+    pcre2_set_match_buffer_32(G(a,32),b,c)
+
 #define PCRE2_SET_MATCH_LIMIT(a,b) \
   if (test_mode == PCRE8_MODE) \
     pcre2_set_match_limit_8(G(a,8),b); \
@@ -1679,6 +1734,18 @@ the three different cases. */
     a = G(pcre2_dfa_match_,BITTWO)(G(b,BITTWO),(G(PCRE2_SPTR,BITTWO))c,d,e,f, \
       G(g,BITTWO),h,i,j)
 
+#define PCRE2_DFA_WORKSPACE_CREATE(a,b) \
+  if (test_mode == G(G(PCRE,BITONE),_MODE)) \
+    a = (void *)G(pcre2_dfa_workspace_create_,BITONE)(b,NULL); \
+  else \
+    a = (void *)G(pcre2_dfa_workspace_create_,BITTWO)(b,NULL)
+
+#define PCRE2_DFA_WORKSPACE_FREE(a) \
+  if (test_mode == G(G(PCRE,BITONE),_MODE)) \
+    G(pcre2_dfa_workspace_free_,BITONE)((G(pcre2_dfa_workspace_,BITONE) *)a); \
+  else \
+    G(pcre2_dfa_workspace_free_,BITTWO)((G(pcre2_dfa_workspace_,BITTWO) *)a)
+
 #define PCRE2_GET_ERROR_MESSAGE(r,a,b) \
   if (test_mode == G(G(PCRE,BITONE),_MODE)) \
     r = G(pcre2_get_error_message_,BITONE)(a,G(b,BITONE),G(G(b,BITONE),_size/BYTEONE)); \
@@ -1697,6 +1764,18 @@ the three different cases. */
   else \
     a = G(pcre2_get_startchar_,BITTWO)(G(b,BITTWO))
 
+#define PCRE2_GLOB_COMPILE(a,b,c,d,e,f,g) \
+  if (test_mode == G(G(PCRE,BITONE),_MODE)) \
+    G(a,BITONE) = G(pcre2_glob_compile_,BITONE)(G(b,BITONE),c,d,e,f,G(g,BITONE)); \
+  else \
+    G(a,BITTWO) = G(pcre2_glob_compile_,BITTWO)(G(b,BITTWO),c,d,e,f,G(g,BITTWO))
+
+#define PCRE2_GLOB_MATCH(a,b,c,d,e) \
+  if (test_mode == G(G(PCRE,BITONE),_MODE)) \
+    a = G(pcre2_glob_match_,BITONE)(G(b,BITONE),(G(PCRE2_SPTR,BITONE))c,d,e); \
+  else \
+    a = G(pcre2_glob_match_,BITTWO)(G(b,BITTWO),(G(PCRE2_SPTR,BITTWO))c,d,e)
+
 #define PCRE2_JIT_COMPILE(r,a,b) \
   if (test_mode == G(G(PCRE,BITONE),_MODE)) \
     r = G(pcre2_jit_compile_,BITONE)(G(a,BITONE),b); \
@@ -1853,6 +1932,12 @@ the three different cases. */
   else \
     G(pcre2_set_heap_limit_,BITTWO)(G(a,BITTWO),b)
 
+#define PCRE2_SET_MATCH_BUFFER(a,b,c) \
+  if (test_mode == G(G(PCRE,BITONE),_MODE)) \
+    G(pcre2_set_match_buffer_,BITONE)(G(a,BITONE),b,c); \
+  else \
+    G(pcre2_set_match_buffer_,BITTWO)(G(a,BITTWO),b,c)
+
 #define PCRE2_SET_MATCH_LIMIT(a,b) \
   if (test_mode == G(G(PCRE,BITONE),_MODE)) \
     G(pcre2_set_match_limit_,BITONE)(G(a,BITONE),b); \
@@ -2043,10 +2128,18 @@ the three different cases. */
   pcre2_converted_pattern_free_8((PCRE2_UCHAR8 *)a)
 #define PCRE2_DFA_MATCH(a,b,c,d,e,f,g,h,i,j) \
   a = pcre2_dfa_match_8(G(b,8),(PCRE2_SPTR8)c,d,e,f,G(g,8),h,i,j)
+#define PCRE2_DFA_WORKSPACE_CREATE(a,b) \
+  a = (void *)pcre2_dfa_workspace_create_8(b,NULL)
+#define PCRE2_DFA_WORKSPACE_FREE(a) \
+  pcre2_dfa_workspace_free_8((pcre2_dfa_workspace_8 *)a)
 #define PCRE2_GET_ERROR_MESSAGE(r,a,b) \
   r = pcre2_get_error_message_8(a,G(b,8),G(G(b,8),_size))
 #define PCRE2_GET_OVECTOR_COUNT(a,b) a = pcre2_get_ovector_count_8(G(b,8))
 #define PCRE2_GET_STARTCHAR(a,b) a = pcre2_get_startchar_8(G(b,8))
+#define PCRE2_GLOB_COMPILE(a,b,c,d,e,f,g) \
+  G(a,8) = pcre2_glob_compile_8(G(b,8),c,d,e,f,G(g,8))
+#define PCRE2_GLOB_MATCH(a,b,c,d,e) \
+  a = pcre2_glob_match_8(G(b,8),(PCRE2_SPTR8)c,d,e)
 #define PCRE2_JIT_COMPILE(r,a,b) r = pcre2_jit_compile_8(G(a,8),b)
 #define PCRE2_JIT_FREE_UNUSED_MEMORY(a) pcre2_jit_free_unused_memory_8(G(a,8))
 #define PCRE2_JIT_MATCH(a,b,c,d,e,f,g,h) \
@@ -2082,6 +2175,7 @@ the three different cases. */
 #define PCRE2_SET_GLOB_ESCAPE(r,a,b) r = pcre2_set_glob_escape_8(G(a,8),b)
 #define PCRE2_SET_GLOB_SEPARATOR(r,a,b) r = pcre2_set_glob_separator_8(G(a,8),b)
 #define PCRE2_SET_HEAP_LIMIT(a,b) pcre2_set_heap_limit_8(G(a,8),b)
+#define PCRE2_SET_MATCH_BUFFER(a,b,c) pcre2_set_match_buffer_8(G(a,8),b,c)
 #define PCRE2_SET_MATCH_LIMIT(a,b) pcre2_set_match_limit_8(G(a,8),b)
 #define PCRE2_SET_MAX_PATTERN_LENGTH(a,b) pcre2_set_max_pattern_length_8(G(a,8),b)
 #define PCRE2_SET_OFFSET_LIMIT(a,b) pcre2_set_offset_limit_8(G(a,8),b)
@@ -2150,10 +2244,18 @@ the three different cases. */
   pcre2_converted_pattern_free_16((PCRE2_UCHAR16 *)a)
 #define PCRE2_DFA_MATCH(a,b,c,d,e,f,g,h,i,j) \
   a = pcre2_dfa_match_16(G(b,16),(PCRE2_SPTR16)c,d,e,f,G(g,16),h,i,j)
+#define PCRE2_DFA_WORKSPACE_CREATE(a,b) \
+  a = (void *)pcre2_dfa_workspace_create_16(b,NULL)
+#define PCRE2_DFA_WORKSPACE_FREE(a) \
+  pcre2_dfa_workspace_free_16((pcre2_dfa_workspace_16 *)a)
 #define PCRE2_GET_ERROR_MESSAGE(r,a,b) \
   r = pcre2_get_error_message_16(a,G(b,16),G(G(b,16),_size/2))
 #define PCRE2_GET_OVECTOR_COUNT(a,b) a = pcre2_get_ovector_count_16(G(b,16))
 #define PCRE2_GET_STARTCHAR(a,b) a = pcre2_get_startchar_16(G(b,16))
+#define PCRE2_GLOB_COMPILE(a,b,c,d,e,f,g) \
+  G(a,16) = pcre2_glob_compile_16(G(b,16),c,d,e,f,G(g,16))
+#define PCRE2_GLOB_MATCH(a,b,c,d,e) \
+  a = pcre2_glob_match_16(G(b,16),(PCRE2_SPTR16)c,d,e)
 #define PCRE2_JIT_COMPILE(r,a,b) r = pcre2_jit_compile_16(G(a,16),b)
 #define PCRE2_JIT_FREE_UNUSED_MEMORY(a) pcre2_jit_free_unused_memory_16(G(a,16))
 #define PCRE2_JIT_MATCH(a,b,c,d,e,f,g,h) \
@@ -2189,6 +2291,7 @@ the three different cases. */
 #define PCRE2_SET_GLOB_ESCAPE(r,a,b) r = pcre2_set_glob_escape_16(G(a,16),b)
 #define PCRE2_SET_GLOB_SEPARATOR(r,a,b) r = pcre2_set_glob_separator_16(G(a,16),b)
 #define PCRE2_SET_HEAP_LIMIT(a,b) pcre2_set_heap_limit_16(G(a,16),b)
+#define PCRE2_SET_MATCH_BUFFER(a,b,c) pcre2_set_match_buffer_16(G(a,16),b,c)
 #define PCRE2_SET_MATCH_LIMIT(a,b) pcre2_set_match_limit_16(G(a,16),b)
 #define PCRE2_SET_MAX_PATTERN_LENGTH(a,b) pcre2_set_max_pattern_length_16(G(a,16),b)
 #define PCRE2_SET_OFFSET_LIMIT(a,b) pcre2_set_offset_limit_16(G(a,16),b)
@@ -2257,10 +2360,18 @@ the three different cases. */
   pcre2_converted_pattern_free_32((PCRE2_UCHAR32 *)a)
 #define PCRE2_DFA_MATCH(a,b,c,d,e,f,g,h,i,j) \
   a = pcre2_dfa_match_32(G(b,32),(PCRE2_SPTR32)c,d,e,f,G(g,32),h,i,j)
+#define PCRE2_DFA_WORKSPACE_CREATE(a,b) \
+  a = (void *)pcre2_dfa_workspace_create_32(b,NULL)
+#define PCRE2_DFA_WORKSPACE_FREE(a) \
+  pcre2_dfa_workspace_free_32((pcre2_dfa_workspace_32 *)a)
 #define PCRE2_GET_ERROR_MESSAGE(r,a,b) \
   r = pcre2_get_error_message_32(a,G(b,32),G(G(b,32),_size/4))
 #define PCRE2_GET_OVECTOR_COUNT(a,b) a = pcre2_get_ovector_count_32(G(b,32))
 #define PCRE2_GET_STARTCHAR(a,b) a = pcre2_get_startchar_32(G(b,32))
+#define PCRE2_GLOB_COMPILE(a,b,c,d,e,f,g) \
+  G(a,32) = pcre2_glob_compile_32(G(b,32),c,d,e,f,G(g,32))
+#define PCRE2_GLOB_MATCH(a,b,c,d,e) \
+  a = pcre2_glob_match_32(G(b,32),(PCRE2_SPTR32)c,d,e)
 #define PCRE2_JIT_COMPILE(r,a,b) r = pcre2_jit_compile_32(G(a,32),b)
 #define PCRE2_JIT_FREE_UNUSED_MEMORY(a) pcre2_jit_free_unused_memory_32(G(a,32))
 #define PCRE2_JIT_MATCH(a,b,c,d,e,f,g,h) \
@@ -2296,6 +2407,7 @@ the three different cases. */
 #define PCRE2_SET_GLOB_ESCAPE(r,a,b) r = pcre2_set_glob_escape_32(G(a,32),b)
 #define PCRE2_SET_GLOB_SEPARATOR(r,a,b) r = pcre2_set_glob_separator_32(G(a,32),b)
 #define PCRE2_SET_HEAP_LIMIT(a,b) pcre2_set_heap_limit_32(G(a,32),b)
+#define PCRE2_SET_MATCH_BUFFER(a,b,c) pcre2_set_match_buffer_32(G(a,32),b,c)
 #define PCRE2_SET_MATCH_LIMIT(a,b) pcre2_set_match_limit_32(G(a,32),b)
 #define PCRE2_SET_MAX_PATTERN_LENGTH(a,b) pcre2_set_max_pattern_length_32(G(a,32),b)
 #define PCRE2_SET_OFFSET_LIMIT(a,b) pcre2_set_offset_limit_32(G(a,32),b)
@@ -4099,7 +4211,7 @@ Returns:      nothing
 static void
 show_controls(uint32_t controls, uint32_t controls2, const char *before)
 {
-fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
+fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
   before,
   ((controls & CTL_AFTERTEXT) != 0)? " aftertext" : "",
   ((controls & CTL_ALLAFTERTEXT) != 0)? " allaftertext" : "",
@@ -4115,6 +4227,7 @@ fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s
   ((controls & CTL_CALLOUT_NONE) != 0)? " callout_none" : "",
   ((controls2 & CTL2_CALLOUT_NO_WHERE) != 0)? " callout_no_where" : "",
   ((controls & CTL_DFA) != 0)? " dfa" : "",
+  ((controls2 & CTL2_DFA_WORKSPACE) != 0)? " dfa_workspace" : "",
   ((controls & CTL_EXPAND) != 0)? " expand" : "",
   ((controls & CTL_FINDLIMITS) != 0)? " find_limits" : "",
   ((controls & CTL_FRAMESIZE) != 0)? " framesize" : "",
@@ -4135,6 +4248,7 @@ fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s
   ((controls & CTL_PUSHCOPY) != 0)? " pushcopy" : "",
   ((controls & CTL_PUSHTABLESCOPY) != 0)? " pushtablescopy" : "",
   ((controls & CTL_STARTCHAR) != 0)? " startchar" : "",
+  ((controls2 & CTL2_STATS) != 0)? " stats" : "",
   ((controls2 & CTL2_SUBSTITUTE_CALLOUT) != 0)? " substitute_callout" : "",
   ((controls2 & CTL2_SUBSTITUTE_EXTENDED) != 0)? " substitute_extended" : "",
   ((controls2 & CTL2_SUBSTITUTE_LITERAL) != 0)? " substitute_literal" : "",
@@ -4246,7 +4360,7 @@ else fprintf(outfile, "%s%s%s%s%s%s%s%s",
 static void
 show_match_options(uint32_t options)
 {
-fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s",
+fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
   ((options & PCRE2_ANCHORED) != 0)? " anchored" : "",
   ((options & PCRE2_COPY_MATCHED_SUBJECT) != 0)? " copy_matched_subject" : "",
   ((options & PCRE2_DFA_RESTART) != 0)? " dfa_restart" : "",
@@ -4259,6 +4373,7 @@ fprintf(outfile, "%s%s%s%s%s%s%s%s%s%s%s%s%s",
   ((options & PCRE2_NOTEMPTY_ATSTART) != 0)? " notempty_atstart" : "",
   ((options & PCRE2_NOTEOL) != 0)? " noteol" : "",
   ((options & PCRE2_PARTIAL_HARD) != 0)? " partial_hard" : "",
+  ((options & PCRE2_PARTIAL_RESUME) != 0)? " partial_resume" : "",
   ((options & PCRE2_PARTIAL_SOFT) != 0)? " partial_soft" : "");
 }
 #endif  /* SUPPORT_PCRE2_8 */
@@ -4274,6 +4389,7 @@ show_memory_info(void)
 {
 uint32_t name_count, name_entry_size;
 size_t size, cblock_size;
+void *start_bitmap;
 
 /* One of the test_mode values will always be true, but to stop a compiler
 warning we must initialize cblock_size. */
@@ -4292,6 +4408,12 @@ if (test_mode == PCRE32_MODE) cblock_size = sizeof(pcre2_real_code_32);
 (void)pattern_info(PCRE2_INFO_SIZE, &size, FALSE);
 (void)pattern_info(PCRE2_INFO_NAMECOUNT, &name_count, FALSE);
 (void)pattern_info(PCRE2_INFO_NAMEENTRYSIZE, &name_entry_size, FALSE);
+(void)pattern_info(PCRE2_INFO_FIRSTBITMAP, &start_bitmap, FALSE);
+
+/* A bitmap of starting code units is held after the compiled code, at the
+end of the block. */
+
+if (start_bitmap != NULL) size -= START_BITMAP_SIZE;
 fprintf(outfile, "Memory allocation (code space): %d\n",
   (int)(size - name_count*name_entry_size*code_unit_size - cblock_size));
 if (pat_patctl.jit != 0)
@@ -4317,6 +4439,30 @@ fprintf(outfile, "Frame size for pcre2_match(): %d\n", (int)frame_size);
 
 
 
+/*************************************************
+*         Show statistics for a match            *
+*************************************************/
+
+static void
+show_match_stats(void)
+{
+if ((FLD(match_data, flags) & PCRE2_MD_STATS) == 0)
+  {
+  fprintf(outfile, "Statistics: not available\n");
+  return;
+  }
+fprintf(outfile, "Statistics: start positions=%lu opcodes=%lu backtracks=%lu\n"
+  "  frames=%lu max depth=%lu subject scanned=%lu\n",
+  (unsigned long int)FLD(match_data, stats.start_positions),
+  (unsigned long int)FLD(match_data, stats.opcodes),
+  (unsigned long int)FLD(match_data, stats.backtracks),
+  (unsigned long int)FLD(match_data, stats.frames),
+  (unsigned long int)FLD(match_data, stats.max_depth),
+  (unsigned long int)FLD(match_data, stats.subject_scanned));
+}
+
+
+
 /*************************************************
 *         Get and output an error message        *
 *************************************************/
@@ -5228,6 +5374,11 @@ if (pat_patctl.jit == 0 &&
     (pat_patctl.control & (CTL_JITVERIFY|CTL_JITFAST)) != 0)
   pat_patctl.jit = JIT_DEFAULT;
 
+/* JIT code collects statistics only if it is compiled to do so. */
+
+if (pat_patctl.jit != 0 && (pat_patctl.control2 & CTL2_STATS) != 0)
+  pat_patctl.jit |= PCRE2_JIT_STATS;
+
 /* Now copy the pattern to pbuffer8 for use in 8-bit testing and for reflecting
 in callouts. Convert from hex if requested (literal strings in quotes may be
 present within the hexadecimal pairs). The result must necessarily be fewer
@@ -5695,6 +5846,35 @@ if (pat_patctl.convert_type != CONVERT_UNSET)
   PCRE2_PATTERN_CONVERT(rc, pbuffer, patlen, convert_options,
     &converted_pattern, &converted_length, con_context);
 
+  /* Unless the conversion is being done into a caller's buffer, also compile
+  the glob for pcre2_glob_match(), so that its results can be checked against
+  those of the converted pattern. Any difference in the errors is reported. */
+
+  SUB1(pcre2_glob_free, compiled_glob);
+  SET(compiled_glob, NULL);
+
+  if ((convert_options & PCRE2_CONVERT_GLOB) != 0 &&
+      pat_patctl.convert_length == 0)
+    {
+    int grc;
+    PCRE2_SIZE goffset;
+
+    PCRE2_GLOB_COMPILE(compiled_glob, pbuffer, patlen, convert_options,
+      &grc, &goffset, con_context);
+    if (grc != rc || (rc != 0 && goffset != converted_length))
+      fprintf(outfile, "** pcre2_glob_compile() error %d at offset %"
+        SIZ_FORM " differs\n", grc, SIZ_CAST goffset);
+
+    /* The glob cannot be compared with a pattern that has other options. */
+
+    if ((pat_patctl.options & ~(PCRE2_UTF|PCRE2_NO_UTF_CHECK)) != 0 ||
+        (pat_patctl.control & CTL_POSIX) != 0)
+      {
+      SUB1(pcre2_glob_free, compiled_glob);
+      SET(compiled_glob, NULL);
+      }
+    }
+
   if (rc != 0)
     {
     fprintf(outfile, "** Pattern conversion error at offset %" SIZ_FORM ": ",
@@ -7074,6 +7254,7 @@ if ((pat_patctl.control & CTL_POSIX) != 0)
   if (dat_datctl.get_numbers[0] >= 0 || dat_datctl.get_names[0] != 0)
     prmsg(&msg, "get");
   if (dat_datctl.jitstack != 0) prmsg(&msg, "jitstack");
+  if (dat_datctl.match_buffer != 0) prmsg(&msg, "match_buffer");
   if (dat_datctl.offset != 0) prmsg(&msg, "offset");
 
   if ((dat_datctl.options & ~POSIX_SUPPORTED_MATCH_OPTIONS) != 0)
@@ -7192,6 +7373,26 @@ NULL context. */
 use_dat_context = ((dat_datctl.control & CTL_NULLCONTEXT) != 0)?
   NULL : PTR(dat_context);
 
+/* Statistics are requested via the match context. */
+
+SETFLD(dat_context, collect_stats, (dat_datctl.control2 & CTL2_STATS) != 0);
+
+/* The dfa_workspace modifier makes DFA matching use a workspace object, which
+is kept from one subject line to the next, instead of pcre2test's own vector. */
+
+if ((dat_datctl.control2 & CTL2_DFA_WORKSPACE) != 0)
+  {
+  if (dfa_workspace_object == NULL)
+    {
+    PCRE2_DFA_WORKSPACE_CREATE(dfa_workspace_object, DFA_WS_DIMENSION);
+    }
+  SETFLD(dat_context, dfa_workspace, dfa_workspace_object);
+  }
+else
+  {
+  SETFLD(dat_context, dfa_workspace, NULL);
+  }
+
 /* Enable display of malloc/free if wanted. We can do this only if either the
 pattern or the subject is processed with a context. */
 
@@ -7225,6 +7426,27 @@ else if (jit_stack != NULL)
   jit_stack_size = 0;
   }
 
+/* Give the match context a real-time buffer if requested. The buffer is kept
+for subsequent lines that ask for the same size. */
+
+if (dat_datctl.match_buffer != 0)
+  {
+  if (dat_datctl.match_buffer != match_buffer_size)
+    {
+    free(match_buffer);
+    match_buffer = malloc(dat_datctl.match_buffer);
+    if (match_buffer == NULL)
+      {
+      fprintf(outfile, "** Failed to get memory for a match buffer (size "
+        "requested: %d)\n", dat_datctl.match_buffer);
+      match_buffer_size = 0;
+      return PR_OK;
+      }
+    match_buffer_size = dat_datctl.match_buffer;
+    }
+  PCRE2_SET_MATCH_BUFFER(dat_context, match_buffer, match_buffer_size);
+  }
+
 /* When no JIT stack is assigned, we must ensure that there is a JIT callback
 if we want to verify that JIT was actually used. */
 
@@ -7504,9 +7726,18 @@ for (gmatched = 0;; gmatched++)
       start_time = clock();
       for (i = 0; i < timeitm; i++)
         {
-        PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
-          dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
-          use_dat_context, dfa_workspace, DFA_WS_DIMENSION);
+        if ((dat_datctl.control2 & CTL2_DFA_WORKSPACE) != 0)
+          {
+          PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
+            dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
+            use_dat_context, NULL, 0);
+          }
+        else
+          {
+          PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
+            dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
+            use_dat_context, dfa_workspace, DFA_WS_DIMENSION);
+          }
         }
       }
 
@@ -7595,9 +7826,18 @@ for (gmatched = 0;; gmatched++)
         dfa_workspace = (int *)malloc(DFA_WS_DIMENSION*sizeof(int));
       if (dfa_matched++ == 0)
         dfa_workspace[0] = -1;  /* To catch bad restart */
-      PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
-        dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
-        use_dat_context, dfa_workspace, DFA_WS_DIMENSION);
+      if ((dat_datctl.control2 & CTL2_DFA_WORKSPACE) != 0)
+        {
+        PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
+          dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
+          use_dat_context, NULL, 0);
+        }
+      else
+        {
+        PCRE2_DFA_MATCH(capcount, compiled_code, pp, arg_ulen,
+          dat_datctl.offset, dat_datctl.options | g_notempty, match_data,
+          use_dat_context, dfa_workspace, DFA_WS_DIMENSION);
+        }
       if (capcount == 0)
         {
         fprintf(outfile, "Matched, but offsets vector is too small to show all matches\n");
@@ -7620,6 +7860,25 @@ for (gmatched = 0;; gmatched++)
       }
     }
 
+  /* Show statistics if requested. */
+
+  if ((dat_datctl.control2 & CTL2_STATS) != 0) show_match_stats();
+
+  /* If the pattern was converted from a glob, check that pcre2_glob_match()
+  gives the same result for the first match with no options. */
+
+  if (gmatched == 0 && TEST(compiled_glob, !=, NULL) &&
+      dat_datctl.offset == 0 &&
+      (dat_datctl.options & ~PCRE2_NO_UTF_CHECK) == 0 &&
+      (dat_datctl.control & CTL_DFA) == 0 &&
+      (capcount >= 0 || capcount == PCRE2_ERROR_NOMATCH))
+    {
+    int grc;
+    PCRE2_GLOB_MATCH(grc, compiled_glob, pp, arg_ulen, dat_datctl.options);
+    if ((grc > 0) != (capcount >= 0))
+      fprintf(outfile, "** pcre2_glob_match() returned %d\n", grc);
+    }
+
   /* The result of the match is now in capcount. First handle a successful
   match. */
 
@@ -9065,6 +9324,8 @@ while (notdone)
         SUB1(pcre2_code_free, compiled_code);
         SET(compiled_code, NULL);
         }
+      SUB1(pcre2_glob_free, compiled_glob);
+      SET(compiled_glob, NULL);
       skipping = FALSE;
       setlocale(LC_CTYPE, "C");
       }
@@ -9154,10 +9415,15 @@ free(buffer);
 free(dbuffer);
 free(pbuffer8);
 free(dfa_workspace);
+if (dfa_workspace_object != NULL)
+  {
+  PCRE2_DFA_WORKSPACE_FREE(dfa_workspace_object);
+  }
 free((void *)locale_tables);
 free(tables3);
 PCRE2_MATCH_DATA_FREE(match_data);
 SUB1(pcre2_code_free, compiled_code);
+SUB1(pcre2_glob_free, compiled_glob);
 
 while(patstacknext-- > 0)
   {
@@ -9170,6 +9436,7 @@ if (jit_stack != NULL)
   {
   PCRE2_JIT_STACK_FREE(jit_stack);
   }
+free(match_buffer);
 
 #define FREECONTEXTS \
   G(pcre2_general_context_free_,BITS)(G(general_context,BITS)); \
@@ -0,0 +1,316 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* This module is a thin wrapper that dispatches to the 8-bit, 16-bit, or
+32-bit PCRE2 library according to the code unit width that was given when a
+pattern was compiled. See pcre2any.h for the interface. The subject of a match
+is passed through untouched, so no transcoding or copying takes place. */
+
+
+#include <stdlib.h>
+
+/* Ensure that the functions are exported from a Windows DLL. */
+
+#if defined(_WIN32) && !defined(PCRE2_STATIC)
+#  define PCRE2ANY_EXP_DECL extern __declspec(dllexport)
+#  define PCRE2ANY_EXP_DEFN __declspec(dllexport)
+#else
+#  define PCRE2ANY_EXP_DEFN
+#endif
+
+#include "pcre2any.h"
+
+
+/* The wrapper blocks hold the width and a pointer to the block of the
+underlying library. */
+
+struct pcre2any_code {
+  int width;
+  union {
+    pcre2_code_8  *c8;
+    pcre2_code_16 *c16;
+    pcre2_code_32 *c32;
+  } u;
+};
+
+struct pcre2any_match_data {
+  int width;
+  union {
+    pcre2_match_data_8  *m8;
+    pcre2_match_data_16 *m16;
+    pcre2_match_data_32 *m32;
+  } u;
+};
+
+
+
+/*************************************************
+*               Compile a pattern                *
+*************************************************/
+
+/*
+Arguments:
+  pattern       the pattern, in code units of the given width
+  length        its length in code units, or PCRE2_ZERO_TERMINATED
+  width         8, 16, or 32
+  options       options for pcre2_compile()
+  errorcode     where to put an error code
+  erroroffset   where to put an error offset
+
+Returns:        the compiled pattern, or NULL on error
+*/
+
+PCRE2ANY_EXP_DEFN pcre2any_code *
+pcre2any_compile(const void *pattern, PCRE2_SIZE length, int width,
+  uint32_t options, int *errorcode, PCRE2_SIZE *erroroffset)
+{
+pcre2any_code *code;
+void *re = NULL;
+
+*erroroffset = 0;
+if (width != 8 && width != 16 && width != 32)
+  {
+  *errorcode = PCRE2_ERROR_BADMODE;
+  return NULL;
+  }
+
+code = (pcre2any_code *)malloc(sizeof(pcre2any_code));
+if (code == NULL)
+  {
+  *errorcode = PCRE2_ERROR_NOMEMORY;
+  return NULL;
+  }
+code->width = width;
+
+switch (width)
+  {
+  case 8:
+  re = code->u.c8 = pcre2_compile_8((PCRE2_SPTR8)pattern, length, options,
+    errorcode, erroroffset, NULL);
+  break;
+
+  case 16:
+  re = code->u.c16 = pcre2_compile_16((PCRE2_SPTR16)pattern, length, options,
+    errorcode, erroroffset, NULL);
+  break;
+
+  case 32:
+  re = code->u.c32 = pcre2_compile_32((PCRE2_SPTR32)pattern, length, options,
+    errorcode, erroroffset, NULL);
+  break;
+  }
+
+if (re == NULL)
+  {
+  free(code);
+  return NULL;
+  }
+return code;
+}
+
+
+
+/*************************************************
+*            Free a compiled pattern             *
+*************************************************/
+
+PCRE2ANY_EXP_DEFN void
+pcre2any_code_free(pcre2any_code *code)
+{
+if (code == NULL) return;
+switch (code->width)
+  {
+  case 8:  pcre2_code_free_8(code->u.c8); break;
+  case 16: pcre2_code_free_16(code->u.c16); break;
+  case 32: pcre2_code_free_32(code->u.c32); break;
+  }
+free(code);
+}
+
+
+
+/*************************************************
+*        Return a compiled pattern's width       *
+*************************************************/
+
+PCRE2ANY_EXP_DEFN int
+pcre2any_code_width(const pcre2any_code *code)
+{
+return (code == NULL)? PCRE2_ERROR_NULL : code->width;
+}
+
+
+
+/*************************************************
+*          JIT-compile a compiled pattern        *
+*************************************************/
+
+PCRE2ANY_EXP_DEFN int
+pcre2any_jit_compile(pcre2any_code *code, uint32_t options)
+{
+if (code == NULL) return PCRE2_ERROR_NULL;
+switch (code->width)
+  {
+  case 8:  return pcre2_jit_compile_8(code->u.c8, options);
+  case 16: return pcre2_jit_compile_16(code->u.c16, options);
+  case 32: return pcre2_jit_compile_32(code->u.c32, options);
+  }
+return PCRE2_ERROR_BADMODE;
+}
+
+
+
+/*************************************************
+*            Create a match data block           *
+*************************************************/
+
+/* The block is sized for the pattern, and has the pattern's width. */
+
+PCRE2ANY_EXP_DEFN pcre2any_match_data *
+pcre2any_match_data_create_from_pattern(const pcre2any_code *code)
+{
+pcre2any_match_data *match_data;
+void *md = NULL;
+
+if (code == NULL) return NULL;
+match_data = (pcre2any_match_data *)malloc(sizeof(pcre2any_match_data));
+if (match_data == NULL) return NULL;
+match_data->width = code->width;
+
+switch (code->width)
+  {
+  case 8:
+  md = match_data->u.m8 =
+    pcre2_match_data_create_from_pattern_8(code->u.c8, NULL);
+  break;
+
+  case 16:
+  md = match_data->u.m16 =
+    pcre2_match_data_create_from_pattern_16(code->u.c16, NULL);
+  break;
+
+  case 32:
+  md = match_data->u.m32 =
+    pcre2_match_data_create_from_pattern_32(code->u.c32, NULL);
+  break;
+  }
+
+if (md == NULL)
+  {
+  free(match_data);
+  return NULL;
+  }
+return match_data;
+}
+
+
+
+/*************************************************
+*             Free a match data block            *
+*************************************************/
+
+PCRE2ANY_EXP_DEFN void
+pcre2any_match_data_free(pcre2any_match_data *match_data)
+{
+if (match_data == NULL) return;
+switch (match_data->width)
+  {
+  case 8:  pcre2_match_data_free_8(match_data->u.m8); break;
+  case 16: pcre2_match_data_free_16(match_data->u.m16); break;
+  case 32: pcre2_match_data_free_32(match_data->u.m32); break;
+  }
+free(match_data);
+}
+
+
+
+/*************************************************
+*                Match a pattern                 *
+*************************************************/
+
+/* If the pattern has been JIT-compiled, pcre2_match() uses the JIT code. The
+subject is handed directly to the library of the pattern's width.
+
+Arguments:
+  code          the compiled pattern
+  subject       the subject, in code units of the pattern's width
+  length        its length in code units
+  startoffset   where to start, in code units
+  options       options for pcre2_match()
+  match_data    a match data block of the same width
+
+Returns:        as for pcre2_match()
+*/
+
+PCRE2ANY_EXP_DEFN int
+pcre2any_match(const pcre2any_code *code, const void *subject,
+  PCRE2_SIZE length, PCRE2_SIZE startoffset, uint32_t options,
+  pcre2any_match_data *match_data)
+{
+if (code == NULL || match_data == NULL) return PCRE2_ERROR_NULL;
+if (code->width != match_data->width) return PCRE2_ERROR_BADMODE;
+switch (code->width)
+  {
+  case 8:
+  return pcre2_match_8(code->u.c8, (PCRE2_SPTR8)subject, length, startoffset,
+    options, match_data->u.m8, NULL);
+
+  case 16:
+  return pcre2_match_16(code->u.c16, (PCRE2_SPTR16)subject, length,
+    startoffset, options, match_data->u.m16, NULL);
+
+  case 32:
+  return pcre2_match_32(code->u.c32, (PCRE2_SPTR32)subject, length,
+    startoffset, options, match_data->u.m32, NULL);
+  }
+return PCRE2_ERROR_BADMODE;
+}
+
+
+
+/*************************************************
+*           Get the ovector of a match           *
+*************************************************/
+
+PCRE2ANY_EXP_DEFN uint32_t
+pcre2any_get_ovector_count(pcre2any_match_data *match_data)
+{
+switch (match_data->width)
+  {
+  case 8:  return pcre2_get_ovector_count_8(match_data->u.m8);
+  case 16: return pcre2_get_ovector_count_16(match_data->u.m16);
+  case 32: return pcre2_get_ovector_count_32(match_data->u.m32);
+  }
+return 0;
+}
+
+
+PCRE2ANY_EXP_DEFN PCRE2_SIZE *
+pcre2any_get_ovector_pointer(pcre2any_match_data *match_data)
+{
+switch (match_data->width)
+  {
+  case 8:  return pcre2_get_ovector_pointer_8(match_data->u.m8);
+  case 16: return pcre2_get_ovector_pointer_16(match_data->u.m16);
+  case 32: return pcre2_get_ovector_pointer_32(match_data->u.m32);
+  }
+return NULL;
+}
+
+
+
+/*************************************************
+*          Get the text of an error code         *
+*************************************************/
+
+/* Messages are the same in every width, so the 8-bit library supplies them as
+ordinary C strings. */
+
+PCRE2ANY_EXP_DEFN int
+pcre2any_get_error_message(int errorcode, char *buffer, PCRE2_SIZE size)
+{
+return pcre2_get_error_message_8(errorcode, (PCRE2_UCHAR8 *)buffer, size);
+}
+
+/* End of pcre2any.c */
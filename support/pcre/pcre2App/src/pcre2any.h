@@ -0,0 +1,79 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* This is the public header for a thin wrapper that compiles and matches
+patterns in any of the three PCRE2 code unit widths through one interface. The
+width is chosen when a pattern is compiled, and matching passes the subject
+straight to the library of that width, so UTF-16 or UTF-32 data (for example,
+from Windows-sourced files or PVA string arrays) need not be transcoded to
+UTF-8 first. All three libraries must be linked.
+
+Subjects, patterns, lengths, and offsets are in code units of the pattern's
+width, exactly as for the underlying library. */
+
+#ifndef PCRE2ANY_H_IDEMPOTENT_GUARD
+#define PCRE2ANY_H_IDEMPOTENT_GUARD
+
+/* pcre2.h declares the functions of all three widths whatever the setting of
+PCRE2_CODE_UNIT_WIDTH, so an application's own setting is acceptable here. If
+there is none, 0 (multi-width) is used. */
+
+#ifndef PCRE2_CODE_UNIT_WIDTH
+#define PCRE2_CODE_UNIT_WIDTH 0
+#endif
+#include "pcre2.h"
+
+/* Allow for C++ users */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* When an application links with a non-static DLL under Windows, the
+functions must be imported. */
+
+#if defined(_WIN32) && !defined(PCRE2_STATIC) && !defined(PCRE2ANY_EXP_DECL)
+#  define PCRE2ANY_EXP_DECL  extern __declspec(dllimport)
+#endif
+
+#ifndef PCRE2ANY_EXP_DECL
+#  ifdef __cplusplus
+#    define PCRE2ANY_EXP_DECL  extern "C"
+#  else
+#    define PCRE2ANY_EXP_DECL  extern
+#  endif
+#endif
+
+/* The wrapper's blocks are opaque; each remembers its code unit width. */
+
+typedef struct pcre2any_code pcre2any_code;
+typedef struct pcre2any_match_data pcre2any_match_data;
+
+/* The functions. Except where noted, they behave like the pcre2_xxx()
+functions of the same name, called without contexts. A width other than 8, 16,
+or 32 gives PCRE2_ERROR_BADMODE, and so does matching with a match data block
+that was created for a different width. */
+
+PCRE2ANY_EXP_DECL pcre2any_code *pcre2any_compile(const void *, PCRE2_SIZE,
+  int, uint32_t, int *, PCRE2_SIZE *);
+PCRE2ANY_EXP_DECL void pcre2any_code_free(pcre2any_code *);
+PCRE2ANY_EXP_DECL int pcre2any_code_width(const pcre2any_code *);
+PCRE2ANY_EXP_DECL int pcre2any_jit_compile(pcre2any_code *, uint32_t);
+PCRE2ANY_EXP_DECL int pcre2any_match(const pcre2any_code *, const void *,
+  PCRE2_SIZE, PCRE2_SIZE, uint32_t, pcre2any_match_data *);
+PCRE2ANY_EXP_DECL pcre2any_match_data *pcre2any_match_data_create_from_pattern(
+  const pcre2any_code *);
+PCRE2ANY_EXP_DECL void pcre2any_match_data_free(pcre2any_match_data *);
+PCRE2ANY_EXP_DECL uint32_t pcre2any_get_ovector_count(pcre2any_match_data *);
+PCRE2ANY_EXP_DECL PCRE2_SIZE *pcre2any_get_ovector_pointer(
+  pcre2any_match_data *);
+PCRE2ANY_EXP_DECL int pcre2any_get_error_message(int, char *, PCRE2_SIZE);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif  /* PCRE2ANY_H_IDEMPOTENT_GUARD */
+
+/* End of pcre2any.h */
@@ -0,0 +1,359 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* This program compares two ways of searching UTF-16 and UTF-32 text: first
+transcoding it to UTF-8 and matching with the 8-bit library, and matching it in
+its own width through the pcre2any wrapper. The subject is a synthetic
+instrument log with some non-ASCII characters (degree signs, micro signs, and
+so on). Each pattern is matched globally over the whole log, and the time per
+pass is shown in milliseconds. The transcoding time is included in the first
+column because a caller holding wide data would have to pay it for every new
+buffer.
+
+Usage: pcre2any_bench [-j] [lines]
+
+  -j     use JIT compilation for all the patterns
+  lines  number of log lines in the subject (default 20000) */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcre2any.h"
+
+#define MIN_CLOCKS  (CLOCKS_PER_SEC/5)   /* Minimum timing period per test */
+
+static const char *patterns[] = {
+  "status=FAULT",
+  "Temp=(\\d+\\.\\d)\\x{b0}C",
+  "(?i)alarm|fault|trip",
+  "\\b[A-Z]{3}\\d:\\w+=\\S+\\x{b5}A",
+  "(?m)^\\d{4}-\\d\\d-\\d\\d \\S+ MOT\\d:Pos=-?\\d+",
+  NULL };
+
+static const char *devices[] = {
+  "TMP1:Temp=%d.%d\xc2\xb0" "C status=%s",
+  "PSU2:Curr=%d.%d\xc2\xb5" "A status=%s",
+  "MOT3:Pos=-%d%d steps status=%s",
+  "VAC4:Press=%d.%de-6 mbar (\xc3\x85ngstr\xc3\xb6m gauge) status=%s",
+  NULL };
+
+
+
+/*************************************************
+*       Decode one UTF-8 character               *
+*************************************************/
+
+/* The generated log is valid UTF-8 so there is no checking. */
+
+static const unsigned char *
+utf8_decode(const unsigned char *p, uint32_t *c)
+{
+uint32_t d = *p++;
+if (d < 0x80) { *c = d; return p; }
+if (d < 0xe0) { *c = ((d & 0x1f) << 6) | (p[0] & 0x3f); return p + 1; }
+if (d < 0xf0)
+  {
+  *c = ((d & 0x0f) << 12) | ((p[0] & 0x3f) << 6) | (p[1] & 0x3f);
+  return p + 2;
+  }
+*c = ((d & 0x07) << 18) | ((p[0] & 0x3f) << 12) | ((p[1] & 0x3f) << 6) |
+  (p[2] & 0x3f);
+return p + 3;
+}
+
+
+
+/*************************************************
+*       Encode one character in UTF-8            *
+*************************************************/
+
+static unsigned char *
+utf8_encode(uint32_t c, unsigned char *p)
+{
+if (c < 0x80) *p++ = c;
+else if (c < 0x800)
+  {
+  *p++ = 0xc0 | (c >> 6);
+  *p++ = 0x80 | (c & 0x3f);
+  }
+else if (c < 0x10000)
+  {
+  *p++ = 0xe0 | (c >> 12);
+  *p++ = 0x80 | ((c >> 6) & 0x3f);
+  *p++ = 0x80 | (c & 0x3f);
+  }
+else
+  {
+  *p++ = 0xf0 | (c >> 18);
+  *p++ = 0x80 | ((c >> 12) & 0x3f);
+  *p++ = 0x80 | ((c >> 6) & 0x3f);
+  *p++ = 0x80 | (c & 0x3f);
+  }
+return p;
+}
+
+
+
+/*************************************************
+*       Convert UTF-8 to a given width           *
+*************************************************/
+
+/* Used to set up subjects and patterns. The output is zero-terminated.
+
+Arguments:
+  s         UTF-8 string
+  len       its length
+  width     16 or 32
+  outlen    where to put the output length in code units
+
+Returns:    pointer to malloc'ed output
+*/
+
+static void *
+from_utf8(const char *s, size_t len, int width, size_t *outlen)
+{
+const unsigned char *p = (const unsigned char *)s;
+const unsigned char *end = p + len;
+size_t n = 0;
+void *out = malloc((len + 1) * (width/8));
+
+if (out == NULL) { fprintf(stderr, "Out of memory\n"); exit(1); }
+while (p < end)
+  {
+  uint32_t c;
+  p = utf8_decode(p, &c);
+  if (width == 32) ((uint32_t *)out)[n++] = c;
+  else if (c < 0x10000) ((uint16_t *)out)[n++] = (uint16_t)c;
+  else
+    {
+    c -= 0x10000;
+    ((uint16_t *)out)[n++] = (uint16_t)(0xd800 | (c >> 10));
+    ((uint16_t *)out)[n++] = (uint16_t)(0xdc00 | (c & 0x3ff));
+    }
+  }
+if (width == 32) ((uint32_t *)out)[n] = 0; else ((uint16_t *)out)[n] = 0;
+*outlen = n;
+return out;
+}
+
+
+
+/*************************************************
+*       Transcode UTF-16 or UTF-32 to UTF-8      *
+*************************************************/
+
+/* This is the work that a caller has to do if it only has the 8-bit library.
+
+Arguments:
+  s         the wide string
+  len       its length in code units
+  width     16 or 32
+  out       a buffer of at least 4*len bytes
+
+Returns:    the length of the output
+*/
+
+static size_t
+to_utf8(const void *s, size_t len, int width, unsigned char *out)
+{
+unsigned char *p = out;
+size_t i;
+
+if (width == 32)
+  {
+  const uint32_t *w = (const uint32_t *)s;
+  for (i = 0; i < len; i++) p = utf8_encode(w[i], p);
+  }
+else
+  {
+  const uint16_t *w = (const uint16_t *)s;
+  for (i = 0; i < len; i++)
+    {
+    uint32_t c = w[i];
+    if ((c & 0xfc00) == 0xd800 && i + 1 < len)
+      c = 0x10000 + (((c & 0x3ff) << 10) | (w[++i] & 0x3ff));
+    p = utf8_encode(c, p);
+    }
+  }
+return p - out;
+}
+
+
+
+/*************************************************
+*          Count all matches in a subject        *
+*************************************************/
+
+/* The subject's UTF validity is checked on the first call only, as any caller
+scanning a buffer would arrange.
+
+Arguments:
+  code        the compiled pattern
+  md          a match data block for the pattern
+  subject     the subject
+  length      its length in code units
+
+Returns:      the number of matches
+*/
+
+static long
+count_matches(pcre2any_code *code, pcre2any_match_data *md,
+  const void *subject, size_t length)
+{
+PCRE2_SIZE *ovector = pcre2any_get_ovector_pointer(md);
+PCRE2_SIZE start = 0;
+uint32_t options = 0;
+long count = 0;
+
+for (;;)
+  {
+  int rc = pcre2any_match(code, subject, length, start, options, md);
+  if (rc < 0) break;
+  count++;
+  if (ovector[1] == ovector[0]) break;   /* The patterns never match empty */
+  start = ovector[1];
+  options = PCRE2_NO_UTF_CHECK;
+  }
+return count;
+}
+
+
+
+/*************************************************
+*                 Main program                   *
+*************************************************/
+
+int
+main(int argc, char **argv)
+{
+int jit = 0;
+int i, w;
+long lines = 20000;
+char *log8;
+unsigned char *buffer;
+size_t log8len = 0;
+
+for (i = 1; i < argc; i++)
+  {
+  if (strcmp(argv[i], "-j") == 0) jit = 1;
+  else lines = atol(argv[i]);
+  }
+if (lines <= 0)
+  {
+  fprintf(stderr, "Usage: pcre2any_bench [-j] [lines]\n");
+  return 1;
+  }
+
+/* Generate the log in UTF-8. Every 97th line reports a fault. */
+
+log8 = malloc(lines * 128);
+buffer = malloc(lines * 128 * 4);
+if (log8 == NULL || buffer == NULL)
+  {
+  fprintf(stderr, "Out of memory\n");
+  return 1;
+  }
+
+for (i = 0; i < lines; i++)
+  {
+  char line[128];
+  int n = sprintf(line, "2026-10-18 12:%02d:%02d.%03d ", (i/60)%60, i%60,
+    i%1000);
+  n += sprintf(line + n, devices[i%4], i%90, i%10,
+    (i%97 == 0)? "FAULT" : "OK");
+  line[n++] = '\n';
+  memcpy(log8 + log8len, line, n);
+  log8len += n;
+  }
+
+printf("PCRE2 wide-subject benchmark: %ld lines, %s\n", lines,
+  jit? "JIT" : "interpreter");
+printf("Times are milliseconds per pass over the whole subject\n\n");
+printf("%-44s %5s %10s %10s %8s\n", "Pattern", "Width", "Transcode", "Native",
+  "Matches");
+
+for (w = 16; w <= 32; w += 16)
+  {
+  size_t widelen;
+  void *wide = from_utf8(log8, log8len, w, &widelen);
+
+  for (i = 0; patterns[i] != NULL; i++)
+    {
+    int errorcode;
+    PCRE2_SIZE erroroffset;
+    size_t plen;
+    void *wpattern = from_utf8(patterns[i], strlen(patterns[i]), w, &plen);
+    pcre2any_code *code8 = pcre2any_compile(patterns[i], PCRE2_ZERO_TERMINATED,
+      8, PCRE2_UTF, &errorcode, &erroroffset);
+    pcre2any_code *codew = pcre2any_compile(wpattern, plen, w, PCRE2_UTF,
+      &errorcode, &erroroffset);
+    pcre2any_match_data *md8, *mdw;
+    long count8 = 0, countw = 0;
+    long passes;
+    clock_t start, elapsed;
+    double t8, tw;
+
+    if (code8 == NULL || codew == NULL)
+      {
+      char message[120];
+      pcre2any_get_error_message(errorcode, message, sizeof(message));
+      fprintf(stderr, "Failed to compile %s: %s\n", patterns[i], message);
+      return 1;
+      }
+    if (jit)
+      {
+      (void)pcre2any_jit_compile(code8, PCRE2_JIT_COMPLETE);
+      (void)pcre2any_jit_compile(codew, PCRE2_JIT_COMPLETE);
+      }
+    md8 = pcre2any_match_data_create_from_pattern(code8);
+    mdw = pcre2any_match_data_create_from_pattern(codew);
+
+    /* Transcode, then match in 8 bits. */
+
+    passes = 0;
+    start = clock();
+    do
+      {
+      size_t len8 = to_utf8(wide, widelen, w, buffer);
+      count8 = count_matches(code8, md8, buffer, len8);
+      passes++;
+      elapsed = clock() - start;
+      }
+    while (elapsed < MIN_CLOCKS);
+    t8 = (double)elapsed * 1000.0 / CLOCKS_PER_SEC / passes;
+
+    /* Match in the subject's own width. */
+
+    passes = 0;
+    start = clock();
+    do
+      {
+      countw = count_matches(codew, mdw, wide, widelen);
+      passes++;
+      elapsed = clock() - start;
+      }
+    while (elapsed < MIN_CLOCKS);
+    tw = (double)elapsed * 1000.0 / CLOCKS_PER_SEC / passes;
+
+    printf("%-44s %5d %10.3f %10.3f %8ld%s\n", patterns[i], w, t8, tw, countw,
+      (count8 == countw)? "" : " (count mismatch)");
+
+    pcre2any_match_data_free(md8);
+    pcre2any_match_data_free(mdw);
+    pcre2any_code_free(code8);
+    pcre2any_code_free(codew);
+    free(wpattern);
+    }
+  free(wide);
+  }
+
+free(log8);
+free(buffer);
+return 0;
+}
+
+/* End of pcre2any_bench.c */
@@ -0,0 +1,193 @@
+/*************************************************
+*      Perl-Compatible Regular Expressions       *
+*************************************************/
+
+/* This program measures how JIT matching with a shared pool of JIT stacks
+scales with the number of threads. Every thread matches the same pattern,
+which needs more than the default 32KiB machine stack, through one match
+context that holds the pool. For comparison, the same work is then done with a
+separate JIT stack for each thread, which is what an application had to set up
+for itself before pools existed. The number of matches per second is shown for
+each number of threads, with the speedup over one thread.
+
+Usage: pcre2pool_bench [maxthreads [matches]]
+
+  maxthreads  largest number of threads (default twice the number of CPUs)
+  matches     matches per thread (default 2000) */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include "pcre2.h"
+
+#define SUBJECT_LENGTH 4000
+#define START_STACK    (32*1024)
+#define MAX_STACK      (1024*1024)
+
+typedef struct worker {
+  pcre2_match_context *mcontext;   /* Shared, or the thread's own */
+  epicsEventId done;
+  long matched;
+  long failed;
+} worker;
+
+static pcre2_code *re;
+static char subject[SUBJECT_LENGTH];
+static long matches = 2000;
+
+
+
+/*************************************************
+*               Worker thread                    *
+*************************************************/
+
+static void
+run_worker(void *arg)
+{
+worker *w = (worker *)arg;
+pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(re, NULL);
+long i;
+
+w->matched = w->failed = 0;
+for (i = 0; i < matches; i++)
+  {
+  if (pcre2_match(re, (PCRE2_SPTR)subject, SUBJECT_LENGTH, 0, 0, match_data,
+      w->mcontext) > 0) w->matched++;
+  else w->failed++;
+  }
+pcre2_match_data_free(match_data);
+epicsEventSignal(w->done);
+}
+
+
+
+/*************************************************
+*        Run one round with n threads            *
+*************************************************/
+
+/* If shared is NULL, each thread gets its own JIT stack and match context.
+
+Returns:   matches per second
+*/
+
+static double
+run_round(int n, pcre2_match_context *shared, long *failures)
+{
+worker *workers = (worker *)calloc(n, sizeof(worker));
+pcre2_jit_stack **stacks = (pcre2_jit_stack **)calloc(n, sizeof(void *));
+epicsTimeStamp start, end;
+int i;
+
+for (i = 0; i < n; i++)
+  {
+  workers[i].done = epicsEventMustCreate(epicsEventEmpty);
+  if (shared != NULL) workers[i].mcontext = shared; else
+    {
+    workers[i].mcontext = pcre2_match_context_create(NULL);
+    stacks[i] = pcre2_jit_stack_create(START_STACK, MAX_STACK, NULL);
+    pcre2_jit_stack_assign(workers[i].mcontext, NULL, stacks[i]);
+    }
+  }
+
+epicsTimeGetCurrent(&start);
+for (i = 0; i < n; i++)
+  epicsThreadCreate("pcre2bench", epicsThreadPriorityMedium,
+    epicsThreadGetStackSize(epicsThreadStackMedium), run_worker, &workers[i]);
+
+*failures = 0;
+for (i = 0; i < n; i++)
+  {
+  epicsEventMustWait(workers[i].done);
+  epicsEventDestroy(workers[i].done);
+  *failures += workers[i].failed;
+  }
+epicsTimeGetCurrent(&end);
+
+if (shared == NULL) for (i = 0; i < n; i++)
+  {
+  pcre2_match_context_free(workers[i].mcontext);
+  pcre2_jit_stack_free(stacks[i]);
+  }
+free(stacks);
+free(workers);
+return (double)n * matches / epicsTimeDiffInSeconds(&end, &start);
+}
+
+
+
+/*************************************************
+*                 Main program                   *
+*************************************************/
+
+int
+main(int argc, char **argv)
+{
+int maxthreads = 2 * epicsThreadGetCPUs();
+int errorcode, n, mode;
+PCRE2_SIZE erroroffset;
+pcre2_jit_stack_pool *pool;
+pcre2_match_context *mcontext;
+
+if (argc > 1) maxthreads = atoi(argv[1]);
+if (argc > 2) matches = atol(argv[2]);
+if (maxthreads <= 0 || matches <= 0)
+  {
+  fprintf(stderr, "Usage: pcre2pool_bench [maxthreads [matches]]\n");
+  return 1;
+  }
+
+/* An alternation inside a long repeat uses a lot of JIT stack. */
+
+for (n = 0; n < SUBJECT_LENGTH - 1; n++) subject[n] = (n & 1)? 'a' : 'b';
+subject[SUBJECT_LENGTH - 1] = 'c';
+
+re = pcre2_compile((PCRE2_SPTR)"(?:(a)|b)*c", PCRE2_ZERO_TERMINATED, 0,
+  &errorcode, &erroroffset, NULL);
+if (re == NULL || pcre2_jit_compile(re, PCRE2_JIT_COMPLETE) != 0)
+  {
+  fprintf(stderr, "JIT compilation is not available\n");
+  return 1;
+  }
+
+pool = pcre2_jit_stack_pool_create(START_STACK, MAX_STACK, maxthreads, NULL);
+if (pool == NULL)
+  {
+  fprintf(stderr, "JIT stack pools are not supported on this platform\n");
+  return 1;
+  }
+mcontext = pcre2_match_context_create(NULL);
+pcre2_jit_stack_pool_assign(mcontext, pool);
+
+printf("PCRE2 JIT stack pool benchmark: %ld matches per thread, %d CPUs\n\n",
+  matches, epicsThreadGetCPUs());
+printf("%-16s %7s %14s %8s %8s\n", "Stacks", "Threads", "Matches/sec",
+  "Speedup", "Failed");
+
+for (mode = 0; mode < 2; mode++)
+  {
+  double base = 0;
+  for (n = 1; n <= maxthreads; n = (n < maxthreads && 2*n > maxthreads)?
+      maxthreads : 2*n)
+    {
+    long failures;
+    double rate = run_round(n, (mode == 0)? mcontext : NULL, &failures);
+    if (n == 1) base = rate;
+    printf("%-16s %7d %14.0f %8.2f %8ld\n",
+      (mode == 0)? "shared pool" : "one per thread", n, rate, rate/base,
+      failures);
+    }
+  }
+
+pcre2_match_context_free(mcontext);
+pcre2_jit_stack_pool_free(pool);
+pcre2_code_free(re);
+return 0;
+}
+
+/* End of pcre2pool_bench.c */